@@ -0,0 +1,176 @@
+#pragma once
+
+#include "phys/RigidBody.h"
+#include "gameobject/GameObject.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/**
+ * Helpers shared by the physics benchmarks.
+ *
+ * Colliders are built from points, since geometry needs a GL context.
+ * Bodies belong to one GameObject without components, the step only
+ * needs it to move a Mesh if there is one.
+ */
+namespace Bench {
+
+    using Clock = std::chrono::steady_clock;
+
+    inline GameObject& scene() {
+        static GameObject object("Bench");
+        return object;
+    }
+
+    /* Corners of a box centred on the origin */
+    inline std::vector<vec3> boxPoints(const vec3& halfSize) {
+        std::vector<vec3> points;
+
+        for (int i = 0; i < 8; i++) {
+            points.push_back(vec3(
+                i & 1 ? halfSize.x : -halfSize.x,
+                i & 2 ? halfSize.y : -halfSize.y,
+                i & 4 ? halfSize.z : -halfSize.z
+            ));
+        }
+
+        return points;
+    }
+
+    /* Hull points of a UV sphere, like SphereGeometry */
+    inline std::vector<vec3> spherePoints(float radius, int segments) {
+        std::vector<vec3> points = { vec3(0.0f, radius, 0.0f), vec3(0.0f, -radius, 0.0f) };
+
+        for (int i = 1; i < segments; i++) {
+            const float theta = float(M_PI) * i / segments;
+
+            for (int j = 0; j < segments; j++) {
+                const float phi = 2.0f * float(M_PI) * j / segments;
+                points.push_back(radius * vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+            }
+        }
+
+        return points;
+    }
+
+    inline Ref<RigidBody> makeBody(Ref<Collider> collider) {
+        auto body = ref<RigidBody>(collider);
+        body->gameObject = &scene();
+
+        return body;
+    }
+
+    /* Dynamic box with the density of the boxes in the game */
+    inline Ref<RigidBody> makeBox(const vec3& size, float density = 150.0f) {
+        auto body = makeBody(ref<MeshCollider>(boxPoints(0.5f * size)));
+        body->setBox(size, density);
+
+        return body;
+    }
+
+    /**
+     * Boxes at random positions, 27 m³ per box so the number of pairs
+     * grows linearly with the count. A quarter of them are static, the
+     * others get a random velocity for moveBodies().
+     */
+    inline std::vector<Ref<RigidBody>> makeBoxField(int count) {
+
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        const float extent = std::cbrt(float(count)) * 3.0f;
+        const auto points = boxPoints(vec3(0.5f));
+
+        std::vector<Ref<RigidBody>> bodies;
+        bodies.reserve(count);
+
+        for (int i = 0; i < count; i++) {
+            auto body = makeBody(ref<MeshCollider>(points));
+
+            body->id = i;
+            body->setPosition({ unit(rng) * extent, unit(rng) * extent, unit(rng) * extent });
+
+            if (i % 4 == 0)
+                body->makeStatic();
+            else
+                body->vel = vec3(unit(rng), unit(rng), unit(rng)) - vec3(0.5f);
+
+            body->collider->expandAABB(0.05f);
+            bodies.push_back(body);
+        }
+
+        return bodies;
+    }
+
+    /* Moves the dynamic bodies along their velocity, without a physics step */
+    inline void moveBodies(const std::vector<Ref<RigidBody>>& bodies) {
+        for (const auto& body : bodies) {
+            if (!body->isDynamic)
+                continue;
+
+            body->pose.p += body->vel * 0.05f;
+            body->updateCollider();
+            body->collider->expandAABB(0.05f);
+        }
+    }
+
+    /**
+     * Layers of side x side boxes of 0.5 m with small gaps and a little
+     * jitter, which settle into one island of touching boxes.
+     */
+    inline std::vector<Ref<RigidBody>> makePile(int count, int side, std::mt19937& rng) {
+
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::vector<Ref<RigidBody>> boxes;
+
+        for (int i = 0; i < count; i++) {
+            const int layer = i / (side * side), k = i % (side * side);
+
+            auto box = makeBox(vec3(0.5f));
+            box->setPosition({
+                (k % side) * 0.52f - 3.0f + unit(rng) * 0.01f,
+                0.26f + layer * 0.53f,
+                (k / side) * 0.52f - 3.0f + unit(rng) * 0.01f
+            });
+
+            boxes.push_back(box);
+        }
+
+        return boxes;
+    }
+
+    /* FNV-1a of the poses and velocities, equal only if every bit is */
+    inline uint64_t hashBodies(const std::vector<Ref<RigidBody>>& bodies) {
+        uint64_t hash = 14695981039346656037ull;
+
+        auto add = [&](const void* data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                hash ^= static_cast<const unsigned char*>(data)[i];
+                hash *= 1099511628211ull;
+            }
+        };
+
+        for (const auto& body : bodies) {
+            add(&body->pose.p, sizeof(vec3));
+            add(&body->pose.q, sizeof(quat));
+            add(&body->vel, sizeof(vec3));
+            add(&body->omega, sizeof(vec3));
+        }
+
+        return hash;
+    }
+
+    /* Milliseconds since start */
+    inline double elapsed(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /* Integer argument at index, or fallback if it wasn't given */
+    inline int intArg(int argc, char** argv, int index, int fallback) {
+        return index < argc ? std::atoi(argv[index]) : fallback;
+    }
+}
@@ -0,0 +1,122 @@
+
+#include "Bench.h"
+
+#include "phys/BoundsStore.h"
+
+#include <cstdio>
+#include <random>
+
+/**
+ * Batched BoundsStore queries against the scalar path.
+ *
+ * Every box is tested against the ones after it (all pairs), once with
+ * AABB::intersects, once with the scalar SoA query and once with the
+ * batched kernel. The plane test runs every box against a tilted plane,
+ * PLANE_RUNS times. All three must find the same boxes. The kernel is
+ * picked at build time, ENGINE_ENABLE_AVX2 selects AVX2 over SSE2.
+ *
+ * Usage: BoundsStoreBench [boxes]
+ */
+
+static constexpr int PLANE_RUNS = 1000;
+
+int main(int argc, char** argv) {
+
+    const int count = Bench::intArg(argc, argv, 1, 20000);
+
+    /* A flat world like the tracks, most pairs are rejected on x or z */
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> halfSize(0.2f, 3.0f);
+
+    std::vector<AABB> boxes(count);
+    BoundsStore store;
+    store.resize(count);
+
+    for (int i = 0; i < count; i++) {
+        const vec3 center = vec3(position(rng), 0.05f * position(rng), position(rng));
+        const vec3 extents = vec3(halfSize(rng));
+
+        boxes[i].set(center - extents, center + extents);
+        store.set(i, boxes[i]);
+    }
+
+    std::vector<int> out;
+    out.reserve(count);
+
+    printf("kernel %s, %d boxes\n", BoundsStore::getKernelName(), count);
+
+    /* Overlaps */
+    size_t reference = 0, scalar = 0, batched = 0;
+
+    auto start = Bench::Clock::now();
+
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++)
+            reference += boxes[i].intersects(boxes[j]);
+    }
+
+    const double referenceTime = Bench::elapsed(start);
+    start = Bench::Clock::now();
+
+    for (int i = 0; i < count; i++) {
+        out.clear();
+        store.queryOverlapsScalar(boxes[i], i + 1, count, out);
+        scalar += out.size();
+    }
+
+    const double scalarTime = Bench::elapsed(start);
+    start = Bench::Clock::now();
+
+    for (int i = 0; i < count; i++) {
+        out.clear();
+        store.queryOverlaps(boxes[i], i + 1, count, out);
+        batched += out.size();
+    }
+
+    const double batchedTime = Bench::elapsed(start);
+
+    printf("overlaps:     AABB::intersects %9.2f ms | queryOverlapsScalar %9.2f ms | queryOverlaps %9.2f ms (%.2fx) | %zu pairs\n",
+        referenceTime, scalarTime, batchedTime, scalarTime / batchedTime, batched);
+
+    /* Planes */
+    const Plane plane(glm::normalize(vec3(0.1f, 1.0f, 0.2f)), 0.3f);
+    size_t planeReference = 0, planeScalar = 0, planeBatched = 0;
+
+    start = Bench::Clock::now();
+
+    for (int run = 0; run < PLANE_RUNS; run++) {
+        for (const AABB& box : boxes)
+            planeReference += box.intersectsPlane(plane);
+    }
+
+    const double planeReferenceTime = Bench::elapsed(start);
+    start = Bench::Clock::now();
+
+    for (int run = 0; run < PLANE_RUNS; run++) {
+        out.clear();
+        store.queryPlaneScalar(plane, 0, count, out);
+        planeScalar += out.size();
+    }
+
+    const double planeScalarTime = Bench::elapsed(start);
+    start = Bench::Clock::now();
+
+    for (int run = 0; run < PLANE_RUNS; run++) {
+        out.clear();
+        store.queryPlane(plane, 0, count, out);
+        planeBatched += out.size();
+    }
+
+    const double planeBatchedTime = Bench::elapsed(start);
+
+    printf("planes x%d: AABB::intersectsPlane %9.2f ms | queryPlaneScalar    %9.2f ms | queryPlane    %9.2f ms (%.2fx) | %zu hits\n",
+        PLANE_RUNS, planeReferenceTime, planeScalarTime, planeBatchedTime, planeScalarTime / planeBatchedTime, planeBatched);
+
+    if (reference != scalar || scalar != batched || planeReference != planeScalar || planeScalar != planeBatched) {
+        printf("results differ\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+
+#include "Bench.h"
+
+#include "phys/Broadphase.h"
+#include "phys/broadphase/AABBTreeBroadphase.h"
+#include "phys/broadphase/SweepAndPruneBroadphase.h"
+#include "phys/broadphase/SpatialHashBroadphase.h"
+
+#include <cmath>
+#include <cstdio>
+#include <set>
+
+/**
+ * Pair finding time of the broadphases from 100 to 50k boxes.
+ *
+ * Boxes are spread at a fixed density, a quarter of them static, and the
+ * others move a little every frame. The first frame builds the structure
+ * and is reported on its own. For the tree, the time per frame divided
+ * by n log n should stay about flat. Up to BRUTE_FORCE_LIMIT boxes every
+ * frame is checked against the brute-force broadphase.
+ *
+ * Usage: BroadphaseBench [max boxes]
+ */
+
+static constexpr int FRAMES = 10;
+static constexpr int BRUTE_FORCE_LIMIT = 5000;
+
+struct Result {
+    double firstFrame = 0.0;    /* ms */
+    double perFrame = 0.0;      /* ms, without the first frame */
+    size_t pairs = 0;
+    int mismatches = 0;
+};
+
+static std::set<std::pair<unsigned int, unsigned int>> getIds(const std::vector<CollisionPair>& pairs) {
+    std::set<std::pair<unsigned int, unsigned int>> ids;
+
+    for (const auto& pair : pairs)
+        ids.insert({ pair.A->id, pair.B->id });
+
+    return ids;
+}
+
+static Result run(Broadphase& broadphase, int count) {
+
+    const auto bodies = Bench::makeBoxField(count);
+    const bool check = count <= BRUTE_FORCE_LIMIT;
+
+    BruteForceBroadphase reference;
+    Result result;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        Bench::moveBodies(bodies);
+
+        const auto start = Bench::Clock::now();
+        const auto pairs = broadphase.collectCollisionPairs(bodies, 1.0f / 60.0f);
+        const double time = Bench::elapsed(start);
+
+        if (frame == 0)
+            result.firstFrame = time;
+        else
+            result.perFrame += time / (FRAMES - 1);
+
+        result.pairs = pairs.size();
+
+        if (check && getIds(pairs) != getIds(reference.collectCollisionPairs(bodies, 1.0f / 60.0f)))
+            result.mismatches++;
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+
+    const int maxCount = Bench::intArg(argc, argv, 1, 50000);
+
+    printf("%8s %8s | %-28s | %-19s | %-19s | %s\n",
+        "boxes", "pairs", "tree ms (build) ns/nlogn", "sap ms (build)", "hash ms (build)", "brute ms");
+
+    for (int count : { 100, 1000, 5000, 20000, 50000 }) {
+
+        if (count > maxCount)
+            break;
+
+        AABBTreeBroadphase tree;
+        SweepAndPruneBroadphase sap;
+        SpatialHashBroadphase hash;
+
+        const Result treeResult = run(tree, count);
+        const Result sapResult = run(sap, count);
+        const Result hashResult = run(hash, count);
+
+        const double nlogn = count * std::log2(double(count));
+
+        printf("%8d %8zu | %7.3f (%7.3f) %9.2f | %7.3f (%7.3f) | %7.3f (%7.3f) | ",
+            count, treeResult.pairs,
+            treeResult.perFrame, treeResult.firstFrame, 1e6 * treeResult.perFrame / nlogn,
+            sapResult.perFrame, sapResult.firstFrame,
+            hashResult.perFrame, hashResult.firstFrame);
+
+        if (count <= BRUTE_FORCE_LIMIT) {
+            BruteForceBroadphase brute;
+            printf("%8.3f\n", run(brute, count).perFrame);
+        } else {
+            printf("%8s\n", "-");
+        }
+
+        const int mismatches = treeResult.mismatches + sapResult.mismatches + hashResult.mismatches;
+
+        if (mismatches > 0) {
+            printf("%d frames don't match the brute-force pairs\n", mismatches);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+
+#include "Bench.h"
+
+#include "phys/Broadphase.h"
+#include "phys/broadphase/AABBTreeBroadphase.h"
+#include "phys/broadphase/SpatialHashBroadphase.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+
+/**
+ * Pair finding time of the parallel broadphases from 1 to 16 threads.
+ *
+ * Same box field as BroadphaseBench. Every broadphase runs once on the
+ * calling thread without a pool, then with pools of 1 to 16 threads and
+ * the parallel threshold at 0, so the pool is used at every body count.
+ * The pairs have to come out in the same order as without the pool.
+ *
+ * Below each table is the smallest body count from which a pool of two or
+ * more threads is at least 5% faster than the calling thread at every
+ * larger count, which is where Broadphase::setParallelThreshold() should
+ * be on this machine. Only meaningful with as many cores as threads.
+ *
+ * Usage: BroadphaseThreadsBench [max bodies] [max threads]
+ */
+
+static constexpr int FRAMES = 15;
+static constexpr int BRUTE_FORCE_LIMIT = 5000;
+static constexpr double MIN_SPEEDUP = 1.05;
+
+static constexpr int BODY_COUNTS[] = { 250, 500, 1000, 2000, 5000, 20000 };
+static constexpr int THREAD_COUNTS[] = { 1, 2, 4, 8, 16 };
+
+/* Median time per frame in ms, pairs of the last frame in `pairs` */
+static double run(Broadphase& broadphase, int count, std::vector<std::pair<unsigned int, unsigned int>>& pairs) {
+
+    const auto bodies = Bench::makeBoxField(count);
+    std::vector<double> times;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        Bench::moveBodies(bodies);
+
+        const auto start = Bench::Clock::now();
+        const auto result = broadphase.collectCollisionPairs(bodies, 1.0f / 60.0f);
+        times.push_back(Bench::elapsed(start));
+
+        pairs.clear();
+
+        for (const auto& pair : result)
+            pairs.push_back({ pair.A->id, pair.B->id });
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char** argv) {
+
+    const int maxCount = Bench::intArg(argc, argv, 1, 20000);
+    const int maxThreads = Bench::intArg(argc, argv, 2, 16);
+
+    struct Entry {
+        const char* name;
+        int maxCount;
+        std::function<std::unique_ptr<Broadphase>()> create;
+    };
+
+    const Entry broadphases[] = {
+        { "tree", maxCount, [] { return std::make_unique<AABBTreeBroadphase>(); } },
+        { "hash", maxCount, [] { return std::make_unique<SpatialHashBroadphase>(); } },
+        { "brute", std::min(maxCount, BRUTE_FORCE_LIMIT), [] { return std::make_unique<BruteForceBroadphase>(); } },
+    };
+
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+
+    int mismatches = 0;
+
+    for (const auto& [name, limit, create] : broadphases) {
+
+        printf("\n%-6s %8s %10s |", name, "bodies", "serial ms");
+
+        for (int threads : THREAD_COUNTS) {
+            if (threads <= maxThreads)
+                printf(" %2d threads (x)  ", threads);
+        }
+
+        printf("\n");
+
+        int crossover = -1;
+
+        for (int count : BODY_COUNTS) {
+
+            if (count > limit)
+                break;
+
+            std::vector<std::pair<unsigned int, unsigned int>> serialPairs, pairs;
+
+            const double serial = run(*create(), count, serialPairs);
+            double best = serial;
+            printf("%-6s %8d %10.3f |", "", count, serial);
+
+            for (int threads : THREAD_COUNTS) {
+
+                if (threads > maxThreads)
+                    break;
+
+                auto broadphase = create();
+                broadphase->setWorkerPool(ref<WorkerPool>(threads));
+                broadphase->setParallelThreshold(0);
+
+                const double time = run(*broadphase, count, pairs);
+                printf(" %8.3f (%5.2f)", time, serial / time);
+
+                if (pairs != serialPairs)
+                    mismatches++;
+
+                if (threads > 1)
+                    best = std::min(best, time);
+            }
+
+            if (serial < best * MIN_SPEEDUP)
+                crossover = -1;
+            else if (crossover < 0)
+                crossover = count;
+
+            printf("\n");
+        }
+
+        if (crossover < 0)
+            printf("%-6s pool never faster than the calling thread\n", "");
+        else
+            printf("%-6s pool faster from %d bodies\n", "", crossover);
+    }
+
+    if (mismatches > 0) {
+        printf("%d runs don't match the serial pairs\n", mismatches);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+
+#include "Bench.h"
+
+#include "phys/PhysicsHandler.h"
+#include "phys/XPBDSolver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+/**
+ * Same result for any number of threads, and the island speedup.
+ *
+ * The scene has one large island (a pile of boxes, solved by colour on
+ * the pool), 40 small stacks, hull balls rolling off a static hull they
+ * all touch, fast continuous boxes and a chain of constraints. At step 60
+ * one of the stacks is pushed. It runs with 1 to N threads, without and
+ * with a substep callback, and the hash of all poses and velocities has
+ * to match the one thread run after every step. Exits with 1 if not.
+ *
+ * Speedup is the time per step of one thread over that of N threads,
+ * only meaningful with at least N cores.
+ *
+ * Usage: DeterminismBench [max threads] [steps] [pile boxes]
+ */
+
+struct Run {
+    double stepTime = 0.0;      /* ms */
+    std::vector<uint64_t> hashes;
+    size_t islands = 0;
+    size_t largestIsland = 0;   /* IslandManager::getCost() */
+};
+
+static Run run(int threads, int steps, int pileCount, bool substepCallback) {
+
+    PhysicsHandler phys;
+    phys.setThreadCount(threads);
+
+    std::vector<Ref<RigidBody>> bodies;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    auto add = [&](Ref<RigidBody> body) {
+        phys.add(body);
+        bodies.push_back(body);
+
+        return body;
+    };
+
+    auto ground = add(Bench::makeBody(ref<PlaneCollider>(vec2(400.0f, 400.0f))));
+    ground->makeStatic();
+
+    auto dome = add(Bench::makeBody(ref<MeshCollider>(Bench::spherePoints(3.0f, 20))));
+    dome->setPosition({ 30.0f, 0.0f, 0.0f });
+    dome->makeStatic();
+
+    for (const auto& box : Bench::makePile(pileCount, 12, rng))
+        add(box);
+
+    std::vector<Ref<RigidBody>> stacks;
+
+    for (int s = 0; s < 40; s++) {
+        for (int i = 0; i < 3; i++) {
+            auto box = add(Bench::makeBox(vec3(0.5f)));
+            box->setPosition({ -20.0f + (s % 8) * 2.0f, 0.25f + i * 0.51f, -20.0f + (s / 8) * 2.0f });
+            box->setRotation(glm::angleAxis(unit(rng) * 0.3f, vec3(0.0f, 1.0f, 0.0f)));
+            stacks.push_back(box);
+        }
+    }
+
+    const auto ballPoints = Bench::spherePoints(0.4f, 12);
+
+    for (int i = 0; i < 8; i++) {
+        const float angle = i * float(M_PI) / 4.0f;
+
+        auto ball = add(Bench::makeBody(ref<MeshCollider>(ballPoints)));
+        ball->setPosition({ 30.0f + std::cos(angle), 3.6f + i * 0.05f, std::sin(angle) });
+        ball->setBox(vec3(0.8f), 100.0f);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        auto box = add(Bench::makeBox(vec3(0.2f), 500.0f));
+        box->setPosition({ 10.0f + i, 5.0f, 10.0f });
+        box->vel = vec3(0.0f, -80.0f, 0.0f);
+        box->continuousCollision = true;
+    }
+
+    auto anchor = add(Bench::makeBox(vec3(0.2f)));
+    anchor->setPosition({ -10.0f, 8.0f, 10.0f });
+    anchor->makeStatic();
+
+    Ref<RigidBody> previous = anchor;
+
+    for (int i = 0; i < 10; i++) {
+        auto link = add(Bench::makeBox(vec3(0.3f), 100.0f));
+        link->setPosition({ -10.0f + (i + 1) * 0.5f, 8.0f, 10.0f });
+
+        auto constraint = ref<Constraint>();
+        constraint->setBodies(previous, link, vec3(0.25f, 0.0f, 0.0f), vec3(-0.25f, 0.0f, 0.0f));
+        constraint->setCompliance(0.0f);
+        phys.m_constraints.push_back(constraint);
+
+        previous = link;
+    }
+
+    Run result;
+
+    for (int s = 0; s < steps; s++) {
+        const auto start = Bench::Clock::now();
+
+        if (substepCallback)
+            phys.update(1.0f / 60.0f, [](float) {});
+        else
+            phys.update(1.0f / 60.0f, nullptr);
+
+        result.stepTime += Bench::elapsed(start) / steps;
+        result.hashes.push_back(Bench::hashBodies(bodies));
+
+        if (s == 60)
+            stacks[0]->applyForce(vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    result.islands = phys.m_islands.getIslands().size();
+
+    for (const auto& island : phys.m_islands.getIslands())
+        result.largestIsland = std::max(result.largestIsland, IslandManager::getCost(island));
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+
+    const int maxThreads = Bench::intArg(argc, argv, 1, 4);
+    const int steps = Bench::intArg(argc, argv, 2, 100);
+    const int pileCount = Bench::intArg(argc, argv, 3, 1200);
+
+    printf("hardware threads: %u, %d steps, pile of %d boxes\n", std::thread::hardware_concurrency(), steps, pileCount);
+
+    int mismatches = 0;
+
+    for (bool substepCallback : { false, true }) {
+
+        Run reference;
+
+        for (int threads = 1; threads <= maxThreads; threads++) {
+            const Run result = run(threads, steps, pileCount, substepCallback);
+
+            if (threads == 1)
+                reference = result;
+
+            const auto diverged = std::mismatch(result.hashes.begin(), result.hashes.end(), reference.hashes.begin());
+            const bool same = diverged.first == result.hashes.end();
+
+            printf("%-11s %2d threads: %8.3f ms/step, speedup %5.2f, islands %zu (largest %zu), hash %016llx",
+                substepCallback ? "callback" : "no callback", threads,
+                result.stepTime, reference.stepTime / result.stepTime,
+                result.islands, result.largestIsland, static_cast<unsigned long long>(result.hashes.back()));
+
+            if (same) {
+                printf("\n");
+            } else {
+                printf(", differs from step %zu\n", size_t(diverged.first - result.hashes.begin()));
+                mismatches++;
+            }
+        }
+    }
+
+    if (mismatches > 0) {
+        printf("%d runs don't match one thread\n", mismatches);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+
+#include "Bench.h"
+
+#include "phys/GjkEpa.h"
+
+#include <cstdio>
+#include <new>
+#include <random>
+
+/**
+ * Heap allocations and time per GjkEpa::EPA call.
+ *
+ * Every operator new in the program is counted, the count taken across
+ * the EPA calls has to stay at zero. Random overlapping poses of two box
+ * hulls and two 16-segment sphere hulls are solved RUNS times each.
+ *
+ * Usage: EpaBench [pairs per shape]
+ */
+
+static constexpr int RUNS = 20;
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+
+    if (void* p = std::malloc(size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct Overlap {
+    Ref<MeshCollider> A, B;
+    Simplex simplex;
+};
+
+static std::vector<Overlap> makeOverlaps(const std::vector<vec3>& pointsA, const std::vector<vec3>& pointsB, int count) {
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    auto randomPose = [&](float offset) {
+        Pose pose;
+        pose.p = offset * vec3(unit(rng), unit(rng), unit(rng));
+        pose.q = glm::normalize(quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+
+        return pose;
+    };
+
+    std::vector<Overlap> overlaps;
+
+    while (int(overlaps.size()) < count) {
+        Overlap overlap = { ref<MeshCollider>(pointsA), ref<MeshCollider>(pointsB), Simplex() };
+
+        overlap.A->updateGlobalPose(randomPose(0.3f));
+        overlap.B->updateGlobalPose(randomPose(0.6f));
+
+        overlap.simplex = GjkEpa::GJK(overlap.A.get(), overlap.B.get());
+
+        if (overlap.simplex.containsOrigin)
+            overlaps.push_back(overlap);
+    }
+
+    return overlaps;
+}
+
+/* Returns the allocations per call */
+static double run(const char* name, const std::vector<Overlap>& overlaps) {
+
+    size_t iterations = 0;
+    volatile float sink = 0.0f;
+
+    const size_t allocations = g_allocations;
+    const auto start = Bench::Clock::now();
+
+    for (int run = 0; run < RUNS; run++) {
+        for (const Overlap& overlap : overlaps) {
+            unsigned steps = 0;
+            sink = sink + GjkEpa::EPA(overlap.simplex, overlap.A.get(), overlap.B.get(), &steps).d;
+            iterations += steps;
+        }
+    }
+
+    const double time = Bench::elapsed(start);
+    const double calls = double(RUNS * overlaps.size());
+    const double perCall = (g_allocations - allocations) / calls;
+
+    printf("%-8s %8.2f us/call %8.2f iterations/call %8.2f allocations/call\n",
+        name, 1000.0 * time / calls, iterations / calls, perCall);
+
+    return perCall;
+}
+
+int main(int argc, char** argv) {
+
+    const int count = Bench::intArg(argc, argv, 1, 2000);
+
+    const auto boxes = makeOverlaps(Bench::boxPoints(vec3(0.5f, 0.25f, 1.0f)), Bench::boxPoints(vec3(0.35f)), count);
+    const auto spheres = makeOverlaps(Bench::spherePoints(1.0f, 16), Bench::spherePoints(0.8f, 16), count);
+
+    const double allocations = run("boxes", boxes) + run("spheres", spheres);
+
+    if (allocations > 0.0) {
+        printf("EPA allocated\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,313 @@
+
+#include "Bench.h"
+
+#include "phys/PhysicsHandler.h"
+#include "phys/Narrowphase.h"
+#include "phys/GjkEpa.h"
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+
+/**
+ * GJK + EPA against MPR as the penetration solver of convex hulls.
+ *
+ * Two scenes, box stacks and a car-shaped hull driving over the ground,
+ * are stepped once per solver. For watched pairs (each box on the one
+ * below, the car on the ground) the angle between the contact normals
+ * of consecutive steps is the normal stability, once the scene settled.
+ * Bodies don't sleep, so every step solves all pairs.
+ *
+ * Overlapping pairs are also recorded every SNAPSHOT_STEPS steps of the
+ * EPA run. Both solvers then solve the same snapshots: expansion steps
+ * (EPA) or support queries (MPR) and time per pair, and how far the MPR
+ * normal and depth are from the EPA ones. The same comparison runs on
+ * DEEP_PAIRS random deep overlaps of two box hulls.
+ *
+ * Usage: PenetrationBench [steps]
+ */
+
+static constexpr int SNAPSHOT_STEPS = 20;
+static constexpr int SNAPSHOT_RUNS = 200;
+
+static constexpr int DEEP_PAIRS = 2000;
+
+static constexpr float DEGREES = 180.0f / float(M_PI);
+
+using Solver = Narrowphase::PenetrationSolver;
+
+struct Scene {
+    const char* name;
+    int settleSteps;
+
+    PhysicsHandler phys;
+    std::vector<std::pair<RigidBody*, RigidBody*>> watched;
+
+    /* Hull points of every collider, snapshots build their own copies */
+    std::map<const Collider*, std::vector<vec3>> hulls;
+
+    Ref<RigidBody> addHull(const std::vector<vec3>& points) {
+        auto body = Bench::makeBody(ref<MeshCollider>(points));
+        hulls[body->collider.get()] = points;
+        phys.add(body);
+
+        return body;
+    }
+};
+
+struct Snapshot {
+    Ref<MeshCollider> A, B;
+    Simplex simplex;
+};
+
+struct StepResult {
+    double stepTime = 0.0;      /* ms */
+    double meanAngle = 0.0;     /* Normal change per step, degrees */
+    double maxAngle = 0.0;
+    float topY = 0.0f;
+};
+
+static void buildStacks(Scene& scene) {
+
+    const float size = 0.5f;
+
+    auto floor = scene.addHull(Bench::boxPoints(vec3(30.0f, 0.5f, 30.0f)));
+    floor->setPosition({ 0.0f, -0.5f, 0.0f });
+    floor->makeStatic();
+
+    for (int s = 0; s < 5; s++) {
+        RigidBody* below = floor.get();
+
+        for (int i = 0; i < 6; i++) {
+            auto box = scene.addHull(Bench::boxPoints(vec3(0.5f * size)));
+
+            box->setPosition({ s * 2.0f, 0.5f * size + i * size * 1.001f, 0.0f });
+            box->setRotation(glm::angleAxis(0.05f * i, vec3(0.0f, 1.0f, 0.0f)));
+            box->setBox(vec3(size), 150.0f);
+            box->canSleep = false;
+
+            scene.watched.push_back({ box.get(), below });
+            below = box.get();
+        }
+    }
+}
+
+static void buildCar(Scene& scene) {
+
+    auto floor = scene.addHull(Bench::boxPoints(vec3(30.0f, 0.5f, 30.0f)));
+    floor->setPosition({ 0.0f, -0.5f, 0.0f });
+    floor->makeStatic();
+
+    /* Body, cabin and nose */
+    std::vector<vec3> points;
+
+    for (const vec3& p : Bench::boxPoints(vec3(2.0f, 0.35f, 0.9f)))
+        points.push_back(p);
+
+    for (const vec3& p : Bench::boxPoints(vec3(1.0f, 0.2f, 0.75f)))
+        points.push_back(p + vec3(-0.3f, 0.55f, 0.0f));
+
+    points.push_back(vec3(2.2f, -0.1f, 0.8f));
+    points.push_back(vec3(2.2f, -0.1f, -0.8f));
+
+    /* Wheels as octagons, the many near-parallel faces are what EPA struggles with */
+    for (int w = 0; w < 4; w++) {
+        const vec3 center = vec3(w & 1 ? 1.3f : -1.3f, -0.35f, w & 2 ? 0.85f : -0.85f);
+
+        for (int k = 0; k < 8; k++) {
+            const float angle = k * float(M_PI) / 4.0f;
+            points.push_back(center + vec3(0.35f * std::cos(angle), 0.35f * std::sin(angle), w & 2 ? 0.1f : -0.1f));
+        }
+    }
+
+    auto car = scene.addHull(points);
+    car->setPosition({ 0.0f, 1.2f, 0.0f });
+    car->setBox(vec3(4.0f, 1.1f, 1.8f), 300.0f);
+    car->vel = vec3(3.0f, 0.0f, 0.5f);
+    car->canSleep = false;
+
+    scene.watched.push_back({ car.get(), floor.get() });
+}
+
+static void build(Scene& scene, bool car) {
+    if (car)
+        buildCar(scene);
+    else
+        buildStacks(scene);
+}
+
+static StepResult step(Scene& scene, int steps, std::vector<Snapshot>* snapshots) {
+
+    StepResult result;
+    std::vector<vec3> previous(scene.watched.size(), vec3(0.0f));
+    size_t samples = 0;
+
+    for (int s = 0; s < steps; s++) {
+
+        const auto start = Bench::Clock::now();
+        scene.phys.update(1.0f / 60.0f, nullptr);
+        result.stepTime += Bench::elapsed(start) / steps;
+
+        for (size_t w = 0; w < scene.watched.size(); w++) {
+            const auto [A, B] = scene.watched[w];
+
+            ContactManifold::Manifold manifold;
+            vec3 normal = vec3(0.0f);
+
+            if (Narrowphase::collide(A->collider.get(), B->collider.get(), Narrowphase::Query(), manifold))
+                normal = manifold.normal;
+
+            if (s > scene.settleSteps && glm::length(previous[w]) > 0.5f && glm::length(normal) > 0.5f) {
+                const double angle = std::acos(std::min(1.0f, glm::dot(previous[w], normal))) * DEGREES;
+
+                result.meanAngle += angle;
+                result.maxAngle = std::max(result.maxAngle, angle);
+                samples++;
+            }
+
+            previous[w] = normal;
+
+            if (snapshots == nullptr || s % SNAPSHOT_STEPS != 0)
+                continue;
+
+            /* Copies of the hulls, posed like the bodies now */
+            Snapshot snapshot = {
+                ref<MeshCollider>(scene.hulls[A->collider.get()]),
+                ref<MeshCollider>(scene.hulls[B->collider.get()]),
+                Simplex()
+            };
+
+            snapshot.A->updateGlobalPose(A->pose);
+            snapshot.B->updateGlobalPose(B->pose);
+            snapshot.simplex = GjkEpa::GJK(snapshot.A.get(), snapshot.B.get());
+
+            if (snapshot.simplex.containsOrigin)
+                snapshots->push_back(snapshot);
+        }
+    }
+
+    result.meanAngle /= std::max<size_t>(samples, 1);
+
+    for (const auto& body : scene.phys.m_bodies)
+        result.topY = std::max(result.topY, body->pose.p.y);
+
+    return result;
+}
+
+static std::vector<Snapshot> makeDeepPairs() {
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    auto randomPose = [&](float offset) {
+        Pose pose;
+        pose.p = offset * vec3(unit(rng), unit(rng), unit(rng));
+        pose.q = glm::normalize(quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+
+        return pose;
+    };
+
+    std::vector<Snapshot> snapshots;
+
+    while (snapshots.size() < DEEP_PAIRS) {
+        Snapshot snapshot = {
+            ref<MeshCollider>(Bench::boxPoints(vec3(0.5f, 0.25f, 1.0f))),
+            ref<MeshCollider>(Bench::boxPoints(vec3(0.35f))),
+            Simplex()
+        };
+
+        snapshot.A->updateGlobalPose(randomPose(0.3f));
+        snapshot.B->updateGlobalPose(randomPose(0.6f));
+        snapshot.simplex = GjkEpa::GJK(snapshot.A.get(), snapshot.B.get());
+
+        if (snapshot.simplex.containsOrigin)
+            snapshots.push_back(snapshot);
+    }
+
+    return snapshots;
+}
+
+static void compare(const std::vector<Snapshot>& snapshots) {
+
+    if (snapshots.empty())
+        return;
+
+    double epaSteps = 0.0, mprSupports = 0.0, meanAngle = 0.0, maxAngle = 0.0, depth = 0.0;
+    size_t failures = 0;
+
+    for (const Snapshot& snapshot : snapshots) {
+        unsigned epaIterations = 0, mprIterations = 0;
+
+        const auto epa = GjkEpa::EPA(snapshot.simplex, snapshot.A.get(), snapshot.B.get(), &epaIterations);
+        const auto mpr = GjkEpa::MPR(snapshot.A.get(), snapshot.B.get(), &mprIterations);
+
+        epaSteps += epaIterations;
+        mprSupports += mprIterations;
+
+        if (!mpr.exists) {
+            failures++;
+            continue;
+        }
+
+        const double angle = std::acos(std::min(1.0f, glm::dot(epa.normal, mpr.normal))) * DEGREES;
+
+        meanAngle += angle;
+        maxAngle = std::max(maxAngle, angle);
+        depth += std::abs(epa.d - mpr.d);
+    }
+
+    volatile float sink = 0.0f;
+    double times[2];
+
+    for (int solver = 0; solver < 2; solver++) {
+        const auto start = Bench::Clock::now();
+
+        for (int run = 0; run < SNAPSHOT_RUNS; run++) {
+            for (const Snapshot& snapshot : snapshots) {
+                sink = sink + (solver == 0
+                    ? GjkEpa::EPA(snapshot.simplex, snapshot.A.get(), snapshot.B.get()).d
+                    : GjkEpa::MPR(snapshot.A.get(), snapshot.B.get()).d);
+            }
+        }
+
+        times[solver] = 1000.0 * Bench::elapsed(start) / (SNAPSHOT_RUNS * snapshots.size());
+    }
+
+    const double count = double(snapshots.size());
+
+    printf("  %zu overlapping pairs: EPA %.2f steps %.3f us | MPR %.2f supports %.3f us | MPR normal off by %.3f deg (max %.3f), depth by %.5f, %zu failed\n",
+        snapshots.size(), epaSteps / count, times[0], mprSupports / count, times[1],
+        meanAngle / count, maxAngle, depth / count, failures);
+}
+
+int main(int argc, char** argv) {
+
+    const int steps = Bench::intArg(argc, argv, 1, 600);
+
+    for (bool car : { false, true }) {
+        std::vector<Snapshot> snapshots;
+
+        for (Solver solver : { Solver::EPA, Solver::MPR }) {
+            Narrowphase::setPenetrationSolver(ColliderType::CONVEX_MESH, ColliderType::CONVEX_MESH, solver);
+
+            Scene scene = { car ? "car on ground" : "box stacks", car ? 40 : 120 };
+            build(scene, car);
+
+            const StepResult result = step(scene, steps, solver == Solver::EPA ? &snapshots : nullptr);
+
+            printf("%-13s %s: %.3f ms/step, normal change per step %.4f deg (max %.3f), top y %.4f\n",
+                scene.name, solver == Solver::EPA ? "EPA" : "MPR",
+                result.stepTime, result.meanAngle, result.maxAngle, result.topY);
+        }
+
+        compare(snapshots);
+    }
+
+    Narrowphase::setPenetrationSolver(ColliderType::CONVEX_MESH, ColliderType::CONVEX_MESH, Solver::EPA);
+
+    printf("random deep box pairs\n");
+    compare(makeDeepPairs());
+
+    return 0;
+}
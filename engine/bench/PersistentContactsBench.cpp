@@ -0,0 +1,141 @@
+
+#include "Bench.h"
+
+#include "phys/PhysicsHandler.h"
+#include "phys/XPBDSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/**
+ * Contacts generated on every substep against persistent contacts
+ * (XPBDSolver::persistentContacts), on stacks of four boxes.
+ *
+ * Resting: the stacks start touching and are stepped without sleeping.
+ * Reports the time per step, the stacks whose top box is still within
+ * STANDING_TOLERANCE of its start height, the mean sideways drift of all
+ * boxes and the deepest penetration of a box into the floor.
+ *
+ * Dropped: the same stacks start with gaps of twice the box size, the
+ * deepest floor penetration is taken after every substep.
+ *
+ * Usage: PersistentContactsBench [stacks] [steps]
+ */
+
+static constexpr int BOXES_PER_STACK = 4;
+static constexpr float BOX_SIZE = 0.5f;
+static constexpr float STANDING_TOLERANCE = 0.05f;
+
+struct Stacks {
+    PhysicsHandler phys;
+    std::vector<Ref<RigidBody>> boxes;
+    std::vector<vec3> start;
+};
+
+struct Result {
+    double stepTime = 0.0;      /* ms */
+    int standing = 0;
+    float drift = 0.0f;
+    float penetration = 0.0f;
+};
+
+static void build(Stacks& stacks, int count, float gap) {
+
+    auto floor = Bench::makeBody(ref<MeshCollider>(Bench::boxPoints(vec3(70.0f, 0.5f, 70.0f))));
+    floor->setPosition({ 30.0f, -0.5f, 30.0f });
+    floor->makeStatic();
+    stacks.phys.add(floor);
+
+    for (int s = 0; s < count; s++) {
+        for (int i = 0; i < BOXES_PER_STACK; i++) {
+            auto box = Bench::makeBox(vec3(BOX_SIZE));
+
+            box->setPosition({ (s % 32) * 2.0f, 0.5f * BOX_SIZE + i * BOX_SIZE * gap, (s / 32) * 2.0f });
+            box->canSleep = false;
+
+            stacks.phys.add(box);
+            stacks.boxes.push_back(box);
+            stacks.start.push_back(box->pose.p);
+        }
+    }
+}
+
+/* Deepest penetration of a box into the floor at y = 0 */
+static float floorPenetration(const Stacks& stacks) {
+    float depth = 0.0f;
+
+    for (size_t i = 0; i < stacks.boxes.size(); i += BOXES_PER_STACK)
+        depth = std::max(depth, 0.5f * BOX_SIZE - stacks.boxes[i]->pose.p.y);
+
+    return depth;
+}
+
+static Result resting(int count, int steps) {
+
+    Stacks stacks;
+    build(stacks, count, 1.001f);
+
+    Result result;
+    const auto start = Bench::Clock::now();
+
+    for (int s = 0; s < steps; s++) {
+        stacks.phys.update(1.0f / 60.0f, nullptr);
+        result.penetration = std::max(result.penetration, floorPenetration(stacks));
+    }
+
+    result.stepTime = Bench::elapsed(start) / steps;
+
+    for (size_t i = 0; i < stacks.boxes.size(); i++) {
+        const vec3 p = stacks.boxes[i]->pose.p;
+        const vec3 p0 = stacks.start[i];
+
+        result.drift += std::sqrt((p.x - p0.x) * (p.x - p0.x) + (p.z - p0.z) * (p.z - p0.z)) / stacks.boxes.size();
+
+        if (i % BOXES_PER_STACK == BOXES_PER_STACK - 1 && std::abs(p.y - p0.y) < STANDING_TOLERANCE)
+            result.standing++;
+    }
+
+    return result;
+}
+
+static float dropped(int count, int steps) {
+
+    Stacks stacks;
+    build(stacks, count, 3.0f);
+
+    float penetration = 0.0f;
+
+    for (int s = 0; s < steps; s++) {
+        stacks.phys.update(1.0f / 60.0f, [&](float) {
+            penetration = std::max(penetration, floorPenetration(stacks));
+        });
+    }
+
+    return penetration;
+}
+
+int main(int argc, char** argv) {
+
+    const int count = Bench::intArg(argc, argv, 1, 32);
+    const int steps = Bench::intArg(argc, argv, 2, 1000);
+
+    printf("%d stacks of %d boxes, %d steps\n", count, BOXES_PER_STACK, steps);
+    printf("%-12s %10s %10s %10s %14s %14s\n",
+        "contacts", "ms/step", "standing", "drift", "penetration", "drop penetr.");
+
+    for (bool persistent : { false, true }) {
+        XPBDSolver::persistentContacts = persistent;
+
+        const Result result = resting(count, steps);
+        const float drop = dropped(count, 120);
+
+        printf("%-12s %10.3f %7d/%-2d %10.4f %14.4f %14.4f\n",
+            persistent ? "persistent" : "per substep",
+            result.stepTime, result.standing, count, result.drift, result.penetration, drop);
+    }
+
+    XPBDSolver::persistentContacts = true;
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+
+#include "Bench.h"
+
+#include "phys/PhysicsHandler.h"
+#include "phys/XPBDSolver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+/**
+ * Solving one large island by colour (XPBDSolver::SolverColors).
+ *
+ * A pile of boxes that doesn't sleep settles into one island. For its
+ * contacts this prints, per maxSolverColors:
+ * - the colours used and their sizes, and the items left to the serial
+ *   overflow
+ * - the speedup bound with T threads, if items cost the same and
+ *   barriers are free (chunks of colorChunkSize handed out in turn)
+ *
+ * Then the cost of colouring against the solve on one thread, the time
+ * of the colour solve with pools of 1 to N threads, and the time per
+ * step of the whole scene, whose hash has to match the one thread run.
+ * Speedups are only meaningful with at least N cores.
+ *
+ * Usage: PileBench [boxes] [max threads] [steps]
+ */
+
+static constexpr int SETTLE_STEPS = 20;
+static constexpr int SOLVE_RUNS = 200;
+
+struct Pile {
+    PhysicsHandler phys;
+    std::vector<Ref<RigidBody>> boxes;
+};
+
+static std::unique_ptr<Pile> makePile(int count, int threads) {
+
+    auto pile = std::make_unique<Pile>();
+    pile->phys.setThreadCount(threads);
+
+    auto ground = Bench::makeBody(ref<PlaneCollider>(vec2(400.0f, 400.0f)));
+    ground->makeStatic();
+    pile->phys.add(ground);
+
+    std::mt19937 rng(3);
+    pile->boxes = Bench::makePile(count, 10, rng);
+
+    for (const auto& box : pile->boxes) {
+        box->canSleep = false;
+        pile->phys.add(box);
+    }
+
+    for (int s = 0; s < SETTLE_STEPS; s++)
+        pile->phys.update(1.0f / 60.0f, nullptr);
+
+    return pile;
+}
+
+/* Items over the time of the longest chunk of each colour plus the overflow */
+static double speedupBound(const std::vector<size_t>& sizes, size_t overflow, size_t items, size_t threads) {
+    const size_t grain = XPBDSolver::colorChunkSize;
+    double time = double(overflow);
+
+    for (size_t size : sizes) {
+        const size_t chunks = (size + grain - 1) / grain;
+        time += std::min(double(size), double((chunks + threads - 1) / threads * grain));
+    }
+
+    return double(items) / time;
+}
+
+static void colorStats(Pile& pile, int maxThreads) {
+
+    IslandManager& islands = pile.phys.m_islands;
+
+    const Island* largest = nullptr;
+
+    for (const auto& island : islands.getIslands()) {
+        if (largest == nullptr || island.bodyCount > largest->bodyCount)
+            largest = &island;
+    }
+
+    if (largest == nullptr)
+        return;
+
+    const float h = 1.0f / 60.0f / XPBDSolver::NUM_SUB_STEPS;
+
+    std::vector<Ref<ContactSet>> contacts;
+    XPBDSolver::getContacts(islands.getPairs(*largest), h, contacts);
+
+    const auto constraints = islands.getConstraints(*largest);
+
+    printf("largest island: %u bodies, %u pairs, %zu contacts\n", largest->bodyCount, largest->pairCount, contacts.size());
+    printf("%10s %5s %20s %16s   %s\n", "max colors", "used", "batch min/med/max", "overflow", "bound T4 / T8 / T16");
+
+    const size_t maxColors = XPBDSolver::maxSolverColors;
+
+    for (size_t colorCount : { 4, 8, 16, 32 }) {
+        XPBDSolver::maxSolverColors = colorCount;
+
+        XPBDSolver::SolverColors colors;
+        XPBDSolver::colorItems(constraints, contacts, colors);
+
+        const size_t used = colors.getColorCount();
+        const size_t items = colors.items.size();
+        const size_t overflow = colors.offsets[used + 1] - colors.offsets[used];
+
+        std::vector<size_t> sizes;
+
+        for (size_t c = 0; c < used; c++) {
+            if (colors.offsets[c + 1] > colors.offsets[c])
+                sizes.push_back(colors.offsets[c + 1] - colors.offsets[c]);
+        }
+
+        std::vector<size_t> sorted = sizes;
+        std::sort(sorted.begin(), sorted.end());
+
+        printf("%10zu %5zu %6zu /%5zu /%5zu %7zu (%5.1f%%)   %.2f / %.2f / %.2f\n",
+            colorCount, sizes.size(),
+            sorted.empty() ? 0 : sorted.front(), sorted.empty() ? 0 : sorted[sorted.size() / 2], sorted.empty() ? 0 : sorted.back(),
+            overflow, 100.0 * overflow / std::max<size_t>(items, 1),
+            speedupBound(sizes, overflow, items, 4), speedupBound(sizes, overflow, items, 8), speedupBound(sizes, overflow, items, 16));
+    }
+
+    XPBDSolver::maxSolverColors = maxColors;
+
+    XPBDSolver::SolverColors colors;
+
+    auto start = Bench::Clock::now();
+
+    for (int run = 0; run < SOLVE_RUNS; run++)
+        XPBDSolver::colorItems(constraints, contacts, colors);
+
+    const double colorTime = 1000.0 * Bench::elapsed(start) / SOLVE_RUNS;
+
+    start = Bench::Clock::now();
+
+    for (int run = 0; run < SOLVE_RUNS; run++) {
+        XPBDSolver::solvePositions(contacts, h);
+        XPBDSolver::solveVelocities(contacts, h);
+    }
+
+    const double serialTime = 1000.0 * Bench::elapsed(start) / SOLVE_RUNS;
+
+    printf("per substep: colouring %.1f us, contact solve %.1f us\n", colorTime, serialTime);
+    printf("solve by colour (%zu colours):", XPBDSolver::maxSolverColors);
+
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        WorkerPool pool(threads);
+
+        start = Bench::Clock::now();
+
+        for (int run = 0; run < SOLVE_RUNS; run++) {
+            XPBDSolver::solvePositions(colors, contacts, h, &pool);
+            XPBDSolver::solveVelocities(colors, contacts, h, &pool);
+        }
+
+        const double time = 1000.0 * Bench::elapsed(start) / SOLVE_RUNS;
+        printf(" T%d %.1f us (%.2f)", threads, time, serialTime / time);
+    }
+
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+
+    const int count = Bench::intArg(argc, argv, 1, 1000);
+    const int maxThreads = Bench::intArg(argc, argv, 2, 4);
+    const int steps = Bench::intArg(argc, argv, 3, 50);
+
+    printf("hardware threads: %u, pile of %d boxes\n", std::thread::hardware_concurrency(), count);
+
+    colorStats(*makePile(count, 1), maxThreads);
+
+    printf("%d steps after settling:\n", steps);
+
+    uint64_t reference = 0;
+    double referenceTime = 0.0;
+    int mismatches = 0;
+
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        auto pile = makePile(count, threads);
+
+        const auto start = Bench::Clock::now();
+
+        for (int s = 0; s < steps; s++)
+            pile->phys.update(1.0f / 60.0f, nullptr);
+
+        const double time = Bench::elapsed(start) / steps;
+        const uint64_t hash = Bench::hashBodies(pile->boxes);
+
+        if (threads == 1) {
+            reference = hash;
+            referenceTime = time;
+        }
+
+        printf("  %2d threads: %8.3f ms/step, speedup %5.2f, hash %016llx%s\n",
+            threads, time, referenceTime / time, static_cast<unsigned long long>(hash),
+            hash == reference ? "" : ", differs from one thread");
+
+        if (hash != reference)
+            mismatches++;
+    }
+
+    if (mismatches > 0)
+        return 1;
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include "common/glm.h"
 #include "phys/Plane.h"
 
+#include <cmath>
 #include <limits>
 
 class AABB {
@@ -23,6 +24,36 @@ public:
         max += scalar;
     }
 
+    inline bool isFinite() const {
+        return std::isfinite(min.x) && std::isfinite(min.y) && std::isfinite(min.z) &&
+            std::isfinite(max.x) && std::isfinite(max.y) && std::isfinite(max.z);
+    }
+
+    inline vec3 getCenter() const {
+        return 0.5f * (min + max);
+    }
+
+    inline vec3 getSize() const {
+        return max - min;
+    }
+
+    /* Used as the SAH cost metric by the broadphase tree */
+    inline float surfaceArea() const {
+        const vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    inline void merge(const AABB& a, const AABB& b) {
+        min = glm::min(a.min, b.min);
+        max = glm::max(a.max, b.max);
+    }
+
+    inline bool contains(const AABB& other) const {
+        return other.min.x >= min.x && other.max.x <= max.x &&
+            other.min.y >= min.y && other.max.y <= max.y &&
+            other.min.z >= min.z && other.max.z <= max.z;
+    }
+
     inline bool containsPoint(vec3 point) const {
         return point.x < min.x || point.x > max.x ||
             point.y < min.y || point.y > max.y ||
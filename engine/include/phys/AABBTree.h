@@ -0,0 +1,143 @@
+#pragma once
+
+#include "phys/AABB.h"
+
+#include <vector>
+
+/**
+ * Incrementally updated dynamic AABB tree.
+ *
+ * Leaves store a 'fat' AABB: the tight bounds grown by a margin, so that
+ * small movements don't change the tree at all. A leaf is only re-inserted
+ * once its tight bounds leave the fat bounds. Leaves are inserted using a
+ * branch and bound search for the cheapest sibling (surface area heuristic)
+ * and the tree is refined with SAH-driven rotations on the way back up.
+ *
+ * Nodes live in a flat array and reference each other by index. Removed
+ * nodes go onto a free list and are reused.
+ *
+ * Based on b2DynamicTree (Box2D, Erin Catto)
+ */
+class AABBTree {
+public:
+
+    static constexpr int NULL_NODE = -1;
+
+    struct Node {
+        AABB aabb;              /* Fat AABB for leaves, union of children otherwise */
+
+        int parent = NULL_NODE; /* Doubles as the 'next' pointer in the free list */
+        int child1 = NULL_NODE;
+        int child2 = NULL_NODE;
+
+        int height = -1;        /* Leaf = 0, free node = -1 */
+        int userData = -1;
+
+        inline bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    /** Amount [m] by which leaf AABBs are grown */
+    float m_margin = 0.1f;
+
+    AABBTree(float margin = 0.1f);
+
+    /**
+     * @brief Creates a leaf for the given (tight) bounds.
+     * @return Proxy (node index) that identifies the leaf.
+     */
+    int insert(const AABB& aabb, int userData);
+
+    void remove(int proxy);
+
+    /**
+     * @brief Updates the bounds of a leaf.
+     * @return true if the leaf had to be re-inserted.
+     */
+    bool move(int proxy, const AABB& aabb);
+
+    /**
+     * @brief Calls `callback(userData)` for every leaf that overlaps `aabb`.
+     */
+    template<typename Callback>
+    void query(const AABB& aabb, Callback&& callback) const {
+
+        if (m_root == NULL_NODE)
+            return;
+
+        thread_local std::vector<int> stack;
+        stack.clear();
+        stack.push_back(m_root);
+
+        while (!stack.empty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (!node.aabb.intersects(aabb))
+                continue;
+
+            if (node.isLeaf()) {
+                callback(node.userData);
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    /**
+     * @brief Calls `callback(userData)` for every leaf in depth-first order.
+     * Neighbouring leaves are close in space, which keeps subsequent 
+     * queries cache friendly.
+     */
+    template<typename Callback>
+    void forEachLeaf(Callback&& callback) const {
+
+        if (m_root == NULL_NODE)
+            return;
+
+        thread_local std::vector<int> stack;
+        stack.clear();
+        stack.push_back(m_root);
+
+        while (!stack.empty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (node.isLeaf()) {
+                callback(node.userData);
+            } else {
+                stack.push_back(node.child2);
+                stack.push_back(node.child1);
+            }
+        }
+    }
+
+    inline const AABB& getFatAABB(int proxy) const { return m_nodes[proxy].aabb; }
+    inline int getUserData(int proxy) const { return m_nodes[proxy].userData; }
+
+    inline int getHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+    inline int getLeafCount() const { return m_leafCount; }
+
+    void clear();
+
+private:
+
+    std::vector<Node> m_nodes;
+
+    int m_root = NULL_NODE;
+    int m_freeList = NULL_NODE;
+    int m_leafCount = 0;
+
+    int allocateNode();
+    void freeNode(int node);
+
+    int findBestSibling(const AABB& aabb) const;
+
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+
+    /**
+     * Swaps a child and a grandchild of node A if that reduces the SAH cost.
+     */
+    void rotate(int iA);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "phys/AABB.h"
+#include "phys/Plane.h"
+
+#include <vector>
+
+/**
+ * Structure of arrays copy of a set of AABBs, for batched overlap tests.
+ *
+ * One AABB (or plane) is tested against 8 (AVX2) or 4 (SSE2) stored
+ * bounds per instruction, with a scalar fallback on other targets. The
+ * results match AABB::intersects and AABB::intersectsPlane, including
+ * touching boxes and infinite bounds.
+ *
+ * Indices are usually the body indices, slots without bounds are marked
+ * empty and never overlap anything.
+ */
+class BoundsStore {
+public:
+
+    BoundsStore() = default;
+
+    void resize(size_t size);
+    inline size_t size() const { return m_minX.size(); }
+
+    void set(size_t index, const AABB& aabb);
+    void setEmpty(size_t index);
+
+    /**
+     * @brief Appends the indices in [begin, end) whose bounds overlap `aabb`.
+     */
+    void queryOverlaps(const AABB& aabb, size_t begin, size_t end, std::vector<int>& out) const;
+
+    /**
+     * @brief Appends the indices in [begin, end) whose bounds intersect `plane`.
+     */
+    void queryPlane(const Plane& plane, size_t begin, size_t end, std::vector<int>& out) const;
+
+    /* Reference implementations, also used for the remainder of a batch */
+    void queryOverlapsScalar(const AABB& aabb, size_t begin, size_t end, std::vector<int>& out) const;
+    void queryPlaneScalar(const Plane& plane, size_t begin, size_t end, std::vector<int>& out) const;
+
+    /** @brief Instruction set the batched queries were compiled for */
+    static const char* getKernelName();
+
+private:
+
+    std::vector<float> m_minX, m_minY, m_minZ;
+    std::vector<float> m_maxX, m_maxY, m_maxZ;
+};
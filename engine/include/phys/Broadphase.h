@@ -0,0 +1,135 @@
+#pragma once
+
+#include "phys/RigidBody.h"
+#include "phys/CollisionPair.h"
+#include "phys/BoundsStore.h"
+#include "util/WorkerPool.h"
+
+#include <functional>
+#include <vector>
+#include <utility>
+
+/**
+ * Broadphase interface.
+ *
+ * A broadphase finds the pairs of bodies whose (expanded) AABBs overlap, so
+ * the narrow phase only has to run GJK / EPA on bodies that are close.
+ * Implementations may keep state between steps (trees, sorted lists, etc).
+ */
+class Broadphase {
+public:
+
+    Broadphase() = default;
+    virtual ~Broadphase() = default;
+
+    /**
+     * @brief Collects potential collision pairs (broad phase)
+     * @param bodies Vector of rigid bodies to check for collisions.
+     * @param dt Delta time for the current physics step.
+     * @return Vector of basic collision pairs, ordered by body index.
+     */
+    virtual std::vector<CollisionPair> collectCollisionPairs(
+        const std::vector<Ref<RigidBody>>& bodies,
+        const float dt
+    ) = 0;
+
+    /**
+     * @brief Filter and bounds test shared by all broadphase implementations.
+     * Rejects pairs that can never produce contacts (non-colliding, both
+     * static / sleeping, unsupported shape combination) and runs the
+     * shape-specific AABB test.
+     * @note A is expected to be the body with the lower index.
+     */
+    static bool testPair(
+        const RigidBody* A,
+        const RigidBody* B
+    );
+
+    /**
+     * @brief Spreads the pair search over a worker pool, nullptr runs it
+     * on the calling thread. The result does not depend on the pool.
+     */
+    inline void setWorkerPool(Ref<WorkerPool> pool) { m_workerPool = pool; }
+
+    /**
+     * @brief Below this many bodies the search stays on the calling
+     * thread, since handing it to the pool costs more than it saves.
+     * bench/BroadphaseThreadsBench shows where that is on a machine.
+     */
+    inline void setParallelThreshold(size_t bodyCount) { m_parallelThreshold = bodyCount; }
+
+protected:
+
+    using CandidateBuffer = std::vector<std::pair<int, int>>;
+
+    Ref<WorkerPool> m_workerPool = nullptr;
+    size_t m_parallelThreshold = 512;
+    std::vector<CandidateBuffer> m_threadBuffers;
+
+    /**
+     * @brief Calls `collect(begin, end, buffer)` over [0, count), split
+     * across the worker pool (if set and `bodyCount` is large enough).
+     * Each thread writes to its own buffer, the buffers are appended to
+     * `candidates` in thread order afterwards. `collect` must not modify
+     * shared state.
+     */
+    void parallelCollect(
+        size_t count,
+        size_t grain,
+        size_t bodyCount,
+        CandidateBuffer& candidates,
+        const std::function<void(size_t begin, size_t end, CandidateBuffer& buffer)>& collect
+    );
+
+    /**
+     * @brief Turns a list of candidate index pairs into collision pairs.
+     * Candidates are sorted and de-duplicated first, so the result is
+     * deterministic and ordered the same way as the brute-force loop.
+     * Runs serially, since creating a pair may wake its bodies.
+     * @param bodies Vector of rigid bodies the indices refer to.
+     * @param candidates Index pairs (lower index first). Sorted in-place.
+     */
+    static std::vector<CollisionPair> emitPairs(
+        const std::vector<Ref<RigidBody>>& bodies,
+        std::vector<std::pair<int, int>>& candidates
+    );
+
+    /* SoA copy of the body bounds, indexed like the bodies vector */
+    BoundsStore m_bounds;
+
+    /**
+     * @brief Copies the expanded AABBs of all bodies into m_bounds.
+     * Bodies that can't collide get empty bounds.
+     */
+    void updateBounds(const std::vector<Ref<RigidBody>>& bodies);
+
+    /**
+     * @brief Batch tests one body against all others in m_bounds, for
+     * bodies that can't be stored in the acceleration structure (planes,
+     * unbounded or huge AABBs). Planes use the plane-vs-AABB test.
+     * @note m_bounds must be up to date.
+     */
+    void collectAgainstAll(
+        const std::vector<Ref<RigidBody>>& bodies,
+        int index,
+        std::vector<std::pair<int, int>>& candidates
+    );
+};
+
+/**
+ * Tests every pair of bodies - O(n²), but 4 or 8 pairs at a time using
+ * the batched BoundsStore kernels. Mostly useful as a reference for the
+ * other broadphases, XPBDSolver::collectCollisionPairs is the scalar one.
+ */
+class BruteForceBroadphase : public Broadphase {
+public:
+
+    std::vector<CollisionPair> collectCollisionPairs(
+        const std::vector<Ref<RigidBody>>& bodies,
+        const float dt
+    ) override;
+
+private:
+
+    CandidateBuffer m_candidates;
+};
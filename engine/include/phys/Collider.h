@@ -6,16 +6,42 @@
 #include "phys/Pose.h"
 #include "phys/AABB.h"
 #include "phys/Plane.h"
+#include "phys/TriangleBVH.h"
 
 #include <vector>
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <future>
 
 enum class ColliderType {
-    // BOX, 
     PLANE, 
+    HEIGHTFIELD,
     SPHERE, 
+    CAPSULE,
+    BOX,
     INEFFICIENT_MESH,
-    CONVEX_MESH
+    CONVEX_MESH,
+    COMPOUND,
+
+    COUNT   /* Number of types, keep last */
+};
+
+/**
+ * Points of a collider that are (nearly) furthest along a direction, i.e.
+ * the vertex, edge or face that a contact touches. World space, unordered.
+ * 
+ * Faces (see findSupportFace) are ordered counter-clockwise around their
+ * outward normal instead.
+ */
+struct SupportFeature {
+    static constexpr size_t MAX_POINTS = 16;
+
+    std::array<vec3, MAX_POINTS> points;
+    std::array<uint32_t, MAX_POINTS> ids;   /* Vertex indices, stable across queries */
+    size_t size = 0;
+
+    vec3 normal = vec3(0.0f);               /* Faces only */
 };
 
 struct Collider {
@@ -48,6 +74,26 @@ public:
         return vec3(0);
     }
 
+    /* MPR: any point inside of the shape, the center by default */
+    virtual vec3 findInteriorPoint() const {
+        return m_relativePosW;
+    }
+
+    /* Contact points, defaults to the single support point */
+    virtual void findSupportFeature(const vec3& dir, SupportFeature& feature) const {
+        feature.points[0] = this->findFurthestPoint(dir);
+        feature.ids[0] = 0;
+        feature.size = 1;
+    }
+
+    /**
+     * Face whose normal is closest to a direction, for contact clipping.
+     * @return false if the collider has no (convex) faces
+     */
+    virtual bool findSupportFace(const vec3& dir, SupportFeature& face) const {
+        return false;
+    }
+
 };
 
 struct PlaneCollider : public Collider {
@@ -61,21 +107,112 @@ struct PlaneCollider : public Collider {
 struct SphereCollider : public Collider {
     float m_radius = 1.0f;
     SphereCollider(const float diameter = 1.0f);
+
+    void expandAABB(float scalar = 0.0f) override;
+    void updateGlobalPose(const Pose& pose) override;
+
+    vec3 findFurthestPoint(const vec3& dir) const override;
+};
+
+/**
+ * Segment with a radius, i.e. a cylinder with hemispherical caps. The core
+ * segment runs along the local Y axis.
+ */
+struct CapsuleCollider : public Collider {
+    float m_radius = 0.5f;
+    float m_halfHeight = 0.5f;      /* Half length of the core segment */
+
+    /* Ends of the core segment, world space */
+    vec3 m_pointA = vec3(0.0f);
+    vec3 m_pointB = vec3(0.0f);
+
+    /**
+     * @param radius Radius of the caps
+     * @param height Total height, including the caps
+     */
+    CapsuleCollider(float radius = 0.5f, float height = 2.0f);
+
+    void expandAABB(float scalar = 0.0f) override;
+    void updateGlobalPose(const Pose& pose) override;
+
+    vec3 findFurthestPoint(const vec3& dir) const override;
+    void findSupportFeature(const vec3& dir, SupportFeature& feature) const override;
 };
 
 struct MeshCollider : public Collider {
 
+    /**
+     * Geometry is kept in body space (including the relative position),
+     * queries transform into it using the pose of the last update.
+     */
     std::vector<vec3> m_vertices;
-    std::vector<vec3> m_verticesWorldSpace;
     std::vector<unsigned int> m_indices;
-    std::vector<unsigned int> m_uniqueIndices;
 
+    /* Triangle corners and normal, body space */
     std::vector<std::array<vec3, 4>> m_triangles;
 
-    // @TODO convexHull;
+    Pose m_pose;
+    AABB m_localAabb;
+    vec3 m_localCentroid = vec3(0.0f);  /* Of the support vertices */
+
+    /**
+     * Support mapping graph: convex hull vertices (indices into m_vertices,
+     * ascending, welded by position) and their hull edges in compressed
+     * rows, i.e. vertex i links to
+     * m_adjacency[m_adjacencyOffsets[i] .. m_adjacencyOffsets[i + 1]).
+     * Concave meshes keep all welded vertices and no edges.
+     */
+    std::vector<unsigned int> m_supportVertices;
+    std::vector<unsigned int> m_adjacencyOffsets;
+    std::vector<unsigned int> m_adjacency;
+
+    /* Hill climbing needs a closed convex surface, tiny hulls are scanned */
+    static constexpr size_t HILL_CLIMB_MIN_VERTICES = 32;
+    bool m_hillClimb = false;
+
+    /**
+     * Graph vertex furthest along each of the 26 directions (x, y, z) with
+     * components in {-1, 0, 1}, indexed 9 (x + 1) + 3 (y + 1) + (z + 1).
+     * Queries start climbing at the one closest to their direction, not at
+     * the previous result, so a query doesn't depend on the ones before it
+     * (e.g. those of other islands on other threads).
+     */
+    std::array<unsigned int, 27> m_climbStart = {};
+
+    /* Support vertex slot, by hill climbing the graph */
+    unsigned int climb(const vec3& localDir) const;
 
-    MeshCollider(Ref<Geometry> geometry, bool isConvex = true);
+    /* Vertices this close to the support plane (relative to the size) are part of a feature */
+    static constexpr float FEATURE_TOLERANCE = 1e-3f;
+
+    /**
+     * Hull faces: coplanar triangles merged into convex polygons, ordered
+     * counter-clockwise around their outward normal. Face f has the vertex
+     * indices m_faceVertices[m_faceOffsets[f] .. m_faceOffsets[f + 1]).
+     * Support vertex slot i touches the faces listed in m_vertexFaces, in
+     * the same compressed layout. Empty for concave meshes.
+     */
+    std::vector<vec3> m_faceNormals;
+    std::vector<unsigned int> m_faceOffsets;
+    std::vector<unsigned int> m_faceVertices;
+    std::vector<unsigned int> m_vertexFaceOffsets;
+    std::vector<unsigned int> m_vertexFaces;
+
+    /**
+     * Triangle tree of concave (INEFFICIENT_MESH) colliders, for contacts
+     * and raycasts. Large meshes build it on a worker thread, queries scan
+     * all triangles until it is ready.
+     */
+    static constexpr size_t BVH_ASYNC_TRIANGLES = 4096;
+
+    /* Simplifies the hull to at most this many vertices, 0 keeps all of them */
+    size_t m_maxHullVertices = 0;
+
+    MeshCollider(Ref<Geometry> geometry, bool isConvex = true, size_t maxHullVertices = 0);
     MeshCollider(Ref<Mesh> mesh);
+
+    /* Convex hull of a point cloud, e.g. a part of a convex decomposition */
+    MeshCollider(const std::vector<vec3>& points, size_t maxHullVertices = 0);
     
     void setGeometry(Ref<Geometry> geometry);
     void setRelativePos(const vec3& pos) override;
@@ -83,11 +220,97 @@ struct MeshCollider : public Collider {
     void updateGlobalPose(const Pose& pose) override;
 
     vec3 findFurthestPoint(const vec3& dir) const override;
+    void findSupportFeature(const vec3& dir, SupportFeature& feature) const override;
+    bool findSupportFace(const vec3& dir, SupportFeature& face) const override;
+
+    vec3 findInteriorPoint() const override {
+        return localToWorld(m_localCentroid);
+    }
+
+    inline vec3 localToWorld(const vec3& v) const {
+        return (m_pose.q * v) + m_pose.p;
+    }
+
+    inline vec3 worldToLocal(const vec3& v) const {
+        return glm::conjugate(m_pose.q) * (v - m_pose.p);
+    }
+
+    /**
+     * @brief Calls `visit(triangle)` with the index of each triangle whose
+     * bounds (or leaf, once the tree is built) overlap a body space box.
+     */
+    template <typename Visitor>
+    void forEachTriangle(const AABB& bounds, Visitor&& visit) const {
+
+        if (m_bvhReady.load(std::memory_order_acquire)) {
+            AABB shifted;
+            shifted.set(bounds.min - m_bvhOffset, bounds.max - m_bvhOffset);
+
+            m_bvh.query(shifted, [&](uint32_t triangle) { visit(triangle); });
+            return;
+        }
+
+        for (size_t i = 0; i < m_triangles.size(); i++) {
+            const auto& tri = m_triangles[i];
+
+            AABB aabb;
+            aabb.set(
+                glm::min(tri[0], glm::min(tri[1], tri[2])),
+                glm::max(tri[0], glm::max(tri[1], tri[2]))
+            );
+
+            if (aabb.intersects(bounds))
+                visit(uint32_t(i));
+        }
+    }
+
+    /**
+     * @brief Closest triangle hit along a ray.
+     * @param origin World space
+     * @param dir World space, unit length
+     * @param distance Distance to the hit along the ray
+     * @param normal World space normal of the hit triangle
+     */
+    bool raycast(const vec3& origin, const vec3& dir, float& distance, vec3& normal) const;
+
+private:
+
+    /**
+     * The tree keeps the bounds it was built with, setRelativePos() only
+     * moves the triangles. Queries are shifted by m_bvhOffset instead.
+     */
+    TriangleBVH m_bvh;
+    std::future<void> m_bvhBuild;
+    std::atomic<bool> m_bvhReady = false;
+    vec3 m_bvhOffset = vec3(0.0f);
+
+    void buildShape();
+    void buildBVH();
+    void buildSupportGraph();
+    void buildFaces(const std::vector<std::array<unsigned int, 3>>& surface, float tolerance, bool isHull);
+    void updateLocalBounds();
     
 };
 
+/**
+ * Oriented box. Keeps the mesh of MeshCollider for faces and raycasts, but
+ * the support function and the box / plane / sphere tests are analytic.
+ */
 struct BoxCollider : public MeshCollider {
     vec3 m_size = vec3(1.0f, 1.0f, 1.0f);
+    vec3 m_halfSize = vec3(0.5f, 0.5f, 0.5f);
+
     BoxCollider(float size = 1.0f);
     BoxCollider(const vec3 &size = { 1.0f, 1.0f, 1.0f });
+
+    vec3 findFurthestPoint(const vec3& dir) const override;
+
+    /* Center and axes, world space */
+    inline vec3 getCenter() const { return m_relativePosW; }
+    inline vec3 getAxis(int i) const {
+        vec3 axis = vec3(0.0f);
+        axis[i] = 1.0f;
+
+        return m_pose.q * axis;
+    }
 };
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+class RigidBody;
+
+/**
+ * Collision layer bits. A body is on one or more layers and has a mask of
+ * the layers it collides with. Game specific layers start at USER.
+ */
+namespace CollisionLayer {
+    constexpr uint32_t NONE     = 0;
+    constexpr uint32_t DEFAULT  = 1u << 0;
+    constexpr uint32_t VEHICLE  = 1u << 1;
+    constexpr uint32_t WHEEL    = 1u << 2;
+    constexpr uint32_t DEBRIS   = 1u << 3;
+    constexpr uint32_t TRIGGER  = 1u << 4;
+    constexpr uint32_t USER     = 1u << 8;
+    constexpr uint32_t ALL      = 0xFFFFFFFFu;
+}
+
+/**
+ * @brief Whether two bodies may collide: each must be on a layer in the other's mask.
+ */
+inline bool layersCollide(
+    uint32_t layerA, uint32_t maskA,
+    uint32_t layerB, uint32_t maskB
+) {
+    return (layerA & maskB) && (layerB & maskA);
+}
+
+/**
+ * Filter for scene queries such as raycasts.
+ */
+struct QueryFilter {
+    uint32_t mask = CollisionLayer::ALL;    /* Layers that can be hit */
+    const RigidBody* ignore = nullptr;      /* Body to skip, e.g. the one casting the ray */
+
+    inline bool accepts(uint32_t layer, const RigidBody* body) const {
+        return (layer & mask) && body != ignore;
+    }
+};
@@ -2,10 +2,15 @@
 
 #include "phys/RigidBody.h"
 
+struct PairState;
+
 struct CollisionPair {
     RigidBody* A = nullptr;
     RigidBody* B = nullptr;
 
+    /* Persistent narrow phase state, linked by PairCache::beginStep() */
+    PairState* state = nullptr;
+
     CollisionPair(
         RigidBody* A, 
         RigidBody* B
@@ -13,10 +18,15 @@ struct CollisionPair {
 
         assert(A != nullptr);
         assert(B != nullptr);
+    }
 
+    /**
+     * Wake sleeping bodies if a collision could occur.
+     * Not thread safe - the broadphase calls this in its serial pass.
+     */
+    inline void wakeIfApproaching() {
         const float vrel = glm::length2(A->vel - B->vel);
-        
-        /* Wake sleeping bodies if a collision could occur */
+
         if (vrel > 0.01f) {
             A->wake();
             B->wake();
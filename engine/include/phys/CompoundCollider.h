@@ -0,0 +1,46 @@
+#pragma once
+
+#include "phys/Collider.h"
+
+#include <vector>
+
+/**
+ * Several shapes on one body, e.g. the convex parts of a concave object
+ * (see ConvexDecomposition). Each child has a pose relative to the body.
+ *
+ * The bounds of the compound are the union of those of its children, so
+ * the broadphase keeps a single proxy per body. The narrow phase only
+ * tests the children whose bounds overlap the other collider (mid-phase),
+ * and merges their contacts into one manifold.
+ */
+struct CompoundCollider : public Collider {
+
+    struct Child {
+        Ref<Collider> collider;
+        Pose pose;                  /* Relative to the body */
+    };
+
+    std::vector<Child> m_children;
+
+    CompoundCollider();
+    CompoundCollider(const std::vector<Child>& children);
+
+    /* Any collider but planes and other compounds */
+    void addChild(Ref<Collider> collider, const Pose& pose = Pose());
+
+    void setRelativePos(const vec3& pos) override;
+    void expandAABB(float scalar = 0.0f) override;
+    void updateGlobalPose(const Pose& pose) override;
+
+    /**
+     * @brief Calls `visit(index, const Child&)` for each child whose bounds
+     * overlap a world space box.
+     */
+    template <typename Visitor>
+    void forEachChild(const AABB& bounds, Visitor&& visit) const {
+        for (size_t i = 0; i < m_children.size(); i++) {
+            if (m_children[i].collider->m_aabb.intersects(bounds))
+                visit(i, static_cast<const Child&>(m_children[i]));
+        }
+    }
+};
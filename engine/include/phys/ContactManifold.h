@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common/glm.h"
+#include "phys/Collider.h"
+#include "phys/GjkEpa.h"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Multi-point contact manifolds for convex pairs.
+ *
+ * EPA only finds the deepest point. Here, the support features of both
+ * shapes along the EPA normal are turned into polygons, the incident one
+ * is clipped against the side planes of the reference face (the one most
+ * aligned with the normal), and the points below the reference face are
+ * reduced to at most MAX_POINTS contacts.
+ */
+namespace ContactManifold {
+
+    constexpr size_t MAX_POINTS = 4;
+
+    struct Point {
+        vec3 p1 = vec3(0.0f);   /* On A */
+        vec3 p2 = vec3(0.0f);   /* On B */
+
+        /* From A towards B. Same as the manifold normal, except on triangle meshes */
+        vec3 normal = vec3(0.0f);
+        float d = 0.0f;         /* Penetration depth along the normal */
+
+        /* Feature pair the point came from, stays the same across steps */
+        uint32_t id = 0;
+    };
+
+    struct Manifold {
+        vec3 normal = vec3(0.0f);   /* EPA normal (or the deepest point's), from A towards B */
+
+        /* Clipping keeps MAX_POINTS, shapes resting on a plane may keep more */
+        std::array<Point, SupportFeature::MAX_POINTS> points;
+        size_t size = 0;
+    };
+
+    /**
+     * @brief Builds the manifold of two overlapping colliders from their
+     * EPA result. Falls back to the EPA point for vertex and edge-edge
+     * contacts, or when clipping leaves nothing.
+     * @param margin Points up to this far above the reference face are
+     * kept too (with d ≤ 0), for manifolds that are reused. Separated
+     * shapes (a contact with d ≤ 0, from their closest points) get only
+     * such points.
+     */
+    void generate(
+        Collider* colliderA,
+        Collider* colliderB,
+        const GjkEpa::Contact& contact,
+        Manifold& manifold,
+        float margin = 0.0f
+    );
+
+    /**
+     * @brief Moves the points that span the largest contact area to the
+     * front: the deepest one, the one furthest from it, then the points
+     * that grow the polygon the most. Also used to thin out mesh-plane
+     * contacts.
+     * @param normal Contact normal, the area is measured in its plane.
+     * @param maxPoints At most 16
+     * @return Number of points kept, at most `maxPoints`
+     */
+    size_t reduce(
+        Point* points,
+        size_t count,
+        const vec3& normal,
+        size_t maxPoints = MAX_POINTS
+    );
+};
@@ -35,6 +35,11 @@ struct ContactSet {
     float lambda_n = 0.0f;
     float lambda_t = 0.0f;
 
+    uint32_t id = 0;    /* Feature pair of the point, see ContactManifold */
+
+    /* Found while the shapes were still apart (d ≤ 0), only solved once the gap closes */
+    bool speculative = false;
+
     ContactSet(
         RigidBody* A, 
         RigidBody* B,
@@ -90,4 +95,19 @@ struct ContactSet {
         /* (3.5) Penetration depth */
         d = - dot((p1 - p2), n);
     }
+
+    /**
+     * @brief Prepares a contact of a previous substep to be solved again.
+     * The anchors (r1, r2) and normal are kept, the rest is recalculated.
+     */
+    inline void refresh() {
+        this->update();
+
+        /* (29) Relative velocity, see constructor */
+        vrel = A->getVelocityAt(p1) - B->getVelocityAt(p2);
+        vn = dot(n, vrel);
+
+        lambda_n = 0.0f;
+        lambda_t = 0.0f;
+    }
 };
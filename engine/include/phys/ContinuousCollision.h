@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common/glm.h"
+#include "phys/RigidBody.h"
+#include "phys/Pose.h"
+
+/**
+ * Continuous collision detection for fast bodies (see
+ * RigidBody::continuousCollision).
+ *
+ * Contacts are only found once shapes overlap, so a body that moves
+ * further than its own thickness in one substep can pass through thin
+ * geometry. Two things prevent that:
+ *
+ * - Speculative contacts: pairs with a fast body are queried with a margin
+ *   as large as their relative motion in a substep, separated shapes
+ *   within it get contacts with d ≤ 0. The position solve only acts on
+ *   them once the gap is closed, see XPBDSolver::getContacts().
+ *
+ * - Time of impact: after integration, the motion of the substep is swept
+ *   with conservative advancement. If the shapes would have touched
+ *   somewhere along it, the bodies are moved back to that time (motion
+ *   clamping). The rest of the motion of that substep is lost, this is
+ *   the fallback for what the speculative contacts missed.
+ *
+ * Conservative advancement: the distance d between the shapes and an
+ * upper bound v of how fast any point can approach along the normal
+ * give a time d / v that they can safely move ahead. Repeating this
+ * converges to the time of impact from below.
+ *
+ * Based on "Impulse-based Dynamic Simulation of Rigid Body Systems"
+ * (Mirtich, 1996) and "Continuous Collision" (Erwin Coumans, GDC 2014)
+ */
+namespace ContinuousCollision {
+
+    /* Interpolates between two poses, rotating at a constant angular velocity */
+    Pose interpolate(const Pose& from, const Pose& to, float t);
+
+    /**
+     * @brief First time (0 to 1) at which the bodies touch while they move
+     * from prevPose to pose. Anything Narrowphase::distance() supports,
+     * heightfields and concave meshes rely on speculative contacts.
+     * Expects the colliders at prevPose (as they are between the
+     * integration and the update of a substep), and leaves them there.
+     * @param tolerance Distance that counts as touching
+     * @param t Time of impact
+     * @return false if they don't touch, already touched at the start, or
+     * the pair of types is not supported
+     */
+    bool timeOfImpact(
+        RigidBody* A,
+        RigidBody* B,
+        float tolerance,
+        float& t
+    );
+};
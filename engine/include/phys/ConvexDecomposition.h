@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common/glm.h"
+#include "common/ref.h"
+
+#include "geom/Geometry.h"
+#include "phys/CompoundCollider.h"
+
+#include <vector>
+
+/**
+ * Approximate convex decomposition of a concave mesh, for dynamic bodies
+ * that a single hull would fit poorly.
+ *
+ * Like V-HACD, the mesh is voxelized (surface, then the inside is filled),
+ * and parts are cut recursively by the axis aligned plane that leaves the
+ * least concavity, i.e. hull volume not covered by voxels. Cutting stops
+ * once a part is nearly convex. If that leaves too many parts, the
+ * neighbours whose merged hull adds the least volume are joined again.
+ *
+ * Hulls are built on voxel corners, so parts stick out of the surface by
+ * up to one voxel. This is meant to run at load time (or offline), the
+ * cost grows with the cube of the resolution.
+ *
+ * Based on "Volumetric Hierarchical Approximate Convex Decomposition"
+ * (Khaled Mamou, Game Engine Gems 3)
+ */
+namespace ConvexDecomposition {
+
+    struct Params {
+        size_t resolution = 40;         /* Voxels along the longest side of the mesh */
+        float maxConcavity = 0.02f;     /* Relative to the volume of the mesh */
+        size_t maxHulls = 16;
+        size_t maxDepth = 6;            /* Cuts per part, i.e. at most 2^maxDepth parts before merging */
+        size_t planeSamples = 6;        /* Candidate cuts per axis */
+        size_t maxHullVertices = 32;    /* Per part, 0 for no limit */
+    };
+
+    /**
+     * @brief Splits a triangle mesh into convex parts.
+     * @param indices Triangle list, best closed so the inside can be filled
+     * @return Hull vertices of each part, in the space of the mesh
+     */
+    std::vector<std::vector<vec3>> decompose(
+        const std::vector<vec3>& vertices,
+        const std::vector<unsigned int>& indices,
+        const Params& params = {}
+    );
+
+    /* The parts of a render mesh, as convex children of a single collider */
+    Ref<CompoundCollider> createCompound(Ref<Geometry> geometry, const Params& params = {});
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common/glm.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Convex hull of a point set (quickhull).
+ *
+ * Starts from the largest tetrahedron spanned by the extreme points, then
+ * repeatedly adds the point furthest outside of the hull: the faces it
+ * sees are removed and the hole is closed with a fan of triangles from
+ * the point to the horizon. Points are only ever tested against the faces
+ * they are assigned to (their 'outside set'), which makes this O(n log n)
+ * in practice.
+ *
+ * Adding the furthest point first also makes the hull a good
+ * simplification when it is stopped early at a vertex budget: the result
+ * is the convex hull of its vertices, lying inside of the full hull.
+ *
+ * Based on "Implementing Quickhull" (Dirk Gregorius, GDC 2014) and
+ * "The Quickhull Algorithm for Convex Hulls" (Barber, Dobkin, Huhdanpaa)
+ */
+class ConvexHull {
+public:
+
+    /* Hull vertices, as indices into the input points, ascending */
+    std::vector<unsigned int> m_vertices;
+
+    /* Counter-clockwise around their outward normal, indices into the input points */
+    std::vector<std::array<unsigned int, 3>> m_triangles;
+
+    ConvexHull() = default;
+
+    /**
+     * @brief Builds the hull, replacing the previous one.
+     * @param points Positions
+     * @param candidates Indices of the points to build the hull of, unique
+     * @param tolerance Points this close to a face count as inside of it
+     * @param maxVertices Stops adding points at this many vertices, 0 for no limit
+     * @return false if the points are (nearly) coplanar, the hull is left empty
+     */
+    bool build(
+        const std::vector<vec3>& points,
+        const std::vector<unsigned int>& candidates,
+        float tolerance,
+        size_t maxVertices = 0
+    );
+};
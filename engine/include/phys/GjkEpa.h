@@ -5,6 +5,8 @@
 #include "phys/Simplex.h"
 #include "phys/Support.h"
 
+#include <array>
+#include <cfloat>
 #include <vector>
 
 namespace GjkEpa {
@@ -27,13 +29,66 @@ namespace GjkEpa {
         ): normal(normal), p1(p1), p2(p2), d(d), exists(exists) {}
     };
 
+    /**
+     * GJK state of a pair, carried over to the next query. The simplex is
+     * kept as the search directions its vertices were found with, so it
+     * can be evaluated again after the shapes moved.
+     */
+    struct GjkCache {
+        vec3 separatingAxis = vec3(0.0f);   /* Zero if the shapes overlapped */
+
+        std::array<vec3, 4> directions;     /* Of the simplex that contained the origin */
+        unsigned size = 0;
+
+        /* Counters, reset by the owner */
+        size_t queries = 0;
+        size_t iterations = 0;
+        size_t warmHits = 0;                /* Queries answered by the cache alone */
+    };
+
+    /* Result of closestPoints() */
+    struct ClosestPoints {
+        bool overlapping = false;   /* The points and normal are meaningless then */
+
+        float distance = 0.0f;
+        vec3 p1 = vec3(0.0f);       /* On A */
+        vec3 p2 = vec3(0.0f);       /* On B */
+        vec3 normal = vec3(0.0f);   /* From A towards B */
+
+        unsigned iterations = 0;
+    };
+
     inline bool sameDirection(vec3 direction, vec3 ao) {
         return glm::dot(direction, ao) > 0;
     }
 
+    /**
+     * @brief Runs GJK, warm started from `cache` if given.
+     *
+     * If the cached axis still separates the shapes, or the cached simplex
+     * still contains the origin, this costs one or four support queries.
+     * Otherwise the search continues from what was evaluated. The cache is
+     * updated with the result.
+     */
     Simplex GJK(
         Collider* colliderA,
-        Collider* colliderB
+        Collider* colliderB,
+        GjkCache* cache = nullptr
+    );
+
+    /**
+     * @brief Distance and closest points of two convex shapes (GJK in its
+     * distance mode). The point of the Minkowski difference closest to the
+     * origin is found on the simplex with Johnson's sub-algorithm (Voronoi
+     * regions), its barycentric coordinates give the points on A and B.
+     *
+     * @param maxDistance Stops as soon as the shapes are known to be
+     * further apart, the distance is then only a lower bound.
+     */
+    ClosestPoints closestPoints(
+        Collider* colliderA,
+        Collider* colliderB,
+        float maxDistance = FLT_MAX
     );
 
     /**
@@ -66,30 +121,46 @@ namespace GjkEpa {
     );
 
     /**
-     * EPA algorithm
+     * EPA algorithm, expands the GJK simplex (which has to contain the
+     * origin) to find the penetration normal and depth. Doesn't allocate,
+     * the polytope lives in fixed size buffers on the stack.
      * 
      * https://github.com/IainWinter/IwEngine/blob/master/IwEngine/src/physics/impl/GJK.cpp
+     *
+     * @param iterations Expansion steps taken, if given
      */
     Contact EPA(
         const Simplex& simplex,
         Collider* colliderA,
-        Collider* colliderB
-    );
-
-    vec3 computeBarycentricCoordinates(
-        const vec3& P, 
-        const std::vector<Support>& polygon
+        Collider* colliderB,
+        unsigned* iterations = nullptr
     );
 
-    std::tuple<std::vector<vec4>, size_t, std::vector<Support>> getFaceNormals(
-		const std::vector<Support>& polytope,
-		const std::vector<size_t>& faces
+    /**
+     * Minkowski Portal Refinement, an alternative to EPA. Casts a ray from
+     * a point inside of the Minkowski difference (the difference of the
+     * interior points of the shapes) through the origin, and refines the
+     * triangle it leaves through (the portal) until that lies on the
+     * boundary. Only keeps four points, but finds the face along that ray
+     * instead of the closest one, so deep or off-center contacts can get
+     * a different normal than from EPA.
+     *
+     * "XenoCollide" (Gary Snethen, Game Programming Gems 7)
+     *
+     * @param iterations Support queries made, if given
+     */
+    Contact MPR(
+        Collider* colliderA,
+        Collider* colliderB,
+        unsigned* iterations = nullptr
     );
 
-    void addIfUniqueEdge(
-        std::vector<std::pair<size_t, size_t>>& edges,
-        const std::vector<size_t>& faces,
-        size_t a,
-        size_t b
+    /**
+     * Barycentric coordinates of P projected onto the triangle. Slivers
+     * give the closest point on their longest edge instead.
+     */
+    vec3 computeBarycentricCoordinates(
+        const vec3& P, 
+        const std::array<Support, 3>& polygon
     );
 };
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "phys/Collider.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Terrain: a regular grid of heights in the XZ plane of the body, quantized
+ * to 16 bits (height = m_heightOffset + m_heightScale * sample). The grid
+ * is centered on the body, each cell is split into two triangles along the
+ * diagonal from its (0, 0) to its (1, 1) corner.
+ *
+ * Cells are found by dividing by the cell size, so contacts and raycasts
+ * only visit the cells under a shape or along a ray.
+ */
+struct HeightfieldCollider : public Collider {
+
+    size_t m_columns = 0;           /* Samples along X */
+    size_t m_rows = 0;              /* Samples along Z */
+    vec2 m_cellSize = vec2(1.0f);   /* Sample spacing along X and Z */
+
+    std::vector<uint16_t> m_samples;    /* Row major, m_rows * m_columns */
+    float m_heightScale = 1.0f;
+    float m_heightOffset = 0.0f;
+
+    /* Body space position of sample (0, 0), including the relative position */
+    vec3 m_origin = vec3(0.0f);
+
+    Pose m_pose;
+    AABB m_localAabb;
+
+    /**
+     * Surface triangle, body space. Corners are counter-clockwise seen
+     * from above, the normal points up.
+     */
+    struct Triangle {
+        std::array<vec3, 3> points;
+        vec3 normal;
+        uint32_t id;                /* 2 * cell + half, stable */
+    };
+
+    /**
+     * @param heights Row major, `columns * rows` values, quantized to 16 bits
+     * @param cellSize Sample spacing along X and Z
+     */
+    HeightfieldCollider(
+        size_t columns,
+        size_t rows,
+        const std::vector<float>& heights,
+        const vec2& cellSize = vec2(1.0f)
+    );
+
+    /* Already quantized samples, height = heightOffset + heightScale * sample */
+    HeightfieldCollider(
+        size_t columns,
+        size_t rows,
+        std::vector<uint16_t> samples,
+        float heightScale,
+        float heightOffset,
+        const vec2& cellSize = vec2(1.0f)
+    );
+
+    void setRelativePos(const vec3& pos) override;
+    void expandAABB(float scalar = 0.0f) override;
+    void updateGlobalPose(const Pose& pose) override;
+
+    inline float getHeight(size_t column, size_t row) const {
+        return m_heightOffset + m_heightScale * float(m_samples[row * m_columns + column]);
+    }
+
+    inline vec3 getPoint(size_t column, size_t row) const {
+        return m_origin + vec3(float(column) * m_cellSize.x, getHeight(column, row), float(row) * m_cellSize.y);
+    }
+
+    inline vec3 localToWorld(const vec3& v) const {
+        return (m_pose.q * v) + m_pose.p;
+    }
+
+    inline vec3 worldToLocal(const vec3& v) const {
+        return glm::conjugate(m_pose.q) * (v - m_pose.p);
+    }
+
+    /**
+     * @brief Cell under a body space point, clamped to the grid.
+     * @return false if (x, z) is outside of the grid
+     */
+    bool findCell(float x, float z, size_t& column, size_t& row) const;
+
+    /**
+     * @brief Surface triangle under a body space point, O(1).
+     * @return false if the point is outside of the grid
+     */
+    bool findTriangle(const vec3& point, Triangle& triangle) const;
+
+    /* One of the two triangles of a cell */
+    void getTriangle(size_t column, size_t row, int half, Triangle& triangle) const;
+
+    /**
+     * @brief Calls `visit(const Triangle&)` for the triangles of the cells
+     * overlapping a body space box (only X and Z are used).
+     */
+    template <typename Visitor>
+    void forEachTriangle(const vec3& min, const vec3& max, Visitor&& visit) const {
+
+        if (m_columns < 2 || m_rows < 2)
+            return;
+
+        const vec3 from = (min - m_origin);
+        const vec3 to = (max - m_origin);
+
+        const float lastColumn = float(m_columns - 2);
+        const float lastRow = float(m_rows - 2);
+
+        if (to.x < 0.0f || to.z < 0.0f || from.x > (lastColumn + 1.0f) * m_cellSize.x || from.z > (lastRow + 1.0f) * m_cellSize.y)
+            return;
+
+        const size_t c0 = size_t(std::clamp(std::floor(from.x / m_cellSize.x), 0.0f, lastColumn));
+        const size_t c1 = size_t(std::clamp(std::floor(to.x / m_cellSize.x), 0.0f, lastColumn));
+        const size_t r0 = size_t(std::clamp(std::floor(from.z / m_cellSize.y), 0.0f, lastRow));
+        const size_t r1 = size_t(std::clamp(std::floor(to.z / m_cellSize.y), 0.0f, lastRow));
+
+        Triangle triangle;
+
+        for (size_t row = r0; row <= r1; row++) {
+            for (size_t column = c0; column <= c1; column++) {
+                for (int half = 0; half < 2; half++) {
+                    getTriangle(column, row, half, triangle);
+                    visit(static_cast<const Triangle&>(triangle));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Walks the cells along a ray (DDA) and returns the first hit.
+     * @param origin World space
+     * @param dir World space, unit length
+     * @param distance Distance to the hit along the ray
+     * @param normal World space normal of the hit triangle
+     */
+    bool raycast(const vec3& origin, const vec3& dir, float& distance, vec3& normal) const;
+
+private:
+
+    void updateLocalBounds();
+};
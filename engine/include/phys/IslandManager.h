@@ -0,0 +1,130 @@
+#pragma once
+
+#include "phys/RigidBody.h"
+#include "phys/Constraint.h"
+#include "phys/CollisionPair.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Bodies that are connected through contacts or constraints, directly or
+ * through other bodies. The members of an island are ranges in the flat
+ * lists of IslandManager, in ascending body / pair / constraint order.
+ * No two islands share a body that can move, so they can be solved in
+ * parallel.
+ */
+struct Island {
+    uint32_t firstBody = 0;
+    uint32_t bodyCount = 0;
+
+    uint32_t firstPair = 0;
+    uint32_t pairCount = 0;
+
+    uint32_t firstConstraint = 0;
+    uint32_t constraintCount = 0;
+};
+
+/**
+ * Simulation islands, found with union-find once per step.
+ *
+ * The nodes are the awake dynamic bodies, the edges the collision pairs
+ * and constraints between them. Static and sleeping bodies don't connect
+ * anything, so a floor doesn't merge everything on it into one island.
+ *
+ * Islands sleep as a unit, once every body in them rested for long enough
+ * (RigidBody::isResting()). The members are remembered, waking any of
+ * them wakes the whole island. Sleeping islands have no pairs (the
+ * broadphase skips pairs of bodies that can't move) and take no part in
+ * the step at all.
+ *
+ * Sleeping bodies that an awake island touches are woken for the next
+ * step. Until then they act as static bodies.
+ */
+class IslandManager {
+public:
+
+    IslandManager() = default;
+    ~IslandManager() = default;
+
+    /**
+     * @brief Wakes the sleeping islands that have an awake member, e.g.
+     * after RigidBody::wake(), applyForce() or a pair that wakes its
+     * bodies (CollisionPair::wakeIfApproaching()). Sleeping bodies joined
+     * to an awake one by a constraint wake up as well.
+     * @return Whether any island woke up, pairs collected before are stale
+     */
+    bool wakeIslands(const std::vector<Ref<Constraint>>& constraints);
+
+    /**
+     * @brief Finds the islands of this step.
+     * @param bodies Indexed by RigidBody::id
+     */
+    void build(
+        const std::vector<Ref<RigidBody>>& bodies,
+        const std::vector<CollisionPair>& collisions,
+        const std::vector<Ref<Constraint>>& constraints
+    );
+
+    /**
+     * @brief Puts the islands whose bodies all rest to sleep, and wakes the
+     * sleeping bodies that awake islands touched (see PairState). Runs
+     * after the substeps.
+     */
+    void updateSleep(const std::vector<CollisionPair>& collisions);
+
+    inline const std::vector<Island>& getIslands() const { return m_islands; }
+
+    /* Awake dynamic bodies, grouped by island */
+    inline const std::vector<RigidBody*>& getBodies() const { return m_bodies; }
+
+    /* Members of an island, the pairs and constraints are those of build() */
+    inline std::span<RigidBody* const> getBodies(const Island& island) const {
+        return { m_bodies.data() + island.firstBody, island.bodyCount };
+    }
+
+    inline std::span<const CollisionPair> getPairs(const Island& island) const {
+        return { m_pairs.data() + island.firstPair, island.pairCount };
+    }
+
+    inline std::span<Constraint* const> getConstraints(const Island& island) const {
+        return { m_constraints.data() + island.firstConstraint, island.constraintCount };
+    }
+
+    /* Bodies, pairs and constraints, a rough measure of the work to solve it */
+    static inline size_t getCost(const Island& island) {
+        return size_t(island.bodyCount) + island.pairCount + island.constraintCount;
+    }
+
+    inline size_t getSleepingIslandCount() const { return m_sleeping.size(); }
+
+    void clear();
+
+private:
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /* Union-find forest over the body ids */
+    std::vector<uint32_t> m_parent;
+
+    /* Island of each body id, NONE for static and sleeping bodies */
+    std::vector<uint32_t> m_bodyIsland;
+
+    std::vector<Island> m_islands;
+    std::vector<RigidBody*> m_bodies;
+    std::vector<CollisionPair> m_pairs;
+    std::vector<Constraint*> m_constraints;
+
+    /* Scratch of build(), items in island order */
+    std::vector<uint32_t> m_order;
+
+    /* Members of each sleeping island */
+    std::vector<std::vector<RigidBody*>> m_sleeping;
+
+    uint32_t find(uint32_t body);
+    void unite(uint32_t a, uint32_t b);
+
+    /* Island that owns a pair or constraint (bodies may be null), NONE if neither body is awake */
+    uint32_t islandOf(const RigidBody* A, const RigidBody* B) const;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "common/glm.h"
+#include "phys/Collider.h"
+#include "phys/ContactManifold.h"
+#include "phys/GjkEpa.h"
+
+/**
+ * Narrow phase: finds the contacts of a pair of colliders.
+ *
+ * Each pair of collider types has its own test in a dispatch table. Pairs
+ * of primitives (spheres, capsules, boxes, planes) use closed-form tests,
+ * everything convex that has no dedicated test falls back to GJK / EPA (or
+ * MPR, see setPenetrationSolver()) and ContactManifold::generate(). Heightfields and concave meshes are tested
+ * one nearby triangle at a time, compounds one overlapping child at a
+ * time. A test registered for (a, b) also handles (b, a), the manifold is
+ * flipped to match.
+ */
+namespace Narrowphase {
+
+    struct Query {
+        GjkEpa::GjkCache* gjk = nullptr;    /* Warm start for GJK, if any */
+
+        /* Points up to this far apart are kept as well (with d ≤ 0) */
+        float margin = 0.0f;
+
+        /**
+         * Separated convex shapes within the margin get contacts as well,
+         * from their closest points. Costs a distance query per pair, the
+         * primitive tests already honour the margin.
+         */
+        bool speculative = false;
+
+        /* Most contacts kept when a shape rests on a plane, at most 16 */
+        size_t maxPlanePoints = ContactManifold::MAX_POINTS;
+    };
+
+    /**
+     * Fills the manifold (normal from A towards B) and returns whether the
+     * colliders are closer than the margin.
+     */
+    using PairTest = bool (*)(
+        Collider* colliderA,
+        Collider* colliderB,
+        const Query& query,
+        ContactManifold::Manifold& manifold
+    );
+
+    /**
+     * @brief Runs the test for the types of A and B.
+     * @return false if they don't touch, or if the pair is not supported
+     */
+    bool collide(
+        Collider* colliderA,
+        Collider* colliderB,
+        const Query& query,
+        ContactManifold::Manifold& manifold
+    );
+
+    /* Whether there is a test for this pair of types (in either order) */
+    bool hasPairTest(ColliderType a, ColliderType b);
+
+    /* Finds the depth and normal once GJK reports an overlap */
+    enum class PenetrationSolver {
+        EPA,    /* Expanding polytope, the default */
+        MPR,    /* Minkowski portal refinement, cheaper for deep contacts but not always the shallowest direction */
+    };
+
+    /**
+     * @brief Selects the penetration solver of the GJK based tests for a
+     * pair of types (in either order). Has no effect on pairs with a
+     * closed-form test. Not thread safe, set it up before stepping.
+     */
+    void setPenetrationSolver(ColliderType a, ColliderType b, PenetrationSolver solver);
+
+    PenetrationSolver getPenetrationSolver(ColliderType a, ColliderType b);
+
+    /**
+     * @brief Distance and closest points of two colliders: GJK in distance
+     * mode for convex shapes, the closest child of a compound, planes
+     * directly. Unlike collide(), nothing is computed past the surface, so
+     * separated pairs never pay for EPA.
+     * @param maxDistance Pairs further apart may stop early with a lower
+     * bound, see GjkEpa::closestPoints()
+     * @return false for heightfields and concave meshes
+     */
+    bool distance(
+        Collider* colliderA,
+        Collider* colliderB,
+        float maxDistance,
+        GjkEpa::ClosestPoints& result
+    );
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "common/glm.h"
+#include "phys/RigidBody.h"
+#include "phys/CollisionPair.h"
+#include "phys/ContactSet.h"
+#include "phys/GjkEpa.h"
+#include "phys/Pose.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+enum class ContactEventType {
+    BEGIN,      /* The bodies started touching during this step */
+    PERSIST,    /* The bodies were already touching and still are */
+    END         /* The bodies stopped touching */
+};
+
+struct ContactEvent {
+    ContactEventType type;
+
+    RigidBody* A = nullptr;
+    RigidBody* B = nullptr;
+
+    /* Fastest contact of the last manifold, not set for END events */
+    vec3 point = vec3(0.0f);
+    vec3 normal = vec3(0.0f);
+    float speed = 0.0f;         /* Relative normal velocity before the solve */
+};
+
+/**
+ * Narrow phase state of a pair of bodies, kept across steps for as long
+ * as the broadphase keeps reporting the pair.
+ */
+struct PairState {
+    RigidBody* A = nullptr;
+    RigidBody* B = nullptr;
+
+    /* Warm start for the next GJK query, counters are reset every step */
+    GjkEpa::GjkCache gjk;
+
+    /* Contacts of the last substep in which the bodies touched */
+    std::vector<Ref<ContactSet>> manifold = {};
+
+    /* The manifold was generated during this step and may be reused */
+    bool hasManifold = false;
+    int manifoldAge = 0;            /* Substeps since it was generated */
+
+    /* Centre of the manifold in the frame of A and B, and the rotation of
+     * B relative to A, when the manifold was generated */
+    vec3 manifoldAnchorA = vec3(0.0f);
+    vec3 manifoldAnchorB = vec3(0.0f);
+    quat manifoldRotation = quat(1.0f, 0, 0, 0);
+
+    bool isTouching = false;        /* Touching at the end of the previous step */
+    bool touchedThisStep = false;   /* Set by the narrow phase */
+};
+
+/* GJK counters of one step, summed over all pairs */
+struct GjkStats {
+    size_t queries = 0;
+    size_t iterations = 0;      /* Support queries */
+    size_t warmHits = 0;        /* Queries answered by the cached axis or simplex */
+};
+
+/**
+ * Persistent table of collision pairs, keyed by the body id pair.
+ *
+ * Each step, the broadphase pairs are linked to their state in this table
+ * (CollisionPair::state). After the substeps, the touching state is
+ * compared to the previous step to generate begin / persist / end events
+ * which are dispatched to the subscribed listeners.
+ *
+ * Pairs of sleeping (or static) bodies drop out of the broadphase. Their
+ * state is kept frozen, so resting contacts don't report an end event when
+ * the bodies fall asleep.
+ */
+class PairCache {
+public:
+
+    using Listener = std::function<void(const ContactEvent&)>;
+
+    PairCache() = default;
+    ~PairCache() = default;
+
+    /**
+     * @brief Syncs the table with the pairs of this step. Adds new pairs,
+     * drops the ones that are gone and links every pair to its state.
+     */
+    void beginStep(std::vector<CollisionPair>& collisions);
+
+    /**
+     * @brief Updates the touching state of every pair and dispatches
+     * the contact events of this step.
+     */
+    void endStep(const std::vector<CollisionPair>& collisions);
+
+    /**
+     * @brief Calls `listener` for every contact event, once per step.
+     * @return Handle that can be passed to unsubscribe()
+     */
+    size_t subscribe(Listener listener);
+    void unsubscribe(size_t handle);
+
+    /** @brief Returns the state of a pair, or nullptr if it is not in the table */
+    PairState* find(const RigidBody* A, const RigidBody* B);
+
+    /** @brief Events of the last step, for systems that prefer polling */
+    inline const std::vector<ContactEvent>& getEvents() const { return m_events; }
+
+    inline size_t size() const { return m_pairs.size(); }
+
+    GjkStats getGjkStats() const;
+
+    void clear();
+
+private:
+
+    /* Element references stay valid on rehash, so CollisionPair can point into it */
+    std::unordered_map<uint64_t, PairState> m_pairs;
+
+    std::vector<std::pair<size_t, Listener>> m_listeners;
+    size_t m_nextHandle = 0;
+
+    std::vector<ContactEvent> m_events;
+
+    void addEvent(ContactEventType type, const PairState& state);
+
+    static inline uint64_t pairKey(const RigidBody* A, const RigidBody* B) {
+        uint64_t a = A->id;
+        uint64_t b = B->id;
+
+        if (a > b) std::swap(a, b);
+
+        return (a << 32) | b;
+    }
+};
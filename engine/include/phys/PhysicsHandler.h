@@ -2,6 +2,11 @@
 
 #include "phys/RigidBody.h"
 #include "phys/Constraint.h"
+#include "phys/Broadphase.h"
+#include "phys/PairCache.h"
+#include "phys/IslandManager.h"
+#include "phys/broadphase/AABBTreeBroadphase.h"
+#include "util/WorkerPool.h"
 #include "component/Mesh.h"
 
 #include <vector>
@@ -14,11 +19,25 @@ struct RaycastInfo {
     float dist = 0.0f;
 };
 
+struct DistanceInfo {
+    bool exists = false;
+    bool overlapping = false;       /* The points and normal are meaningless then */
+    RigidBody* body = nullptr;      /* Closest body, for closestBody() */
+    vec3 pointA = vec3();
+    vec3 pointB = vec3();
+    vec3 normal = vec3();           /* From A towards B */
+    float dist = 0.0f;
+};
+
 class PhysicsHandler {
 public:
 
 	std::vector<Ref<RigidBody>> m_bodies = {};
 	std::vector<Ref<Constraint>> m_constraints = {};
+	Ref<Broadphase> m_broadphase = ref<AABBTreeBroadphase>();
+	PairCache m_pairCache;
+	IslandManager m_islands;
+	Ref<WorkerPool> m_workerPool = nullptr;
     // std::vector<Ref<Mesh>> m_debugMeshes;
 
     PhysicsHandler() = default;
@@ -26,6 +45,28 @@ public:
 
     void add(Ref<RigidBody> body);
 
+    /**
+     * @brief Replaces the broadphase used to collect collision pairs.
+     * @param broadphase e.g. AABBTreeBroadphase, SweepAndPruneBroadphase or
+     *      SpatialHashBroadphase
+     */
+    void setBroadphase(Ref<Broadphase> broadphase);
+
+    /**
+     * @brief Sets the number of threads used by the physics step,
+     * including the calling thread. 1 disables the worker pool. Steps
+     * give bitwise the same result for any number of threads.
+     */
+    void setThreadCount(size_t threadCount);
+
+    /**
+     * @brief Registers a callback for contact begin / persist / end events.
+     * Events are dispatched once per step, after the solver has finished.
+     * @return Handle for unsubscribe()
+     */
+    size_t subscribe(PairCache::Listener listener);
+    void unsubscribe(size_t handle);
+
     void init();
     
     void update(float dt);
@@ -37,6 +78,25 @@ public:
      */
     void update(float dt, std::function<void(float)> onSubstep);
 
-    RaycastInfo raycast(const vec3& ray_origin, const vec3& ray_dir) const;
+    /**
+     * @brief Finds the closest hit along a ray.
+     * @param filter Layers to test and an optional body to ignore.
+     */
+    RaycastInfo raycast(const vec3& ray_origin, const vec3& ray_dir, const QueryFilter& filter = {}) const;
+
+    /**
+     * @brief Distance and closest points of two bodies, see Narrowphase::distance().
+     * Doesn't exist if either one is a heightfield or concave mesh.
+     */
+    DistanceInfo distance(const RigidBody& A, const RigidBody& B) const;
+
+    /**
+     * @brief Finds the body closest to a shape, e.g. a sphere around an agent
+     * for avoidance. Point A is on the shape, B on the body.
+     * @param shape Any convex collider, posed with updateGlobalPose()
+     * @param maxDistance Bodies further away are skipped
+     * @param filter Layers to test and an optional body to ignore.
+     */
+    DistanceInfo closestBody(Collider& shape, float maxDistance, const QueryFilter& filter = {}) const;
 
 };
@@ -5,6 +5,7 @@
 #include "component/Component.h"
 
 #include "phys/Collider.h"
+#include "phys/CollisionFilter.h"
 #include "phys/Pose.h"
 
 #include <string>
@@ -22,10 +23,16 @@ public:
 
     bool isDynamic = true;              /* Whether or not physics applies to this body */
     bool canCollide = true;             /* Whether or not this body can collide with other bodies */
+
+    uint32_t collisionLayer = CollisionLayer::DEFAULT;  /* Layer bits this body is on */
+    uint32_t collisionMask = CollisionLayer::ALL;       /* Layers this body collides with */
+
+    bool persistentContacts = true;     /* Whether or not contacts may be reused across substeps */
+    bool continuousCollision = false;   /* Speculative contacts and time of impact, see ContinuousCollision */
     
     bool isSleeping = false;
     bool canSleep = true;
-    float sleepTimer = 0.0f;
+    float sleepTimer = 0.0f;            /* Time spent resting, see isResting() */
 
     Ref<Collider> collider = nullptr;   /* Physics representation of the body */
 
@@ -61,6 +68,9 @@ public:
     RigidBody setColliderOffset(const vec3& offset);
     RigidBody makeStatic();
     RigidBody disableCollision();
+    RigidBody disablePersistentContacts(); // For fast movers
+    RigidBody enableContinuousCollision(); // For fast movers, against thin geometry
+    RigidBody setCollisionFilter(uint32_t layer, uint32_t mask = CollisionLayer::ALL);
 
     RigidBody applyForce(const vec3& force, const vec3& position = vec3(0));
     RigidBody applyTorque(const vec3& torque);
@@ -76,6 +86,8 @@ public:
     void update(const float deltaTime);
 
     void checkSleepState(float dt);
+    void updateSleepTimer(float dt);    /* Once per step, resets as soon as the body moves */
+    bool isResting() const;             /* Slow now and for long enough to sleep, once its whole island is */
     void sleep();
     void wake();
 
@@ -91,4 +103,5 @@ public:
     vec3 velPrev    = vec3(0);
     vec3 omegaPrev  = vec3(0);
     Pose prevPose   = Pose();
+    Pose stepPose   = Pose();           /* Pose at the start of the step, see updateSleepTimer() */
 };
@@ -10,6 +10,12 @@ public:
 
     bool containsOrigin = false;
 
+    /* Last search direction, a separating axis if the origin is not contained */
+    vec3 direction = vec3(0.0f);
+
+    /* Support evaluations used to build this simplex */
+    unsigned iterations = 0;
+
     std::array<Support, 4> m_points;
     unsigned m_size;
 
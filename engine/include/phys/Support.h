@@ -8,6 +8,9 @@ struct Support {
     vec3 witnessA;
     vec3 witnessB;
 
+    /* Search direction this vertex was found with, lets GJK rebuild a cached simplex */
+    vec3 direction = vec3(0.0f);
+
     Support() = default;
 
     Support(
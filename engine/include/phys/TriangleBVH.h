@@ -0,0 +1,185 @@
+#pragma once
+
+#include "common/glm.h"
+#include "phys/AABB.h"
+
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Static bounding volume hierarchy over the triangles of a mesh.
+ *
+ * Built once, top down: each node is split where the surface area
+ * heuristic is lowest, evaluated over bins of the triangle centroids.
+ * Nodes live in a flat array in depth first order, so the first child of
+ * a node directly follows it and only the second one is stored. Leaves
+ * reference a range of m_indices.
+ *
+ * Based on "How to build a BVH" (Jacco Bikker) and PBRT, 4.3
+ */
+class TriangleBVH {
+public:
+
+    static constexpr size_t MAX_LEAF_SIZE = 4;
+    static constexpr size_t NUM_BINS = 12;
+
+    /* Deeper nodes become leaves, which bounds the traversal stacks */
+    static constexpr size_t MAX_DEPTH = 48;
+
+    struct Node {
+        AABB aabb;
+
+        uint32_t second = 0;    /* Second child, inner nodes only */
+        uint32_t first = 0;     /* First entry in m_indices, leaves only */
+        uint32_t count = 0;     /* Triangles in the leaf, 0 for inner nodes */
+
+        inline bool isLeaf() const { return count > 0; }
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_indices;    /* Triangle indices, grouped by leaf */
+
+    TriangleBVH() = default;
+
+    /**
+     * @brief Builds the tree, replacing the previous one.
+     * @param triangles Corners (and normal, unused) per triangle
+     */
+    void build(const std::vector<std::array<vec3, 4>>& triangles);
+
+    inline bool isEmpty() const { return m_nodes.empty(); }
+
+    /**
+     * @brief Calls `callback(triangle)` for every triangle whose leaf
+     * overlaps `aabb`.
+     */
+    template<typename Callback>
+    void query(const AABB& aabb, Callback&& callback) const {
+
+        if (m_nodes.empty())
+            return;
+
+        std::array<uint32_t, MAX_DEPTH + 2> stack;
+        size_t size = 0;
+
+        stack[size++] = 0;
+
+        while (size > 0) {
+            const uint32_t index = stack[--size];
+            const Node& node = m_nodes[index];
+
+            if (!node.aabb.intersects(aabb))
+                continue;
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                    callback(m_indices[i]);
+            } else {
+                stack[size++] = node.second;
+                stack[size++] = index + 1;
+            }
+        }
+    }
+
+    /**
+     * @brief Closest hit along a ray. Children are visited near to far and
+     * skipped once they start beyond the closest hit so far.
+     * @param intersect `bool(uint32_t triangle, float& t)`, the ray test
+     * @param distance In: maximum distance, out: distance to the hit
+     * @return Triangle index of the hit, or -1
+     */
+    template<typename Intersect>
+    int64_t raycast(const vec3& origin, const vec3& dir, float& distance, Intersect&& intersect) const {
+
+        if (m_nodes.empty())
+            return -1;
+
+        const vec3 invDir = vec3(
+            std::abs(dir.x) > FLT_EPSILON ? 1.0f / dir.x : FLT_MAX,
+            std::abs(dir.y) > FLT_EPSILON ? 1.0f / dir.y : FLT_MAX,
+            std::abs(dir.z) > FLT_EPSILON ? 1.0f / dir.z : FLT_MAX
+        );
+
+        int64_t hit = -1;
+
+        std::array<uint32_t, MAX_DEPTH + 2> stack;
+        size_t size = 0;
+
+        if (entry(m_nodes[0].aabb, origin, invDir, distance) < FLT_MAX)
+            stack[size++] = 0;
+
+        while (size > 0) {
+            const uint32_t index = stack[--size];
+            const Node& node = m_nodes[index];
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    float t = distance;
+
+                    if (intersect(m_indices[i], t) && t < distance) {
+                        distance = t;
+                        hit = m_indices[i];
+                    }
+                }
+
+                continue;
+            }
+
+            uint32_t near = index + 1;
+            uint32_t far = node.second;
+
+            float tNear = entry(m_nodes[near].aabb, origin, invDir, distance);
+            float tFar = entry(m_nodes[far].aabb, origin, invDir, distance);
+
+            if (tFar < tNear) {
+                std::swap(near, far);
+                std::swap(tNear, tFar);
+            }
+
+            /* Pushed last, popped first */
+            if (tFar < FLT_MAX)
+                stack[size++] = far;
+
+            if (tNear < FLT_MAX)
+                stack[size++] = near;
+        }
+
+        return hit;
+    }
+
+private:
+
+    /* Distance along the ray to the box (slab test), FLT_MAX if missed or beyond maxDistance */
+    static inline float entry(const AABB& aabb, const vec3& origin, const vec3& invDir, float maxDistance) {
+        float tMin = 0.0f;
+        float tMax = maxDistance;
+
+        for (int i = 0; i < 3; i++) {
+            float t0 = (aabb.min[i] - origin[i]) * invDir[i];
+            float t1 = (aabb.max[i] - origin[i]) * invDir[i];
+
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            tMin = t0 > tMin ? t0 : tMin;
+            tMax = t1 < tMax ? t1 : tMax;
+
+            if (tMin > tMax)
+                return FLT_MAX;
+        }
+
+        return tMin;
+    }
+
+    uint32_t buildNode(
+        uint32_t first,
+        uint32_t count,
+        size_t depth,
+        const std::vector<AABB>& bounds,
+        const std::vector<vec3>& centroids
+    );
+};
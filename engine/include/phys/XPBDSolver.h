@@ -7,31 +7,121 @@
 #include "phys/RigidBody.h"
 #include "phys/Constraint.h"
 #include "phys/ContactSet.h"
+#include "phys/ContactManifold.h"
 #include "phys/CollisionPair.h"
+#include "phys/Broadphase.h"
+#include "phys/PairCache.h"
+#include "phys/IslandManager.h"
+#include "util/WorkerPool.h"
 #include <functional>
+#include <span>
 
 namespace XPBDSolver {
 
     constexpr int NUM_SUB_STEPS = 15;
 
+    /**
+     * Contact persistence: instead of running GJK / EPA on every substep, the
+     * manifold of a pair is refreshed through its local anchors on the next
+     * substeps (ContactSet::refresh). It is generated again when the pair
+     * moved further than the limits below, or if one of the bodies opted out.
+     * 
+     * A manifold is not kept for the whole step: the anchors slide off the
+     * features they were clipped from, which lets stacks rock and tip.
+     */
+    inline bool persistentContacts = true;
+    inline float persistentContactDistance = 0.005f;    /* Relative translation (m) */
+    inline float persistentContactAngle = 0.01f;        /* Relative rotation (rad) */
+    inline int persistentContactSubsteps = 2;           /* Substeps before it is generated again */
+
+    /* Most contacts kept per shape resting on a plane, clamped to 1 to 16, see ContactManifold::reduce() */
+    inline size_t maxPlaneContacts = ContactManifold::MAX_POINTS;
+
+    /**
+     * Continuous collision of bodies that opted in (see ContinuousCollision).
+     * Speculative contacts reach as far as the relative motion of a pair
+     * in this many substeps, the time of impact is found up to a distance.
+     */
+    inline float speculativeSubsteps = 1.5f;
+    inline float timeOfImpactTolerance = 0.002f;     /* (m) */
+
+    /**
+     * Islands are solved in parallel on the worker pool, one task per
+     * island. Islands that cost less than islandBatchSize (bodies, pairs
+     * and constraints) are batched into one task. Islands that cost at
+     * least largeIslandSize are solved one at a time instead, with their
+     * narrow phase and body updates split over the threads in chunks of
+     * islandChunkSize, and every solver colour in chunks of
+     * colorChunkSize items. None of these change the result.
+     */
+    inline size_t islandBatchSize = 64;
+    inline size_t largeIslandSize = 1024;
+    inline size_t islandChunkSize = 64;
+    inline size_t colorChunkSize = 16;
+
+    /**
+     * Large islands solve their contacts and constraints by colour (see
+     * SolverColors). Items that don't fit in this many colours (1 to 255)
+     * are solved serially after them.
+     */
+    inline size_t maxSolverColors = 16;
+
+    /**
+     * Contacts and constraints of an island, grouped by graph colouring.
+     * An item is a constraint or the contacts of one pair. No two items
+     * of a colour share an awake dynamic body, static and sleeping ones
+     * don't move during the solve. The items of a colour can be solved in
+     * any order, or at the same time, with the same result.
+     */
+    struct SolverColors {
+        struct Item {
+            Constraint* constraint = nullptr;   /* Either a constraint */
+            uint32_t firstContact = 0;          /* or a run of contacts of one pair */
+            uint32_t contactCount = 0;
+        };
+
+        /* Colour c has items [offsets[c], offsets[c + 1]), the last range are the ones that didn't fit */
+        std::vector<Item> items;
+        std::vector<uint32_t> offsets;
+
+        inline size_t getColorCount() const { return offsets.empty() ? 0 : offsets.size() - 2; }
+
+        /* Scratch: next colour per body id, colour per item, fill position per colour */
+        std::vector<uint32_t> bodyColors;
+        std::vector<uint8_t> itemColors;
+        std::vector<uint32_t> cursor;
+    };
+
     void init();
 
     /**
      * @brief Updates the physics simulation for a given time step.
      * @param bodies Vector of rigid bodies to update.
      * @param constraints Vector of constraints to apply.
+     * @param broadphase Broadphase used to collect potential collision pairs.
+     * @param pairCache Persistent pair state, dispatches the contact events.
+     * @param islands Groups the awake bodies, puts them to sleep and wakes them.
+     * @param pool Solves the islands in parallel, may be null. The result
+     *      is the same for any number of threads.
      * @param dt Delta time for the current physics step.
      * @param onSubstep Callback function to execute after each substep.
+     *      Without one, every island runs all its substeps in one go,
+     *      otherwise the islands wait for each other after every substep.
      */
     void update(
         const std::vector<Ref<RigidBody>>& bodies,
         const std::vector<Ref<Constraint>>& constraints,
+        Broadphase& broadphase,
+        PairCache& pairCache,
+        IslandManager& islands,
+        WorkerPool* pool,
         const float dt,
-        std::function<void(float)> onSubstep = [](float) {}
+        std::function<void(float)> onSubstep = nullptr
     );
 
     /**
-     * @brief Collects potential collision pairs (broad phase)
+     * @brief Collects potential collision pairs (broad phase) by testing 
+     * every pair of bodies. Scalar reference for BruteForceBroadphase.
      * @param rigidBodies Vector of rigid bodies to check for collisions.
      * @param dt Delta time for the current physics step.
      * @return Vector of basic collision pairs.
@@ -42,12 +132,30 @@ namespace XPBDSolver {
     );
 
     /**
-     * @brief Gets contacts from the collected collision pairs (narrow phase).
-     * @param collisions Vector of collision pairs to process.
-     * @return Vector of detailed contact sets.
+     * @brief Gets contacts from the collected collision pairs (narrow phase),
+     * see Narrowphase for the tests per pair of collider types.
+     * Updates the pair state (if linked) with the GJK warm start and manifold,
+     * and reuses the manifold of earlier substeps if persistentContacts is set.
+     * Pairs with a continuous body also get speculative contacts.
+     * Only touches the pair states, pairs can be split over threads.
+     * @param collisions Collision pairs to process.
+     * @param h Substep delta time, bounds the motion of continuous bodies.
+     * @param contacts Receives the detailed contact sets, in pair order.
      */
-    std::vector<Ref<ContactSet>> getContacts(
-        const std::vector<CollisionPair>& collisions
+    void getContacts(
+        std::span<const CollisionPair> collisions,
+        const float h,
+        std::vector<Ref<ContactSet>>& contacts
+    );
+
+    /**
+     * @brief Moves the bodies of pairs with a continuous body back to their
+     * time of impact, if their motion since the start of the substep would
+     * have passed through each other. Runs after the integration.
+     * @param collisions Collision pairs to process.
+     */
+    void clampMotion(
+        std::span<const CollisionPair> collisions
     );
 
     /**
@@ -70,8 +178,46 @@ namespace XPBDSolver {
         const float h
     );
 
+    /**
+     * @brief Colours the constraints and contacts of an island. Items that
+     * share a body keep their order (constraints first, then the contacts
+     * in pair order), so solving by colour gives the same result as the
+     * serial solve, while the items of a colour can run in parallel.
+     * @param contacts Contacts in pair order, see getContacts()
+     */
+    void colorItems(
+        std::span<Constraint* const> constraints,
+        const std::vector<Ref<ContactSet>>& contacts,
+        SolverColors& colors
+    );
+
+    /**
+     * @brief Position-level solve of the constraints and contacts, colour
+     * by colour. Same result as Constraint::solvePos() on every constraint
+     * followed by solvePositions().
+     * @param pool Solves the items of a colour in parallel, may be null.
+     */
+    void solvePositions(
+        const SolverColors& colors,
+        const std::vector<Ref<ContactSet>>& contacts,
+        const float h,
+        WorkerPool* pool
+    );
+
+    /**
+     * @brief Velocity-level solve of the constraints and contacts, colour
+     * by colour, see solvePositions().
+     */
+    void solveVelocities(
+        const SolverColors& colors,
+        const std::vector<Ref<ContactSet>>& contacts,
+        const float h,
+        WorkerPool* pool
+    );
+
     void _solvePenetration(Ref<ContactSet> contact, const float h);
     void _solveFriction(Ref<ContactSet> contact, const float h);
+    void _solveVelocity(Ref<ContactSet> contact, const float h);
 
     /** 
      * Finds the Lagrange multiplier and correction vector for a pair of bodies.
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "phys/Broadphase.h"
+#include "phys/AABBTree.h"
+
+/**
+ * Broadphase backed by two dynamic AABB trees - O(n log n).
+ *
+ * Dynamic bodies live in one tree that is updated incrementally (leaves are
+ * only re-inserted when a body leaves its fat AABB). Static bodies live in
+ * a separate tree that is never refit and never queried against itself.
+ *
+ * Bodies with unbounded AABBs (e.g. planes) can't be stored in a tree, they
+ * are kept in a small list and tested against every other body instead.
+ */
+class AABBTreeBroadphase : public Broadphase {
+public:
+
+    AABBTree m_dynamicTree;
+    AABBTree m_staticTree;
+
+    /**
+     * @param margin Amount [m] by which the fat AABBs are grown. Larger
+     *      values mean fewer re-insertions but more false positives.
+     */
+    AABBTreeBroadphase(float margin = 0.1f);
+
+    std::vector<CollisionPair> collectCollisionPairs(
+        const std::vector<Ref<RigidBody>>& bodies,
+        const float dt
+    ) override;
+
+private:
+
+    enum class ProxyType {
+        NONE,
+        DYNAMIC,
+        STATIC,
+        UNBOUNDED
+    };
+
+    struct Proxy {
+        const RigidBody* body = nullptr;
+        ProxyType type = ProxyType::NONE;
+        int node = AABBTree::NULL_NODE;
+
+        /* Copied from the body, so that queries don't have to chase pointers */
+        AABB aabb;
+        bool isAwake = false;
+        uint32_t layer = 0;
+        uint32_t mask = 0;
+    };
+
+    /* Indexed the same way as the bodies vector */
+    std::vector<Proxy> m_proxies;
+
+    std::vector<int> m_unbounded;
+    std::vector<int> m_queryOrder;
+    CandidateBuffer m_candidates;
+
+    void updateProxies(const std::vector<Ref<RigidBody>>& bodies);
+    void removeProxy(Proxy& proxy);
+
+    inline bool layersCollide(int a, int b) const {
+        return ::layersCollide(m_proxies[a].layer, m_proxies[a].mask, m_proxies[b].layer, m_proxies[b].mask);
+    }
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "phys/Broadphase.h"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Uniform grid broadphase, stored as a spatial hash - ~O(n) for bodies of
+ * similar size.
+ *
+ * Every body is entered into each cell its AABB touches. Cells are hashed
+ * into a table of buckets that is rebuilt with a counting sort, so the
+ * whole grid is just two flat arrays (bucket offsets and entries) and
+ * never allocates once it has warmed up. A pair sharing several cells is
+ * only reported by the cell that holds the min corner of their overlap.
+ *
+ * Static bodies live in a second grid that is only rebuilt when the static
+ * set changes. Bodies that would touch too many cells (e.g. a world-sized
+ * floor) and unbounded bodies (planes) are not entered at all, they are
+ * only tested against the awake dynamic bodies.
+ *
+ * The cell size should be a bit larger than the typical body, e.g. a car.
+ */
+class SpatialHashBroadphase : public Broadphase {
+public:
+
+    struct Stats {
+        size_t occupiedCells = 0;   /* Cells holding at least one body */
+        size_t entries = 0;         /* Body-cell entries */
+        size_t maxOccupancy = 0;    /* Bodies in the fullest cell */
+        float meanOccupancy = 0.0f; /* Bodies per occupied cell */
+        size_t largeBodies = 0;     /* Bodies kept out of the grid */
+
+        /* Occupied cells holding 1, 2, 3-4, 5-8, 9-16 and 17+ bodies */
+        std::array<size_t, 6> histogram = {};
+    };
+
+    /**
+     * @param cellSize Edge length [m] of a grid cell.
+     * @param maxCellsPerBody Bodies touching more cells than this are
+     *      handled separately instead of being entered into the grid.
+     */
+    SpatialHashBroadphase(float cellSize = 4.0f, int maxCellsPerBody = 27);
+
+    std::vector<CollisionPair> collectCollisionPairs(
+        const std::vector<Ref<RigidBody>>& bodies,
+        const float dt
+    ) override;
+
+    void setCellSize(float cellSize);
+    inline float getCellSize() const { return m_cellSize; }
+
+    /** @brief Occupancy of the grids during the last step, for tuning the cell size */
+    const Stats& getStats();
+
+private:
+
+    enum class ProxyType {
+        NONE,
+        DYNAMIC,
+        STATIC,
+        LARGE
+    };
+
+    struct Proxy {
+        const RigidBody* body = nullptr;
+        ProxyType type = ProxyType::NONE;
+
+        /* Copied from the body, so that the grid doesn't have to chase pointers */
+        AABB aabb;
+        bool isAwake = false;
+        uint32_t layer = 0;
+        uint32_t mask = 0;
+    };
+
+    struct Entry {
+        ivec3 cell;
+        int proxy;
+    };
+
+    struct Grid {
+        std::vector<uint32_t> buckets; /* Offsets into entries, one extra at the end */
+        std::vector<Entry> entries;
+
+        inline uint32_t bucketMask() const { return static_cast<uint32_t>(buckets.size() - 2); }
+    };
+
+    float m_cellSize;
+    float m_invCellSize;
+    int m_maxCellsPerBody;
+
+    Grid m_dynamicGrid;
+    Grid m_staticGrid;
+    bool m_staticDirty = true;
+
+    /* Indexed the same way as the bodies vector */
+    std::vector<Proxy> m_proxies;
+
+    std::vector<int> m_dynamic;
+    std::vector<int> m_static;
+    std::vector<int> m_large;
+    std::vector<int> m_awake;
+
+    CandidateBuffer m_candidates;
+
+    Stats m_stats;
+    bool m_statsDirty = true;
+
+    void updateProxies(const std::vector<Ref<RigidBody>>& bodies);
+
+    void buildGrid(Grid& grid, const std::vector<int>& proxies);
+    void updateStats();
+
+    inline bool layersCollide(int a, int b) const {
+        return ::layersCollide(m_proxies[a].layer, m_proxies[a].mask, m_proxies[b].layer, m_proxies[b].mask);
+    }
+
+    /** @brief True if the pair should be reported by `cell` (see class comment) */
+    bool isHomeCell(const ivec3& cell, int a, int b) const;
+
+    inline ivec3 cellOf(const vec3& p) const {
+        return ivec3(
+            static_cast<int>(std::floor(p.x * m_invCellSize)),
+            static_cast<int>(std::floor(p.y * m_invCellSize)),
+            static_cast<int>(std::floor(p.z * m_invCellSize))
+        );
+    }
+
+    static inline uint32_t hashCell(const ivec3& cell) {
+        return static_cast<uint32_t>(cell.x) * 73856093u
+             ^ static_cast<uint32_t>(cell.y) * 19349663u
+             ^ static_cast<uint32_t>(cell.z) * 83492791u;
+    }
+};
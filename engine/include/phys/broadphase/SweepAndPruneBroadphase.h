@@ -0,0 +1,113 @@
+#pragma once
+
+#include "phys/Broadphase.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_set>
+
+/**
+ * Incremental sweep and prune (sort and sweep) broadphase.
+ *
+ * Keeps the AABB endpoints of all bodies sorted along one or more axes.
+ * Because bodies only move a little each step, the arrays are nearly sorted
+ * and an insertion sort fixes them up in ~O(n). Every swap of a min and max
+ * endpoint is a pair event: the pair either starts or stops overlapping on
+ * that axis. The overlapping pairs are kept between steps, so nothing is
+ * rebuilt from scratch.
+ *
+ * The insertion sort is inherently serial, so this broadphase ignores the
+ * worker pool.
+ *
+ * Pairs are only tracked on the sorted axes - sorting on X and Z suits
+ * mostly flat worlds, the remaining axis is checked by Broadphase::testPair.
+ *
+ * Based on btAxisSweep3 (Bullet, Erwin Coumans)
+ */
+class SweepAndPruneBroadphase : public Broadphase {
+public:
+
+    /** Above this many new bodies per step, a full sort is cheaper */
+    static constexpr int BATCH_INSERT_THRESHOLD = 64;
+
+    /**
+     * @param axes Axes to sort on (0 = X, 1 = Y, 2 = Z).
+     */
+    SweepAndPruneBroadphase(std::initializer_list<int> axes = { 0, 2 });
+
+    std::vector<CollisionPair> collectCollisionPairs(
+        const std::vector<Ref<RigidBody>>& bodies,
+        const float dt
+    ) override;
+
+    /** @brief Pairs (body indices) that started overlapping during the last step */
+    inline const std::vector<std::pair<int, int>>& getAddedPairs() const { return m_added; }
+
+    /** @brief Pairs (body indices) that stopped overlapping during the last step */
+    inline const std::vector<std::pair<int, int>>& getRemovedPairs() const { return m_removed; }
+
+    inline size_t getPairCount() const { return m_pairs.size(); }
+
+private:
+
+    struct Endpoint {
+        float value;
+        uint32_t data; /* (proxy index << 1) | isMax */
+
+        inline int proxy() const { return static_cast<int>(data >> 1); }
+        inline bool isMax() const { return data & 1u; }
+    };
+
+    enum class ProxyType {
+        NONE,
+        SORTED,
+        UNBOUNDED
+    };
+
+    struct Proxy {
+        const RigidBody* body = nullptr;
+        ProxyType type = ProxyType::NONE;
+        AABB aabb;
+    };
+
+    std::vector<int> m_axes;
+    std::vector<Endpoint> m_endpoints[3];
+
+    /* Indexed the same way as the bodies vector */
+    std::vector<Proxy> m_proxies;
+    std::vector<int> m_unbounded;
+
+    /* Pairs overlapping on all sorted axes, key = (lower << 32) | upper */
+    std::unordered_set<uint64_t> m_pairs;
+
+    std::vector<std::pair<int, int>> m_added;
+    std::vector<std::pair<int, int>> m_removed;
+    std::vector<std::pair<int, int>> m_candidates;
+
+    /* Proxies appended since the last sort */
+    int m_inserted = 0;
+
+    void updateProxies(const std::vector<Ref<RigidBody>>& bodies);
+
+    void addProxy(int index);
+    void removeProxy(int index);
+
+    /** Insertion sort along one axis, reporting pair events on the way */
+    void sortAxis(int axis);
+
+    /**
+     * Full sort and sweep, used when many bodies are added at once (e.g.
+     * the first step) since the insertion sort would be O(n²) there.
+     */
+    void rebuild();
+
+    bool overlapsOnSortedAxes(int a, int b) const;
+
+    void addPair(int a, int b);
+    void removePair(int a, int b);
+
+    static inline uint64_t pairKey(int a, int b) {
+        if (a > b) std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+    }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads for data parallel loops.
+ *
+ * The calling thread takes part in every loop as thread 0, so a pool of
+ * one thread has no workers and just runs the loop inline.
+ */
+class WorkerPool {
+public:
+
+    /**
+     * Called with a range [begin, end) and the index of the thread that
+     * runs it, in [0, getThreadCount()).
+     */
+    using RangeFunc = std::function<void(size_t begin, size_t end, size_t thread)>;
+
+    /**
+     * @param threadCount Total number of threads including the caller,
+     *      0 uses the number of hardware threads.
+     */
+    WorkerPool(size_t threadCount = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    inline size_t getThreadCount() const { return m_workers.size() + 1; }
+
+    /**
+     * @brief Runs `func` over [0, count) in chunks of `grain` items and
+     * blocks until all of them are done. Chunks are handed out in order,
+     * but which thread runs a chunk is not deterministic.
+     */
+    void parallelFor(size_t count, size_t grain, const RangeFunc& func);
+
+private:
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    /* Current loop, guarded by m_mutex */
+    const RangeFunc* m_func = nullptr;
+    size_t m_count = 0;
+    size_t m_grain = 1;
+    size_t m_generation = 0;
+    size_t m_busy = 0;
+    bool m_stop = false;
+
+    std::atomic<size_t> m_next = 0;
+
+    void workerLoop(size_t thread);
+    void runChunks(const RangeFunc& func, size_t count, size_t grain, size_t thread);
+};
@@ -0,0 +1,363 @@
+
+#include "phys/AABBTree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+AABBTree::AABBTree(float margin)
+    : m_margin(margin)
+{}
+
+void AABBTree::clear() {
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_leafCount = 0;
+}
+
+int AABBTree::allocateNode() {
+
+    if (m_freeList == NULL_NODE) {
+        m_nodes.emplace_back();
+        m_nodes.back().height = 0;
+
+        return static_cast<int>(m_nodes.size()) - 1;
+    }
+
+    int node = m_freeList;
+    m_freeList = m_nodes[node].parent;
+
+    m_nodes[node] = Node();
+    m_nodes[node].height = 0;
+
+    return node;
+}
+
+void AABBTree::freeNode(int node) {
+    assert(0 <= node && node < (int)m_nodes.size());
+
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+int AABBTree::insert(const AABB& aabb, int userData) {
+
+    int proxy = allocateNode();
+
+    m_nodes[proxy].aabb = aabb;
+    m_nodes[proxy].aabb.expandByScalar(m_margin);
+    m_nodes[proxy].userData = userData;
+    m_nodes[proxy].height = 0;
+
+    insertLeaf(proxy);
+    m_leafCount++;
+
+    return proxy;
+}
+
+void AABBTree::remove(int proxy) {
+    assert(0 <= proxy && proxy < (int)m_nodes.size());
+    assert(m_nodes[proxy].isLeaf());
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    m_leafCount--;
+}
+
+bool AABBTree::move(int proxy, const AABB& aabb) {
+    assert(0 <= proxy && proxy < (int)m_nodes.size());
+    assert(m_nodes[proxy].isLeaf());
+
+    /* Still inside the fat AABB, nothing to do */
+    if (m_nodes[proxy].aabb.contains(aabb))
+        return false;
+
+    removeLeaf(proxy);
+
+    m_nodes[proxy].aabb = aabb;
+    m_nodes[proxy].aabb.expandByScalar(m_margin);
+
+    insertLeaf(proxy);
+
+    return true;
+}
+
+int AABBTree::findBestSibling(const AABB& aabbD) const {
+
+    /**
+     * Branch and bound search for the sibling with the lowest SAH cost.
+     * Follows a single greedy path down the tree, but keeps track of the 
+     * best node seen so far and stops as soon as the lower bound of the 
+     * cost below a node can't beat it.
+     * 
+     * Bittner et al. 2012, "Fast, Effective BVH Updates for Animated Scenes"
+     */
+    const vec3 centerD = aabbD.getCenter();
+    const float areaD = aabbD.surfaceArea();
+
+    AABB combined;
+
+    int index = m_root;
+    float areaBase = m_nodes[index].aabb.surfaceArea();
+
+    combined.merge(m_nodes[index].aabb, aabbD);
+    float directCost = combined.surfaceArea();
+    float inheritedCost = 0.0f;
+
+    int bestSibling = index;
+    float bestCost = directCost;
+
+    while (!m_nodes[index].isLeaf()) {
+        const int child1 = m_nodes[index].child1;
+        const int child2 = m_nodes[index].child2;
+
+        /* Cost of creating a new parent for this node and the new leaf */
+        const float cost = directCost + inheritedCost;
+
+        if (cost < bestCost) {
+            bestSibling = index;
+            bestCost = cost;
+        }
+
+        /* Inheritance cost seen by the children */
+        inheritedCost += directCost - areaBase;
+
+        /* Cost of descending into either child */
+        auto lowerCost = [&](int child, float& directCostChild, float& areaChild) {
+            combined.merge(m_nodes[child].aabb, aabbD);
+            directCostChild = combined.surfaceArea();
+            areaChild = 0.0f;
+
+            if (m_nodes[child].isLeaf()) {
+                const float costChild = directCostChild + inheritedCost;
+
+                if (costChild < bestCost) {
+                    bestSibling = child;
+                    bestCost = costChild;
+                }
+
+                return FLT_MAX;
+            }
+
+            areaChild = m_nodes[child].aabb.surfaceArea();
+
+            return inheritedCost + directCostChild + std::min(areaD - areaChild, 0.0f);
+        };
+
+        float directCost1, directCost2, area1, area2;
+        float lowerCost1 = lowerCost(child1, directCost1, area1);
+        float lowerCost2 = lowerCost(child2, directCost2, area2);
+
+        const bool leaf1 = m_nodes[child1].isLeaf();
+        const bool leaf2 = m_nodes[child2].isLeaf();
+
+        if (leaf1 && leaf2)
+            break;
+
+        /* Can the cost possibly be decreased? */
+        if (bestCost <= lowerCost1 && bestCost <= lowerCost2)
+            break;
+
+        /* Both children contain D - fall back to the distance between centers */
+        if (lowerCost1 == lowerCost2 && !leaf1) {
+            lowerCost1 = glm::length2(m_nodes[child1].aabb.getCenter() - centerD);
+            lowerCost2 = glm::length2(m_nodes[child2].aabb.getCenter() - centerD);
+        }
+
+        if (lowerCost1 < lowerCost2 && !leaf1) {
+            index = child1;
+            areaBase = area1;
+            directCost = directCost1;
+        } else {
+            index = child2;
+            areaBase = area2;
+            directCost = directCost2;
+        }
+    }
+
+    return bestSibling;
+}
+
+void AABBTree::insertLeaf(int leaf) {
+
+    if (m_root == NULL_NODE) {
+        m_root = leaf;
+        m_nodes[m_root].parent = NULL_NODE;
+        return;
+    }
+
+    const AABB leafAABB = m_nodes[leaf].aabb;
+    const int sibling = findBestSibling(leafAABB);
+
+    /* Create a new parent */
+    const int oldParent = m_nodes[sibling].parent;
+    const int newParent = allocateNode();
+
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].aabb.merge(leafAABB, m_nodes[sibling].aabb);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+
+    if (oldParent != NULL_NODE) {
+        if (m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    } else {
+        m_root = newParent;
+    }
+
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    /* Walk back up the tree fixing heights and AABBs */
+    int index = m_nodes[leaf].parent;
+
+    while (index != NULL_NODE) {
+        const int child1 = m_nodes[index].child1;
+        const int child2 = m_nodes[index].child2;
+
+        m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+        m_nodes[index].aabb.merge(m_nodes[child1].aabb, m_nodes[child2].aabb);
+
+        this->rotate(index);
+
+        index = m_nodes[index].parent;
+    }
+}
+
+void AABBTree::removeLeaf(int leaf) {
+
+    if (leaf == m_root) {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    const int parent = m_nodes[leaf].parent;
+    const int grandParent = m_nodes[parent].parent;
+    const int sibling = m_nodes[parent].child1 == leaf
+        ? m_nodes[parent].child2
+        : m_nodes[parent].child1;
+
+    if (grandParent == NULL_NODE) {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+        return;
+    }
+
+    /* Destroy the parent and connect the sibling to the grandparent */
+    if (m_nodes[grandParent].child1 == parent)
+        m_nodes[grandParent].child1 = sibling;
+    else
+        m_nodes[grandParent].child2 = sibling;
+
+    m_nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    /* Adjust ancestor bounds */
+    int index = grandParent;
+
+    while (index != NULL_NODE) {
+        const int child1 = m_nodes[index].child1;
+        const int child2 = m_nodes[index].child2;
+
+        m_nodes[index].aabb.merge(m_nodes[child1].aabb, m_nodes[child2].aabb);
+        m_nodes[index].height = 1 + std::max(m_nodes[child1].height, m_nodes[child2].height);
+
+        index = m_nodes[index].parent;
+    }
+}
+
+void AABBTree::rotate(int iA) {
+
+    /**
+     * Tree rotations that reduce the surface area of the subtree below A.
+     * A child of A is swapped with a grandchild on the other side, e.g. B
+     * and F below. The area of A itself doesn't change, so only the area 
+     * of the node that receives the new child (C) has to be compared.
+     *
+     *        A                A
+     *      /   \            /        *     B     C    ->    F     C
+     *    / \   / \              / \
+     *   D   E F   G            B   G
+     *
+     * Unlike AVL rotations this keeps the SAH quality of the tree intact.
+     */
+    Node& A = m_nodes[iA];
+
+    if (A.height < 2)
+        return;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+
+    AABB aabb;
+
+    /* Finds the cheapest swap of `iX` (child of A) with a child of `iY` */
+    auto bestSwap = [&](int iX, int iY, float& bestCost, int& bestChild, int& bestSwapper) {
+        const Node& Y = m_nodes[iY];
+
+        if (Y.isLeaf())
+            return;
+
+        const float areaY = Y.aabb.surfaceArea();
+
+        /* Swapping X with Y's first child leaves Y = X + second child */
+        aabb.merge(m_nodes[iX].aabb, m_nodes[Y.child2].aabb);
+        const float cost1 = aabb.surfaceArea() - areaY;
+
+        aabb.merge(m_nodes[iX].aabb, m_nodes[Y.child1].aabb);
+        const float cost2 = aabb.surfaceArea() - areaY;
+
+        if (cost1 < bestCost) {
+            bestCost = cost1;
+            bestChild = iX;
+            bestSwapper = Y.child1;
+        }
+
+        if (cost2 < bestCost) {
+            bestCost = cost2;
+            bestChild = iX;
+            bestSwapper = Y.child2;
+        }
+    };
+
+    float bestCost = 0.0f;
+    int bestChild = NULL_NODE;
+    int bestSwapper = NULL_NODE;
+
+    bestSwap(iB, iC, bestCost, bestChild, bestSwapper);
+    bestSwap(iC, iB, bestCost, bestChild, bestSwapper);
+
+    /* No rotation reduces the area */
+    if (bestChild == NULL_NODE)
+        return;
+
+    const int iX = bestChild;
+    const int iY = iX == iB ? iC : iB;
+    const int iS = bestSwapper;
+
+    Node& Y = m_nodes[iY];
+
+    /* Swap X (child of A) and S (child of Y) */
+    if (A.child1 == iX)
+        A.child1 = iS;
+    else
+        A.child2 = iS;
+
+    if (Y.child1 == iS)
+        Y.child1 = iX;
+    else
+        Y.child2 = iX;
+
+    m_nodes[iS].parent = iA;
+    m_nodes[iX].parent = iY;
+
+    Y.aabb.merge(m_nodes[Y.child1].aabb, m_nodes[Y.child2].aabb);
+    Y.height = 1 + std::max(m_nodes[Y.child1].height, m_nodes[Y.child2].height);
+    A.height = 1 + std::max(m_nodes[A.child1].height, m_nodes[A.child2].height);
+}
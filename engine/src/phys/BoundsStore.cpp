@@ -0,0 +1,237 @@
+
+#include "phys/BoundsStore.h"
+
+#include <bit>
+#include <cassert>
+#include <limits>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define BOUNDS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define BOUNDS_SSE2
+#endif
+
+/* Comparisons with NaN are false, so empty slots never overlap */
+static constexpr float EMPTY = std::numeric_limits<float>::quiet_NaN();
+
+void BoundsStore::resize(size_t size) {
+    for (auto* v : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ })
+        v->resize(size, EMPTY);
+}
+
+void BoundsStore::set(size_t index, const AABB& aabb) {
+    assert(index < this->size());
+
+    m_minX[index] = aabb.min.x;
+    m_minY[index] = aabb.min.y;
+    m_minZ[index] = aabb.min.z;
+    m_maxX[index] = aabb.max.x;
+    m_maxY[index] = aabb.max.y;
+    m_maxZ[index] = aabb.max.z;
+}
+
+void BoundsStore::setEmpty(size_t index) {
+    assert(index < this->size());
+
+    m_minX[index] = m_minY[index] = m_minZ[index] = EMPTY;
+    m_maxX[index] = m_maxY[index] = m_maxZ[index] = EMPTY;
+}
+
+const char* BoundsStore::getKernelName() {
+#if defined(BOUNDS_AVX2)
+    return "AVX2";
+#elif defined(BOUNDS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void BoundsStore::queryOverlapsScalar(
+    const AABB& aabb,
+    size_t begin,
+    size_t end,
+    std::vector<int>& out
+) const {
+
+    for (size_t i = begin; i < end; i++) {
+        if (m_maxX[i] >= aabb.min.x && m_minX[i] <= aabb.max.x &&
+            m_maxY[i] >= aabb.min.y && m_minY[i] <= aabb.max.y &&
+            m_maxZ[i] >= aabb.min.z && m_minZ[i] <= aabb.max.z)
+        {
+            out.push_back(static_cast<int>(i));
+        }
+    }
+}
+
+void BoundsStore::queryPlaneScalar(
+    const Plane& plane,
+    size_t begin,
+    size_t end,
+    std::vector<int>& out
+) const {
+
+    /* Same as AABB::intersectsPlane: project the box onto the normal */
+    const vec3& n = plane.normal;
+
+    const float* loX = n.x > 0 ? m_minX.data() : m_maxX.data();
+    const float* hiX = n.x > 0 ? m_maxX.data() : m_minX.data();
+    const float* loY = n.y > 0 ? m_minY.data() : m_maxY.data();
+    const float* hiY = n.y > 0 ? m_maxY.data() : m_minY.data();
+    const float* loZ = n.z > 0 ? m_minZ.data() : m_maxZ.data();
+    const float* hiZ = n.z > 0 ? m_maxZ.data() : m_minZ.data();
+
+    for (size_t i = begin; i < end; i++) {
+        float _min = n.x * loX[i];
+        float _max = n.x * hiX[i];
+        _min += n.y * loY[i];
+        _max += n.y * hiY[i];
+        _min += n.z * loZ[i];
+        _max += n.z * hiZ[i];
+
+        if (_min <= -plane.constant && _max >= -plane.constant)
+            out.push_back(static_cast<int>(i));
+    }
+}
+
+/* Appends begin + the set bits of a comparison mask */
+static inline void pushMask(unsigned mask, size_t begin, std::vector<int>& out) {
+    while (mask) {
+        const int bit = std::countr_zero(mask);
+        out.push_back(static_cast<int>(begin) + bit);
+        mask &= mask - 1;
+    }
+}
+
+#if defined(BOUNDS_AVX2)
+
+void BoundsStore::queryOverlaps(const AABB& aabb, size_t begin, size_t end, std::vector<int>& out) const {
+
+    const __m256 qMinX = _mm256_set1_ps(aabb.min.x), qMaxX = _mm256_set1_ps(aabb.max.x);
+    const __m256 qMinY = _mm256_set1_ps(aabb.min.y), qMaxY = _mm256_set1_ps(aabb.max.y);
+    const __m256 qMinZ = _mm256_set1_ps(aabb.min.z), qMaxZ = _mm256_set1_ps(aabb.max.z);
+
+    size_t i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 m = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(&m_maxX[i]), qMinX, _CMP_GE_OQ),
+            _mm256_cmp_ps(_mm256_loadu_ps(&m_minX[i]), qMaxX, _CMP_LE_OQ)
+        );
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_maxY[i]), qMinY, _CMP_GE_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_minY[i]), qMaxY, _CMP_LE_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_maxZ[i]), qMinZ, _CMP_GE_OQ));
+        m = _mm256_and_ps(m, _mm256_cmp_ps(_mm256_loadu_ps(&m_minZ[i]), qMaxZ, _CMP_LE_OQ));
+
+        pushMask(static_cast<unsigned>(_mm256_movemask_ps(m)), i, out);
+    }
+
+    this->queryOverlapsScalar(aabb, i, end, out);
+}
+
+void BoundsStore::queryPlane(const Plane& plane, size_t begin, size_t end, std::vector<int>& out) const {
+
+    const vec3& n = plane.normal;
+
+    const float* loX = n.x > 0 ? m_minX.data() : m_maxX.data();
+    const float* hiX = n.x > 0 ? m_maxX.data() : m_minX.data();
+    const float* loY = n.y > 0 ? m_minY.data() : m_maxY.data();
+    const float* hiY = n.y > 0 ? m_maxY.data() : m_minY.data();
+    const float* loZ = n.z > 0 ? m_minZ.data() : m_maxZ.data();
+    const float* hiZ = n.z > 0 ? m_maxZ.data() : m_minZ.data();
+
+    const __m256 nx = _mm256_set1_ps(n.x), ny = _mm256_set1_ps(n.y), nz = _mm256_set1_ps(n.z);
+    const __m256 c = _mm256_set1_ps(-plane.constant);
+
+    size_t i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 lo = _mm256_mul_ps(nx, _mm256_loadu_ps(loX + i));
+        __m256 hi = _mm256_mul_ps(nx, _mm256_loadu_ps(hiX + i));
+        lo = _mm256_add_ps(lo, _mm256_mul_ps(ny, _mm256_loadu_ps(loY + i)));
+        hi = _mm256_add_ps(hi, _mm256_mul_ps(ny, _mm256_loadu_ps(hiY + i)));
+        lo = _mm256_add_ps(lo, _mm256_mul_ps(nz, _mm256_loadu_ps(loZ + i)));
+        hi = _mm256_add_ps(hi, _mm256_mul_ps(nz, _mm256_loadu_ps(hiZ + i)));
+
+        const __m256 m = _mm256_and_ps(
+            _mm256_cmp_ps(lo, c, _CMP_LE_OQ),
+            _mm256_cmp_ps(hi, c, _CMP_GE_OQ)
+        );
+
+        pushMask(static_cast<unsigned>(_mm256_movemask_ps(m)), i, out);
+    }
+
+    this->queryPlaneScalar(plane, i, end, out);
+}
+
+#elif defined(BOUNDS_SSE2)
+
+void BoundsStore::queryOverlaps(const AABB& aabb, size_t begin, size_t end, std::vector<int>& out) const {
+
+    const __m128 qMinX = _mm_set1_ps(aabb.min.x), qMaxX = _mm_set1_ps(aabb.max.x);
+    const __m128 qMinY = _mm_set1_ps(aabb.min.y), qMaxY = _mm_set1_ps(aabb.max.y);
+    const __m128 qMinZ = _mm_set1_ps(aabb.min.z), qMaxZ = _mm_set1_ps(aabb.max.z);
+
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 m = _mm_and_ps(
+            _mm_cmpge_ps(_mm_loadu_ps(&m_maxX[i]), qMinX),
+            _mm_cmple_ps(_mm_loadu_ps(&m_minX[i]), qMaxX)
+        );
+        m = _mm_and_ps(m, _mm_cmpge_ps(_mm_loadu_ps(&m_maxY[i]), qMinY));
+        m = _mm_and_ps(m, _mm_cmple_ps(_mm_loadu_ps(&m_minY[i]), qMaxY));
+        m = _mm_and_ps(m, _mm_cmpge_ps(_mm_loadu_ps(&m_maxZ[i]), qMinZ));
+        m = _mm_and_ps(m, _mm_cmple_ps(_mm_loadu_ps(&m_minZ[i]), qMaxZ));
+
+        pushMask(static_cast<unsigned>(_mm_movemask_ps(m)), i, out);
+    }
+
+    this->queryOverlapsScalar(aabb, i, end, out);
+}
+
+void BoundsStore::queryPlane(const Plane& plane, size_t begin, size_t end, std::vector<int>& out) const {
+
+    const vec3& n = plane.normal;
+
+    const float* loX = n.x > 0 ? m_minX.data() : m_maxX.data();
+    const float* hiX = n.x > 0 ? m_maxX.data() : m_minX.data();
+    const float* loY = n.y > 0 ? m_minY.data() : m_maxY.data();
+    const float* hiY = n.y > 0 ? m_maxY.data() : m_minY.data();
+    const float* loZ = n.z > 0 ? m_minZ.data() : m_maxZ.data();
+    const float* hiZ = n.z > 0 ? m_maxZ.data() : m_minZ.data();
+
+    const __m128 nx = _mm_set1_ps(n.x), ny = _mm_set1_ps(n.y), nz = _mm_set1_ps(n.z);
+    const __m128 c = _mm_set1_ps(-plane.constant);
+
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 lo = _mm_mul_ps(nx, _mm_loadu_ps(loX + i));
+        __m128 hi = _mm_mul_ps(nx, _mm_loadu_ps(hiX + i));
+        lo = _mm_add_ps(lo, _mm_mul_ps(ny, _mm_loadu_ps(loY + i)));
+        hi = _mm_add_ps(hi, _mm_mul_ps(ny, _mm_loadu_ps(hiY + i)));
+        lo = _mm_add_ps(lo, _mm_mul_ps(nz, _mm_loadu_ps(loZ + i)));
+        hi = _mm_add_ps(hi, _mm_mul_ps(nz, _mm_loadu_ps(hiZ + i)));
+
+        const __m128 m = _mm_and_ps(_mm_cmple_ps(lo, c), _mm_cmpge_ps(hi, c));
+
+        pushMask(static_cast<unsigned>(_mm_movemask_ps(m)), i, out);
+    }
+
+    this->queryPlaneScalar(plane, i, end, out);
+}
+
+#else
+
+void BoundsStore::queryOverlaps(const AABB& aabb, size_t begin, size_t end, std::vector<int>& out) const {
+    this->queryOverlapsScalar(aabb, begin, end, out);
+}
+
+void BoundsStore::queryPlane(const Plane& plane, size_t begin, size_t end, std::vector<int>& out) const {
+    this->queryPlaneScalar(plane, begin, end, out);
+}
+
+#endif
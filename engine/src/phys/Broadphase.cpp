@@ -0,0 +1,161 @@
+
+#include "phys/Broadphase.h"
+#include "phys/Narrowphase.h"
+
+#include <algorithm>
+
+bool Broadphase::testPair(
+    const RigidBody* A,
+    const RigidBody* B
+) {
+
+    if (!layersCollide(A->collisionLayer, A->collisionMask, B->collisionLayer, B->collisionMask))
+        return false;
+
+    if (!A->canCollide || !B->canCollide)
+        return false;
+
+    if (A == B)
+        return false;
+
+    if ((!A->isDynamic || A->isSleeping) && (!B->isDynamic || B->isSleeping))
+        return false;
+
+    const Collider* colliderA = A->collider.get();
+    const Collider* colliderB = B->collider.get();
+
+    if (!Narrowphase::hasPairTest(colliderA->m_type, colliderB->m_type))
+        return false;
+
+    /* Planes are unbounded */
+    if (colliderA->m_type == ColliderType::PLANE)
+        return colliderB->m_expanded_aabb.intersectsPlane(static_cast<const PlaneCollider*>(colliderA)->m_plane);
+
+    if (colliderB->m_type == ColliderType::PLANE)
+        return colliderA->m_expanded_aabb.intersectsPlane(static_cast<const PlaneCollider*>(colliderB)->m_plane);
+
+    return colliderA->m_expanded_aabb.intersects(colliderB->m_expanded_aabb);
+}
+
+std::vector<CollisionPair> Broadphase::emitPairs(
+    const std::vector<Ref<RigidBody>>& bodies,
+    std::vector<std::pair<int, int>>& candidates
+) {
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<CollisionPair> collisions = {};
+
+    for (auto const& [a, b] : candidates) {
+        RigidBody* A = bodies[a].get();
+        RigidBody* B = bodies[b].get();
+
+        if (Broadphase::testPair(A, B)) {
+            collisions.push_back(CollisionPair(A, B));
+            collisions.back().wakeIfApproaching();
+        }
+    }
+
+    return collisions;
+}
+
+void Broadphase::parallelCollect(
+    size_t count,
+    size_t grain,
+    size_t bodyCount,
+    CandidateBuffer& candidates,
+    const std::function<void(size_t begin, size_t end, CandidateBuffer& buffer)>& collect
+) {
+
+    if (m_workerPool == nullptr || m_workerPool->getThreadCount() == 1 || bodyCount < m_parallelThreshold) {
+        collect(0, count, candidates);
+        return;
+    }
+
+    m_threadBuffers.resize(m_workerPool->getThreadCount());
+
+    for (auto& buffer : m_threadBuffers)
+        buffer.clear();
+
+    m_workerPool->parallelFor(count, grain, [&](size_t begin, size_t end, size_t thread) {
+        collect(begin, end, m_threadBuffers[thread]);
+    });
+
+    for (const auto& buffer : m_threadBuffers)
+        candidates.insert(candidates.end(), buffer.begin(), buffer.end());
+}
+
+void Broadphase::updateBounds(const std::vector<Ref<RigidBody>>& bodies) {
+
+    m_bounds.resize(bodies.size());
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const RigidBody* body = bodies[i].get();
+
+        if (body->canCollide)
+            m_bounds.set(i, body->collider->m_expanded_aabb);
+        else
+            m_bounds.setEmpty(i);
+    }
+}
+
+void Broadphase::collectAgainstAll(
+    const std::vector<Ref<RigidBody>>& bodies,
+    int index,
+    std::vector<std::pair<int, int>>& candidates
+) {
+
+    thread_local std::vector<int> hits;
+    hits.clear();
+
+    const auto& collider = bodies[index]->collider;
+
+    if (collider->m_type == ColliderType::PLANE) {
+        const auto& PC = std::static_pointer_cast<PlaneCollider>(collider);
+        m_bounds.queryPlane(PC->m_plane, 0, bodies.size(), hits);
+    } else {
+        m_bounds.queryOverlaps(collider->m_expanded_aabb, 0, bodies.size(), hits);
+    }
+
+    for (int j : hits) {
+        if (j != index)
+            candidates.emplace_back(std::min(index, j), std::max(index, j));
+    }
+}
+
+std::vector<CollisionPair> BruteForceBroadphase::collectCollisionPairs(
+    const std::vector<Ref<RigidBody>>& bodies,
+    [[maybe_unused]] const float dt
+) {
+
+    this->updateBounds(bodies);
+
+    m_candidates.clear();
+
+    this->parallelCollect(bodies.size(), 32, bodies.size(), m_candidates, [&](size_t begin, size_t end, CandidateBuffer& buffer) {
+        thread_local std::vector<int> hits;
+
+        for (size_t i = begin; i < end; i++) {
+            const RigidBody* body = bodies[i].get();
+
+            if (!body->canCollide || body->collider->m_type == ColliderType::PLANE)
+                continue;
+
+            hits.clear();
+            m_bounds.queryOverlaps(body->collider->m_expanded_aabb, i + 1, bodies.size(), hits);
+
+            for (int j : hits)
+                buffer.emplace_back(static_cast<int>(i), j);
+        }
+    });
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const RigidBody* body = bodies[i].get();
+
+        if (body->canCollide && body->collider->m_type == ColliderType::PLANE)
+            this->collectAgainstAll(bodies, static_cast<int>(i), m_candidates);
+    }
+
+    return Broadphase::emitPairs(bodies, m_candidates);
+}
@@ -1,9 +1,12 @@
 
 #include "phys/Collider.h"
+#include "phys/ConvexHull.h"
 
 #include "common/glm.h"
 #include "geom/BoxGeometry.h"
+#include <glm/gtx/intersect.hpp>
 
+#include <algorithm>
 #include <array>
 
 void Collider::expandAABB(float scalar) { }
@@ -36,12 +39,93 @@ SphereCollider::SphereCollider(const float diameter) {
     m_radius = diameter/2;
 }
 
-MeshCollider::MeshCollider(Ref<Geometry> geometry, bool isConvex) {
+void SphereCollider::expandAABB(float scalar) {
+    m_expanded_aabb = AABB(m_aabb);
+    m_expanded_aabb.expandByScalar(scalar);
+}
+
+void SphereCollider::updateGlobalPose(const Pose& pose) {
+
+    m_relativePosW = (pose.q * m_relativePos) + pose.p;
+
+    m_aabb.set(m_relativePosW - m_radius, m_relativePosW + m_radius);
+}
+
+vec3 SphereCollider::findFurthestPoint(const vec3& dir) const {
+    const float length = glm::length(dir);
+
+    if (length < FLT_EPSILON)
+        return m_relativePosW;
+
+    return m_relativePosW + dir * (m_radius / length);
+}
+
+CapsuleCollider::CapsuleCollider(float radius, float height) {
+    m_type = ColliderType::CAPSULE;
+    m_radius = radius;
+    m_halfHeight = std::max(0.0f, 0.5f * height - radius);
+}
+
+void CapsuleCollider::expandAABB(float scalar) {
+    m_expanded_aabb = AABB(m_aabb);
+    m_expanded_aabb.expandByScalar(scalar);
+}
+
+void CapsuleCollider::updateGlobalPose(const Pose& pose) {
+
+    m_relativePosW = (pose.q * m_relativePos) + pose.p;
+
+    const vec3 axis = pose.q * vec3(0.0f, m_halfHeight, 0.0f);
+
+    m_pointA = m_relativePosW - axis;
+    m_pointB = m_relativePosW + axis;
+
+    m_aabb.set(
+        glm::min(m_pointA, m_pointB) - m_radius,
+        glm::max(m_pointA, m_pointB) + m_radius
+    );
+}
+
+vec3 CapsuleCollider::findFurthestPoint(const vec3& dir) const {
+    const float length = glm::length(dir);
+    const vec3 end = glm::dot(m_pointB - m_pointA, dir) >= 0.0f ? m_pointB : m_pointA;
+
+    if (length < FLT_EPSILON)
+        return end;
+
+    return end + dir * (m_radius / length);
+}
+
+void CapsuleCollider::findSupportFeature(const vec3& dir, SupportFeature& feature) const {
+
+    /* The side of the cylinder is an edge when it is (nearly) perpendicular to dir */
+    const vec3 n = glm::normalize(dir);
+    const vec3 axis = m_pointB - m_pointA;
+    const float length = glm::length(axis);
+
+    if (length > FLT_EPSILON && std::abs(glm::dot(axis, n)) < MeshCollider::FEATURE_TOLERANCE * length) {
+        feature.points[0] = m_pointA + n * m_radius;
+        feature.points[1] = m_pointB + n * m_radius;
+        feature.ids[0] = 0;
+        feature.ids[1] = 1;
+        feature.size = 2;
+
+        return;
+    }
+
+    feature.points[0] = this->findFurthestPoint(dir);
+    feature.ids[0] = glm::dot(axis, n) >= 0.0f ? 1 : 0;
+    feature.size = 1;
+}
+
+MeshCollider::MeshCollider(Ref<Geometry> geometry, bool isConvex, size_t maxHullVertices) {
     
     m_type = isConvex 
         ? ColliderType::CONVEX_MESH 
         : ColliderType::INEFFICIENT_MESH;
 
+    m_maxHullVertices = maxHullVertices;
+
     setGeometry(geometry);
 }
 
@@ -49,49 +133,497 @@ MeshCollider::MeshCollider(Ref<Mesh> mesh)
     : MeshCollider(mesh->m_geometry)
 {}
 
+MeshCollider::MeshCollider(const std::vector<vec3>& points, size_t maxHullVertices) {
+
+    m_type = ColliderType::CONVEX_MESH;
+    m_maxHullVertices = maxHullVertices;
+    m_vertices = points;
+
+    vec3 min = vec3(FLT_MAX);
+    vec3 max = vec3(-FLT_MAX);
+
+    std::vector<unsigned int> candidates(points.size());
+
+    for (size_t i = 0; i < points.size(); i++) {
+        candidates[i] = i;
+
+        min = glm::min(min, points[i]);
+        max = glm::max(max, points[i]);
+    }
+
+    /* The hull triangles stand in for the index buffer, same tolerance as buildSupportGraph() */
+    ConvexHull hull;
+
+    if (hull.build(m_vertices, candidates, 1e-4f * glm::length(max - min), maxHullVertices)) {
+        for (const auto& tri : hull.m_triangles)
+            m_indices.insert(m_indices.end(), tri.begin(), tri.end());
+    }
+
+    this->buildShape();
+}
+
 void MeshCollider::setGeometry(Ref<Geometry> geometry) {
 
     // m_mesh = ref<Mesh>(*geometry);
 
     for (Vertex v : geometry->m_vertexBuffer->m_data) {
         m_vertices.push_back(v.position);
-        m_verticesWorldSpace.push_back(v.position);
     }
 
     if (geometry->hasIndices()) {
         m_indices = geometry->m_indexBuffer->m_data;
 
-        for (int i = 0; i < m_indices.size(); i++) {
-            if (std::find(m_uniqueIndices.begin(), m_uniqueIndices.end(), m_indices[i]) == m_uniqueIndices.end()) {
-                m_uniqueIndices.push_back(m_indices[i]);
+    } else if (m_vertices.size() > 0) {
+        
+        std::cout << "Generating collider indices #INEFFICIENT" << std::endl;
+
+        for (int i = 0; i < m_vertices.size(); i++) {
+            m_indices.push_back(i);
+        }
+
+    }
+
+    this->buildShape();
+}
+
+void MeshCollider::buildShape() {
+
+    for (size_t i = 0; i + 2 < m_indices.size(); i += 3) {
+        std::array<vec3, 4> tri;
+
+        for (int j = 0; j < 3; ++j) {
+            int index = m_indices[i + j];
+            tri[j] = m_vertices[index];
+        }
+
+        /* Precompute normal */
+        const vec3 edge1 = tri[1] - tri[0];
+        const vec3 edge2 = tri[2] - tri[0];
+        tri[3] = glm::normalize(glm::cross(edge1, edge2));
+
+        m_triangles.push_back(tri);
+    }
+
+    this->buildSupportGraph();
+    this->updateLocalBounds();
+
+    if (m_type == ColliderType::INEFFICIENT_MESH)
+        this->buildBVH();
+}
+
+void MeshCollider::buildBVH() {
+
+    m_bvhReady = false;
+    m_bvhOffset = vec3(0.0f);
+
+    if (m_triangles.size() < BVH_ASYNC_TRIANGLES) {
+        m_bvh.build(m_triangles);
+        m_bvhReady = true;
+
+        return;
+    }
+
+    /* Builds from a copy, setRelativePos() may move the triangles meanwhile */
+    m_bvhBuild = std::async(std::launch::async, [this, triangles = m_triangles]() {
+        m_bvh.build(triangles);
+        m_bvhReady.store(true, std::memory_order_release);
+    });
+}
+
+void MeshCollider::updateLocalBounds() {
+
+    vec3 min = vec3(FLT_MAX);
+    vec3 max = vec3(-FLT_MAX);
+    vec3 sum = vec3(0.0f);
+
+    for (auto index : m_supportVertices) {
+        min = glm::min(min, m_vertices[index]);
+        max = glm::max(max, m_vertices[index]);
+        sum += m_vertices[index];
+    }
+
+    m_localAabb.set(min, max);
+
+    if (!m_supportVertices.empty())
+        m_localCentroid = sum / float(m_supportVertices.size());
+}
+
+void MeshCollider::buildSupportGraph() {
+
+    m_supportVertices.clear();
+    m_adjacencyOffsets.clear();
+    m_adjacency.clear();
+    m_hillClimb = false;
+    m_climbStart = {};
+
+    /**
+     * Render buffers duplicate vertices per face (normals, uvs) and along
+     * uv seams, so weld the referenced vertices by position first. Each
+     * group is represented by its lowest vertex index, which keeps ties
+     * resolving the same way as a scan over the full vertex buffer.
+     */
+    std::vector<unsigned int> order;
+    std::vector<bool> referenced(m_vertices.size(), false);
+
+    vec3 min = vec3(FLT_MAX);
+    vec3 max = vec3(-FLT_MAX);
+
+    for (auto index : m_indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            order.push_back(index);
+
+            min = glm::min(min, m_vertices[index]);
+            max = glm::max(max, m_vertices[index]);
+        }
+    }
+
+    const float eps = order.empty() ? 0.0f : 1e-5f * glm::length(max - min);
+
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        return m_vertices[a].x < m_vertices[b].x || (m_vertices[a].x == m_vertices[b].x && a < b);
+    });
+
+    /* Vertex index -> lowest vertex index at the same position */
+    const unsigned int NONE = ~0u;
+    std::vector<unsigned int> weld(m_vertices.size(), NONE);
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const unsigned int a = order[i];
+
+        if (weld[a] != NONE)
+            continue;
+
+        std::vector<unsigned int> group = { a };
+        unsigned int lowest = a;
+
+        for (size_t j = i + 1; j < order.size() && m_vertices[order[j]].x - m_vertices[a].x <= eps; j++) {
+            const unsigned int b = order[j];
+
+            if (weld[b] == NONE && glm::distance(m_vertices[a], m_vertices[b]) <= eps) {
+                group.push_back(b);
+                lowest = std::min(lowest, b);
+            }
+        }
+
+        for (auto index : group)
+            weld[index] = lowest;
+
+        m_supportVertices.push_back(lowest);
+    }
+
+    std::sort(m_supportVertices.begin(), m_supportVertices.end());
+
+    const size_t count = m_supportVertices.size();
+
+    /* Vertex index -> support vertex slot */
+    std::vector<unsigned int> slot(m_vertices.size(), 0);
+
+    for (size_t i = 0; i < count; i++)
+        slot[m_supportVertices[i]] = i;
+
+    for (auto index : order)
+        weld[index] = slot[weld[index]];
+
+    /* Concave meshes only collide through their triangles */
+    if (m_type == ColliderType::INEFFICIENT_MESH)
+        return;
+
+    const float tolerance = 10.0f * eps;
+
+    /* Surface triangles as support vertex slots */
+    std::vector<std::array<unsigned int, 3>> surface;
+
+    /**
+     * Convex shapes collide as the hull of their vertices, which drops the
+     * interior and (within the tolerance) coplanar vertices of the render
+     * mesh. Flat or degenerate geometry keeps its own triangles.
+     */
+    ConvexHull hull;
+
+    const bool isHull = hull.build(m_vertices, m_supportVertices, tolerance, m_maxHullVertices);
+
+    if (isHull) {
+        for (size_t i = 0; i < hull.m_vertices.size(); i++)
+            slot[hull.m_vertices[i]] = i;
+
+        for (const auto& tri : hull.m_triangles)
+            surface.push_back({ slot[tri[0]], slot[tri[1]], slot[tri[2]] });
+
+        m_supportVertices = hull.m_vertices;
+    } else {
+        for (size_t i = 0; i + 2 < m_indices.size(); i += 3)
+            surface.push_back({ weld[m_indices[i]], weld[m_indices[i + 1]], weld[m_indices[i + 2]] });
+    }
+
+    this->buildFaces(surface, tolerance, isHull);
+
+    const size_t supportCount = m_supportVertices.size();
+
+    if (supportCount < HILL_CLIMB_MIN_VERTICES || surface.empty())
+        return;
+
+    /**
+     * Hill climbing only finds the global maximum on a convex surface, so
+     * check that every vertex lies behind every triangle, unless they form
+     * a hull already. This is O(T * V) but only runs once per geometry.
+     */
+    std::vector<vec3> normals;
+    std::vector<std::array<unsigned int, 3>> triangles;
+
+    for (const auto& tri : surface) {
+        const vec3& a = m_vertices[m_supportVertices[tri[0]]];
+        const vec3& b = m_vertices[m_supportVertices[tri[1]]];
+        const vec3& c = m_vertices[m_supportVertices[tri[2]]];
+
+        const vec3 n = glm::cross(b - a, c - a);
+        const float len = glm::length(n);
+
+        if (len <= 0.0f)
+            continue; /* Degenerate */
+
+        for (size_t i = 0; i < supportCount && !isHull; i++) {
+            if (glm::dot(n / len, m_vertices[m_supportVertices[i]] - a) > tolerance)
+                return; /* Not convex, keep scanning */
+        }
+
+        normals.push_back(n / len);
+        triangles.push_back(tri);
+    }
+
+    /**
+     * A vertex whose triangles all share a normal lies inside a face and
+     * is never the unique extreme point. Leaving it out of the graph keeps
+     * the climb from stalling on such a plateau; the face boundary around
+     * it stays connected through the outer edges of its triangle fan.
+     */
+    std::vector<vec3> firstNormal(supportCount, vec3(0.0f));
+    std::vector<bool> flat(supportCount, true);
+
+    for (size_t t = 0; t < triangles.size(); t++) {
+        for (auto v : triangles[t]) {
+            if (firstNormal[v] == vec3(0.0f))
+                firstNormal[v] = normals[t];
+            else if (glm::dot(firstNormal[v], normals[t]) < 1.0f - 1e-4f)
+                flat[v] = false;
+        }
+    }
+
+    std::vector<std::vector<unsigned int>> neighbours(supportCount);
+
+    for (const auto& tri : triangles) {
+        for (int j = 0; j < 3; j++) {
+            const unsigned int a = tri[j];
+            const unsigned int b = tri[(j + 1) % 3];
+
+            if (a == b || flat[a] || flat[b])
+                continue;
+
+            neighbours[a].push_back(b);
+            neighbours[b].push_back(a);
+        }
+    }
+
+    m_adjacencyOffsets.reserve(supportCount + 1);
+    m_adjacencyOffsets.push_back(0);
+
+    for (auto& list : neighbours) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+
+        m_adjacency.insert(m_adjacency.end(), list.begin(), list.end());
+        m_adjacencyOffsets.push_back(m_adjacency.size());
+    }
+
+    /* Start on vertices that are part of the graph, see climb() */
+    for (size_t cell = 0; cell < m_climbStart.size(); cell++) {
+        const vec3 dir = vec3(float(cell / 9), float(cell / 3 % 3), float(cell % 3)) - 1.0f;
+
+        float maxDist = -FLT_MAX;
+
+        for (unsigned int i = 0; i < supportCount; i++) {
+            const float distance = glm::dot(m_vertices[m_supportVertices[i]], dir);
+
+            if (!flat[i] && distance > maxDist) {
+                maxDist = distance;
+                m_climbStart[cell] = i;
+                m_hillClimb = true;
             }
         }
+    }
+}
+
+void MeshCollider::buildFaces(const std::vector<std::array<unsigned int, 3>>& surface, float tolerance, bool isHull) {
+
+    m_faceNormals.clear();
+    m_faceOffsets.clear();
+    m_faceVertices.clear();
+    m_vertexFaceOffsets.clear();
+    m_vertexFaces.clear();
+
+    if (m_type == ColliderType::INEFFICIENT_MESH || surface.empty())
+        return;
+
+    std::vector<vec3> normals(surface.size(), vec3(0.0f));
+
+    for (size_t t = 0; t < surface.size(); t++) {
+        const vec3& pa = m_vertices[m_supportVertices[surface[t][0]]];
+        const vec3& pb = m_vertices[m_supportVertices[surface[t][1]]];
+        const vec3& pc = m_vertices[m_supportVertices[surface[t][2]]];
+
+        const vec3 n = glm::cross(pb - pa, pc - pa);
+        const float len = glm::length(n);
+
+        if (len > 0.0f)
+            normals[t] = n / len;
+    }
 
-        /* Note: looks a lot like updateGlobalPose */
-        for (size_t i = 0; i < m_indices.size(); i += 3) {
-            std::array<vec3, 4> tri;
+    /**
+     * Coplanar triangles of a convex surface are connected, so faces grow
+     * from a seed triangle across shared edges. Edges are matched by
+     * sorting them, (a, b) borders (b, a).
+     */
+    std::vector<std::array<unsigned int, 3>> edges;     /* From, to, triangle */
+    edges.reserve(3 * surface.size());
+
+    for (size_t t = 0; t < surface.size(); t++) {
+        for (int j = 0; j < 3; j++)
+            edges.push_back({ surface[t][j], surface[t][(j + 1) % 3], unsigned(t) });
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    auto across = [&](unsigned int from, unsigned int to, std::vector<unsigned int>& result) {
+        const std::array<unsigned int, 3> key = { to, from, 0 };
+
+        for (auto it = std::lower_bound(edges.begin(), edges.end(), key); it != edges.end() && (*it)[0] == to && (*it)[1] == from; ++it)
+            result.push_back((*it)[2]);
+    };
+
+    /* Group the triangles by plane, as support vertex slots */
+    std::vector<float> offsets;
+    std::vector<std::vector<unsigned int>> groups;
+
+    std::vector<bool> grouped(surface.size(), false);
+    std::vector<unsigned int> stack, next;
+
+    for (size_t seed = 0; seed < surface.size(); seed++) {
+        if (grouped[seed] || normals[seed] == vec3(0.0f))
+            continue; /* Degenerate */
+
+        const vec3 normal = normals[seed];
+        const float offset = glm::dot(normal, m_vertices[m_supportVertices[surface[seed][0]]]);
+
+        m_faceNormals.push_back(normal);
+        offsets.push_back(offset);
+        groups.emplace_back();
+
+        grouped[seed] = true;
+        stack = { unsigned(seed) };
+
+        while (!stack.empty()) {
+            const unsigned int t = stack.back();
+            stack.pop_back();
+
+            groups.back().insert(groups.back().end(), surface[t].begin(), surface[t].end());
+
+            for (int j = 0; j < 3; j++) {
+                next.clear();
+                across(surface[t][j], surface[t][(j + 1) % 3], next);
+
+                for (auto n : next) {
+                    if (grouped[n] || glm::dot(normals[n], normal) <= 1.0f - 1e-4f)
+                        continue;
+
+                    const float distance = glm::dot(normal, m_vertices[m_supportVertices[surface[n][0]]]) - offset;
+
+                    if (std::abs(distance) > tolerance)
+                        continue;
+
+                    grouped[n] = true;
+                    stack.push_back(n);
+                }
+            }
+        }
+    }
 
-            for (int j = 0; j < 3; ++j) {
-                int index = m_indices[i + j];
-                tri[j] = m_vertices[index];
+    /* Clipping against faces only works on a convex hull */
+    for (size_t f = 0; f < groups.size() && !isHull; f++) {
+        for (auto index : m_supportVertices) {
+            if (glm::dot(m_faceNormals[f], m_vertices[index]) > offsets[f] + tolerance) {
+                m_faceNormals.clear();
+                return;
             }
+        }
+    }
+
+    std::vector<std::vector<unsigned int>> vertexFaces(m_supportVertices.size());
+
+    m_faceOffsets.push_back(0);
+
+    for (size_t f = 0; f < groups.size(); f++) {
+        auto& group = groups[f];
+
+        std::sort(group.begin(), group.end());
+        group.erase(std::unique(group.begin(), group.end()), group.end());
+
+        /* Monotone chain in the plane of the face, u × v = normal */
+        const vec3 normal = m_faceNormals[f];
+        const vec3 u = glm::normalize(std::abs(normal.x) < 0.57f
+            ? glm::cross(normal, vec3(1.0f, 0, 0))
+            : glm::cross(normal, vec3(0, 1.0f, 0))
+        );
+        const vec3 v = glm::cross(normal, u);
+
+        auto project = [&](unsigned int slot) {
+            const vec3& p = m_vertices[m_supportVertices[slot]];
+            return vec2(glm::dot(p, u), glm::dot(p, v));
+        };
 
-            /* Precompute normal */
-            const vec3 edge1 = tri[1] - tri[0];
-            const vec3 edge2 = tri[2] - tri[0];
-            tri[3] = glm::normalize(glm::cross(edge1, edge2));
+        std::sort(group.begin(), group.end(), [&](unsigned int a, unsigned int b) {
+            const vec2 pa = project(a), pb = project(b);
+            return pa.x < pb.x || (pa.x == pb.x && pa.y < pb.y);
+        });
 
-            m_triangles.push_back(tri);
+        /* Counter-clockwise, collinear points are dropped */
+        auto turn = [&](unsigned int o, unsigned int a, unsigned int b) {
+            const vec2 po = project(o), pa = project(a), pb = project(b);
+            return (pa.x - po.x) * (pb.y - po.y) - (pa.y - po.y) * (pb.x - po.x);
+        };
+
+        const float minTurn = tolerance * tolerance;
+
+        std::vector<unsigned int> hull(2 * group.size());
+        size_t k = 0;
+
+        for (size_t i = 0; i < group.size(); i++) {
+            while (k >= 2 && turn(hull[k - 2], hull[k - 1], group[i]) <= minTurn)
+                k--;
+            hull[k++] = group[i];
         }
 
-    } else if (m_vertices.size() > 0) {
-        
-        for (int i = 0; i < m_vertices.size(); i++) {
-            std::cout << "Generating collider indices #INEFFICIENT" << std::endl;
-            m_indices.push_back(i);
-            m_uniqueIndices.push_back(i);
+        for (size_t i = group.size() - 1, lower = k + 1; i-- > 0;) {
+            while (k >= lower && turn(hull[k - 2], hull[k - 1], group[i]) <= minTurn)
+                k--;
+            hull[k++] = group[i];
         }
 
+        /* The last point closes the loop */
+        hull.resize(k > 0 ? k - 1 : 0);
+
+        for (auto slot : hull) {
+            m_faceVertices.push_back(m_supportVertices[slot]);
+            vertexFaces[slot].push_back(f);
+        }
+
+        m_faceOffsets.push_back(m_faceVertices.size());
+    }
+
+    m_vertexFaceOffsets.push_back(0);
+
+    for (const auto& list : vertexFaces) {
+        m_vertexFaces.insert(m_vertexFaces.end(), list.begin(), list.end());
+        m_vertexFaceOffsets.push_back(m_vertexFaces.size());
     }
 }
 
@@ -102,6 +634,14 @@ void MeshCollider::setRelativePos(const vec3& pos) {
     for (int i = 0; i < m_vertices.size(); i++) {
         m_vertices[i] += pos;
     }
+
+    for (auto& tri : m_triangles) {
+        for (int j = 0; j < 3; ++j)
+            tri[j] += pos;
+    }
+
+    this->updateLocalBounds();
+    m_bvhOffset += pos;
 }
 
 void MeshCollider::expandAABB(float scalar) {
@@ -111,93 +651,261 @@ void MeshCollider::expandAABB(float scalar) {
 
 void MeshCollider::updateGlobalPose(const Pose& pose) {
 
-    vec3 min = vec3(FLT_MAX);
-    vec3 max = vec3(-FLT_MAX);
-
     m_relativePosW = (pose.q * m_relativePos) + pose.p;
 
-    // for (int i = 0; i < m_vertices.size(); i++) {
-    //     auto v = m_vertices[i];
+    m_pose = pose;
 
-    //     m_verticesWorldSpace[i] = (pose.q * v) + pose.p;
+    /**
+     * Rotated extents: each world axis gets the local half size projected
+     * onto it, so the cost doesn't depend on the vertex count. This is
+     * exact for boxes and conservative for anything else.
+     */
+    const vec3 center = localToWorld(m_localAabb.getCenter());
+    const vec3 halfSize = 0.5f * m_localAabb.getSize();
 
-    //     min = glm::min(min, m_verticesWorldSpace[i]);
-    //     max = glm::max(max, m_verticesWorldSpace[i]);
-    // }
+    const vec3 extents = glm::abs(pose.q * vec3(1.0f, 0, 0)) * halfSize.x
+        + glm::abs(pose.q * vec3(0, 1.0f, 0)) * halfSize.y
+        + glm::abs(pose.q * vec3(0, 0, 1.0f)) * halfSize.z;
 
-    // /* @TODO could probably be a lot more efficient */
-    // int k = 0;
-    // for (size_t i = 0; i < m_indices.size(); i += 3) {
-    //     auto& tri = m_triangles[k];
-        
-    //     for (int j = 0; j < 3; ++j) {
-    //         int index = m_indices[i + j];
-    //         tri[j] = m_verticesWorldSpace[index];
-    //     }
-
-    //     /* Precompute normal */
-    //     const vec3 edge1 = tri[1] - tri[0];
-    //     const vec3 edge2 = tri[2] - tri[0];
-    //     tri[3] = glm::normalize(glm::cross(edge1, edge2));
-
-    //     k++;
-    // }
-
-    /* Combined loop */
-    int k = 0;
-    for (size_t i = 0; i < m_indices.size(); i += 3) {
-        auto& tri = m_triangles[k];
-        
-        for (int j = 0; j < 3; ++j) {
-            int index = m_indices[i + j];
+    m_aabb.set(center - extents, center + extents);
+}
 
-            const auto v = m_vertices[index];
-            m_verticesWorldSpace[index] = (pose.q * v) + pose.p;
+bool MeshCollider::raycast(const vec3& origin, const vec3& dir, float& distance, vec3& normal) const {
 
-            min = glm::min(min, m_verticesWorldSpace[index]);
-            max = glm::max(max, m_verticesWorldSpace[index]);
+    /* Triangles are in body space, move the ray instead. Rigid
+     * transforms keep the distance along the ray the same. */
+    const vec3 localOrigin = worldToLocal(origin);
+    const vec3 localDir = conjugate(m_pose.q) * dir;
 
-            tri[j] = m_verticesWorldSpace[index];
-        }
+    auto intersect = [&](uint32_t index, float& t) {
+        const auto& tri = m_triangles[index];
+        vec2 bary;
 
-        /* Precompute normal */
-        // const vec3 edge1 = tri[1] - tri[0];
-        // const vec3 edge2 = tri[2] - tri[0];
-        // tri[3] = glm::normalize(glm::cross(edge1, edge2));
+        return glm::intersectRayTriangle(localOrigin, localDir, tri[0], tri[1], tri[2], bary, t) && t > 0.0f;
+    };
+
+    float closest = FLT_MAX;
+    int64_t hit = -1;
 
-        k++;
+    if (m_bvhReady.load(std::memory_order_acquire)) {
+        hit = m_bvh.raycast(localOrigin - m_bvhOffset, localDir, closest, intersect);
+    } else {
+        for (uint32_t i = 0; i < m_triangles.size(); i++) {
+            float t;
+
+            if (intersect(i, t) && t < closest) {
+                closest = t;
+                hit = i;
+            }
+        }
     }
 
-    m_aabb.set(min, max);
+    if (hit < 0)
+        return false;
+
+    distance = closest;
+    normal = m_pose.q * m_triangles[size_t(hit)][3];
+
+    return true;
 }
 
 vec3 MeshCollider::findFurthestPoint(const vec3& dir) const {
 
-    vec3 maxPoint;
-    float maxDist = -FLT_MAX;
+    /* Search in body space, only the result is transformed back */
+    const vec3 localDir = conjugate(m_pose.q) * dir;
 
-    for (auto const& vertex : m_verticesWorldSpace) {
-        float distance = glm::dot(vertex, dir);
+    if (!m_hillClimb) {
+        vec3 maxPoint;
+        float maxDist = -FLT_MAX;
 
-        if (distance > maxDist) {
-            maxDist = distance;
-            maxPoint = vertex;
+        for (auto index : m_supportVertices) {
+            const vec3& vertex = m_vertices[index];
+            float distance = glm::dot(vertex, localDir);
+
+            if (distance > maxDist) {
+                maxDist = distance;
+                maxPoint = vertex;
+            }
         }
+
+        return localToWorld(maxPoint);
     }
 
-    return maxPoint;
+    return localToWorld(m_vertices[m_supportVertices[this->climb(localDir)]]);
 }
 
-BoxCollider::BoxCollider(float size) 
-    : MeshCollider(ref<BoxGeometry>(size, size, size)) 
-{
-    m_type = ColliderType::CONVEX_MESH;
+unsigned int MeshCollider::climb(const vec3& localDir) const {
+
+    /* Extreme vertex of the closest of the 26 directions, see m_climbStart */
+    const vec3 a = glm::abs(localDir);
+    const float half = 0.5f * std::max(a.x, std::max(a.y, a.z));
+
+    auto cell = [&](float c) { return c > half ? 2u : (c < -half ? 0u : 1u); };
+
+    /**
+     * Walk to the best neighbour until none improves. On a convex surface
+     * a local maximum is the global one, and the start is usually only a
+     * few steps away from it.
+     */
+    unsigned int best = m_climbStart[cell(localDir.x) * 9 + cell(localDir.y) * 3 + cell(localDir.z)];
+    float bestDist = glm::dot(m_vertices[m_supportVertices[best]], localDir);
+
+    for (;;) {
+        const unsigned int current = best;
+
+        for (unsigned int k = m_adjacencyOffsets[current]; k < m_adjacencyOffsets[current + 1]; k++) {
+            const unsigned int next = m_adjacency[k];
+            const float distance = glm::dot(m_vertices[m_supportVertices[next]], localDir);
+
+            if (distance > bestDist) {
+                bestDist = distance;
+                best = next;
+            }
+        }
+
+        if (best == current)
+            break;
+    }
+
+    return best;
+}
+
+void MeshCollider::findSupportFeature(const vec3& dir, SupportFeature& feature) const {
+
+    const vec3 localDir = conjugate(m_pose.q) * dir;
+    const float tolerance = FEATURE_TOLERANCE * glm::length(m_localAabb.getSize());
+
+    feature.size = 0;
+
+    if (!m_hillClimb) {
+        float maxDist = -FLT_MAX;
+
+        for (auto index : m_supportVertices)
+            maxDist = std::max(maxDist, glm::dot(m_vertices[index], localDir));
+
+        for (auto index : m_supportVertices) {
+            if (feature.size == SupportFeature::MAX_POINTS)
+                break;
+
+            if (glm::dot(m_vertices[index], localDir) < maxDist - tolerance)
+                continue;
+
+            feature.points[feature.size] = localToWorld(m_vertices[index]);
+            feature.ids[feature.size++] = index;
+        }
+
+        return;
+    }
+
+    /* Climb to the support vertex, then flood fill the feature around it */
+    const unsigned int support = this->climb(localDir);
+
+    std::array<unsigned int, SupportFeature::MAX_POINTS> slots;
+    size_t count = 0;
+
+    slots[count++] = support;
+
+    const float minDist = glm::dot(m_vertices[m_supportVertices[support]], localDir) - tolerance;
+
+    for (size_t i = 0; i < count; i++) {
+        for (unsigned int k = m_adjacencyOffsets[slots[i]]; k < m_adjacencyOffsets[slots[i] + 1]; k++) {
+            const unsigned int next = m_adjacency[k];
+
+            if (count == slots.size())
+                break;
+
+            if (glm::dot(m_vertices[m_supportVertices[next]], localDir) < minDist)
+                continue;
+
+            if (std::find(slots.begin(), slots.begin() + count, next) == slots.begin() + count)
+                slots[count++] = next;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const unsigned int index = m_supportVertices[slots[i]];
+
+        feature.points[i] = localToWorld(m_vertices[index]);
+        feature.ids[i] = index;
+    }
+
+    feature.size = count;
 }
 
+bool MeshCollider::findSupportFace(const vec3& dir, SupportFeature& face) const {
+
+    if (m_faceNormals.empty())
+        return false;
+
+    const vec3 localDir = conjugate(m_pose.q) * dir;
+
+    /**
+     * The closest normal is (nearly always) on a face around the support
+     * vertex, so only those are checked when the hull is climbed.
+     */
+    size_t best = 0;
+    float bestDot = -FLT_MAX;
+
+    auto test = [&](size_t f) {
+        const float d = glm::dot(m_faceNormals[f], localDir);
+
+        if (d > bestDot) {
+            bestDot = d;
+            best = f;
+        }
+    };
+
+    if (m_hillClimb) {
+        const unsigned int support = this->climb(localDir);
+
+        for (unsigned int k = m_vertexFaceOffsets[support]; k < m_vertexFaceOffsets[support + 1]; k++)
+            test(m_vertexFaces[k]);
+    }
+
+    if (bestDot == -FLT_MAX) {
+        for (size_t f = 0; f < m_faceNormals.size(); f++)
+            test(f);
+    }
+
+    /* Large faces are thinned out, which keeps a convex polygon */
+    const size_t first = m_faceOffsets[best];
+    const size_t count = m_faceOffsets[best + 1] - first;
+    const size_t size = std::min(count, SupportFeature::MAX_POINTS);
+
+    for (size_t i = 0; i < size; i++) {
+        const unsigned int index = m_faceVertices[first + (i * count) / size];
+
+        face.points[i] = localToWorld(m_vertices[index]);
+        face.ids[i] = index;
+    }
+
+    face.size = size;
+    face.normal = m_pose.q * m_faceNormals[best];
+
+    return true;
+}
+
+BoxCollider::BoxCollider(float size) 
+    : BoxCollider(vec3(size))
+{}
 
 BoxCollider::BoxCollider(const glm::vec3 &size) 
     : MeshCollider(ref<BoxGeometry>(size.x, size.y, size.z)) 
 {
-    // colliderType = ColliderType::BOX;
-    m_type = ColliderType::CONVEX_MESH;
+    m_type = ColliderType::BOX;
+    m_size = size;
+    m_halfSize = 0.5f * size;
+}
+
+vec3 BoxCollider::findFurthestPoint(const vec3& dir) const {
+
+    /* Corner on the side of each axis that dir points to */
+    const vec3 localDir = conjugate(m_pose.q) * dir;
+    const vec3 corner = vec3(
+        localDir.x >= 0.0f ? m_halfSize.x : -m_halfSize.x,
+        localDir.y >= 0.0f ? m_halfSize.y : -m_halfSize.y,
+        localDir.z >= 0.0f ? m_halfSize.z : -m_halfSize.z
+    );
+
+    return localToWorld(corner + m_relativePos);
 }
@@ -0,0 +1,59 @@
+
+#include "phys/CompoundCollider.h"
+
+#include <cassert>
+#include <cfloat>
+
+CompoundCollider::CompoundCollider() {
+    m_type = ColliderType::COMPOUND;
+}
+
+CompoundCollider::CompoundCollider(const std::vector<Child>& children)
+    : CompoundCollider()
+{
+    for (const auto& child : children)
+        this->addChild(child.collider, child.pose);
+}
+
+void CompoundCollider::addChild(Ref<Collider> collider, const Pose& pose) {
+
+    assert(collider != nullptr);
+    assert(collider->m_type != ColliderType::PLANE && collider->m_type != ColliderType::COMPOUND);
+
+    m_children.push_back({ collider, pose });
+}
+
+void CompoundCollider::setRelativePos(const vec3& pos) {
+    m_relativePos = pos;
+    m_relativePosW = pos;
+}
+
+void CompoundCollider::expandAABB(float scalar) {
+    m_expanded_aabb = AABB(m_aabb);
+    m_expanded_aabb.expandByScalar(scalar);
+}
+
+void CompoundCollider::updateGlobalPose(const Pose& pose) {
+
+    m_relativePosW = (pose.q * m_relativePos) + pose.p;
+
+    vec3 min = vec3(FLT_MAX);
+    vec3 max = vec3(-FLT_MAX);
+
+    for (auto& child : m_children) {
+
+        /* Relative position first, then the child pose, then the body */
+        Pose world = Pose(m_relativePos + child.pose.p, child.pose.q);
+        pose.transformPose(world);
+
+        child.collider->updateGlobalPose(world);
+
+        min = glm::min(min, child.collider->m_aabb.min);
+        max = glm::max(max, child.collider->m_aabb.max);
+    }
+
+    if (m_children.empty())
+        min = max = m_relativePosW;
+
+    m_aabb.set(min, max);
+}
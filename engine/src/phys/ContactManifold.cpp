@@ -0,0 +1,456 @@
+
+#include "phys/ContactManifold.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace ContactManifold {
+
+    namespace {
+
+        /* Clipping adds at most one point per reference edge */
+        constexpr size_t MAX_POLYGON = 2 * SupportFeature::MAX_POINTS;
+
+        /* Bits of a point id, below the clip edge is the incident vertex */
+        constexpr uint32_t ID_EDGE_SHIFT = 24;
+        constexpr uint32_t ID_VERTEX_MASK = (1u << ID_EDGE_SHIFT) - 1;
+        constexpr uint32_t ID_REFERENCE_B = 1u << 31;
+        constexpr uint32_t ID_CLOSEST_POINTS = ~0u;
+
+        /* Features flatter than this (relative to their size) are edges */
+        constexpr float FLAT_TOLERANCE = 1e-3f;
+
+        /* Minimum cosine between the reference face and the contact normal */
+        constexpr float MIN_ALIGNMENT = 0.1f;
+
+        /* Hull faces closer to the EPA normal than this are face contacts */
+        constexpr float FACE_ALIGNMENT = 0.98f;
+
+        /**
+         * A support feature as a convex polygon, ordered counter-clockwise
+         * around its outward normal. Edges and vertices have no normal.
+         */
+        struct Polygon {
+            std::array<vec3, MAX_POLYGON> points;
+            std::array<uint32_t, MAX_POLYGON> ids;
+            size_t size = 0;
+
+            vec3 normal = vec3(0.0f);
+
+            inline bool isFace() const { return size >= 3; }
+        };
+
+        void fromFeature(const SupportFeature& feature, Polygon& polygon) {
+            polygon.size = feature.size;
+
+            for (size_t i = 0; i < feature.size; i++) {
+                polygon.points[i] = feature.points[i];
+                polygon.ids[i] = feature.ids[i];
+            }
+        }
+
+        /* Keeps the two points of a (nearly) collinear feature that are furthest apart */
+        void toSegment(Polygon& polygon) {
+
+            size_t a = 0;
+            size_t b = 0;
+            float maxDist = -1.0f;
+
+            for (size_t i = 0; i < polygon.size; i++) {
+                for (size_t j = i + 1; j < polygon.size; j++) {
+                    const float dist = glm::length2(polygon.points[j] - polygon.points[i]);
+
+                    if (dist > maxDist) {
+                        maxDist = dist;
+                        a = i;
+                        b = j;
+                    }
+                }
+            }
+
+            const vec3 pa = polygon.points[a], pb = polygon.points[b];
+            const uint32_t ia = polygon.ids[a], ib = polygon.ids[b];
+
+            polygon.points[0] = pa;
+            polygon.points[1] = pb;
+            polygon.ids[0] = ia;
+            polygon.ids[1] = ib;
+            polygon.size = 2;
+            polygon.normal = vec3(0.0f);
+        }
+
+        /**
+         * Orders the feature around its centroid, as seen from `axis`
+         * (the direction the feature was found with).
+         */
+        void makePolygon(const SupportFeature& feature, const vec3& axis, Polygon& polygon) {
+
+            fromFeature(feature, polygon);
+            polygon.normal = vec3(0.0f);
+
+            if (feature.size < 3)
+                return;
+
+            vec3 center = vec3(0.0f);
+
+            for (size_t i = 0; i < polygon.size; i++)
+                center += polygon.points[i];
+
+            center /= float(polygon.size);
+
+            /* Basis of the plane perpendicular to the axis */
+            const vec3 u = glm::normalize(std::abs(axis.x) < 0.57f
+                ? glm::cross(axis, vec3(1.0f, 0.0f, 0.0f))
+                : glm::cross(axis, vec3(0.0f, 1.0f, 0.0f))
+            );
+            const vec3 v = glm::cross(axis, u);
+
+            std::array<float, MAX_POLYGON> angles;
+            std::array<size_t, MAX_POLYGON> order;
+
+            for (size_t i = 0; i < polygon.size; i++) {
+                const vec3 offset = polygon.points[i] - center;
+
+                angles[i] = std::atan2(glm::dot(offset, v), glm::dot(offset, u));
+                order[i] = i;
+            }
+
+            std::sort(order.begin(), order.begin() + polygon.size, [&](size_t a, size_t b) {
+                return angles[a] < angles[b];
+            });
+
+            const Polygon unordered = polygon;
+
+            for (size_t i = 0; i < polygon.size; i++) {
+                polygon.points[i] = unordered.points[order[i]];
+                polygon.ids[i] = unordered.ids[order[i]];
+            }
+
+            /* Newell's method, |normal| is twice the area */
+            vec3 normal = vec3(0.0f);
+            float extent = 0.0f;
+
+            for (size_t i = 0; i < polygon.size; i++) {
+                const vec3 a = polygon.points[i] - center;
+                const vec3 b = polygon.points[(i + 1) % polygon.size] - center;
+
+                normal += glm::cross(a, b);
+                extent = std::max(extent, glm::length2(a));
+            }
+
+            const float area2 = glm::length(normal);
+
+            if (area2 <= FLAT_TOLERANCE * extent) {
+                toSegment(polygon);
+                return;
+            }
+
+            polygon.normal = normal / area2;
+        }
+
+        /**
+         * Sutherland-Hodgman: keeps the part of `polygon` where
+         * dot(normal, p) <= offset. Points created on the plane get
+         * the clip edge added to their id.
+         */
+        void clip(Polygon& polygon, const vec3& normal, float offset, uint32_t edge) {
+
+            if (polygon.size == 0)
+                return;
+
+            const uint32_t edgeBits = (edge + 1) << ID_EDGE_SHIFT;
+
+            if (polygon.size <= 2) {
+
+                /* Points and segments are not closed, clip the ends */
+                const float da = glm::dot(normal, polygon.points[0]) - offset;
+
+                if (polygon.size == 1) {
+                    polygon.size = da <= 0.0f ? 1 : 0;
+                    return;
+                }
+
+                const float db = glm::dot(normal, polygon.points[1]) - offset;
+
+                if (da > 0.0f && db > 0.0f) {
+                    polygon.size = 0;
+                    return;
+                }
+
+                if (da > 0.0f || db > 0.0f) {
+                    const size_t out = da > 0.0f ? 0 : 1;
+                    const vec3 a = polygon.points[0];
+                    const vec3 b = polygon.points[1];
+
+                    polygon.points[out] = a + (b - a) * (da / (da - db));
+                    polygon.ids[out] = (polygon.ids[0] & ID_VERTEX_MASK) | edgeBits;
+                }
+
+                return;
+            }
+
+            const Polygon input = polygon;
+            polygon.size = 0;
+
+            for (size_t i = 0; i < input.size; i++) {
+                const size_t next = (i + 1) % input.size;
+
+                const vec3 a = input.points[i];
+                const vec3 b = input.points[next];
+
+                const float da = glm::dot(normal, a) - offset;
+                const float db = glm::dot(normal, b) - offset;
+
+                if (da <= 0.0f) {
+                    polygon.points[polygon.size] = a;
+                    polygon.ids[polygon.size++] = input.ids[i];
+                }
+
+                if ((da <= 0.0f) != (db <= 0.0f)) {
+                    polygon.points[polygon.size] = a + (b - a) * (da / (da - db));
+                    polygon.ids[polygon.size++] = (input.ids[i] & ID_VERTEX_MASK) | edgeBits;
+                }
+            }
+        }
+    }
+
+    void generate(
+        Collider* colliderA,
+        Collider* colliderB,
+        const GjkEpa::Contact& contact,
+        Manifold& manifold,
+        float margin
+    ) {
+
+        assert(colliderA != nullptr);
+        assert(colliderB != nullptr);
+
+        vec3 n = contact.normal;
+
+        manifold.normal = n;
+        manifold.size = 0;
+
+        Polygon reference, incident;
+        bool refIsA = true;
+        bool clipped = false;
+
+        SupportFeature faceA, faceB;
+
+        if (colliderA->findSupportFace(n, faceA) && colliderB->findSupportFace(-n, faceB)) {
+
+            /**
+             * The face most aligned with the normal is the reference, A wins
+             * ties so the choice doesn't flip between steps. The incident
+             * face is the one facing it the most. If neither face is close
+             * to the normal, the contact is between two edges.
+             */
+            const float alignA = glm::dot(faceA.normal, n);
+            const float alignB = glm::dot(faceB.normal, -n);
+
+            if (std::max(alignA, alignB) >= FACE_ALIGNMENT) {
+                refIsA = alignA >= alignB - 1e-3f;
+
+                const SupportFeature& face = refIsA ? faceA : faceB;
+                SupportFeature other;
+
+                (refIsA ? colliderB : colliderA)->findSupportFace(-face.normal, other);
+
+                fromFeature(face, reference);
+                fromFeature(other, incident);
+
+                reference.normal = face.normal;
+                n = refIsA ? face.normal : -face.normal;
+
+                clipped = true;
+            }
+
+        } else {
+
+            /* No faces, use whatever is furthest along the normal */
+            SupportFeature featureA, featureB;
+
+            colliderA->findSupportFeature(n, featureA);
+            colliderB->findSupportFeature(-n, featureB);
+
+            Polygon polygonA, polygonB;
+
+            makePolygon(featureA, n, polygonA);
+            makePolygon(featureB, -n, polygonB);
+
+            if (polygonA.isFace() || polygonB.isFace()) {
+                refIsA = polygonA.isFace() && (
+                    !polygonB.isFace() ||
+                    glm::dot(polygonA.normal, n) >= glm::dot(polygonB.normal, -n) - 1e-3f
+                );
+
+                reference = refIsA ? polygonA : polygonB;
+                incident = refIsA ? polygonB : polygonA;
+
+                clipped = true;
+            }
+        }
+
+        std::array<Point, MAX_POLYGON> points;
+        size_t count = 0;
+        bool touching = false;
+
+        /* Direction the incident points are moved in to reach the reference face */
+        const vec3 towardsReference = refIsA ? n : -n;
+        const float alignment = glm::dot(towardsReference, reference.normal);
+
+        if (clipped && incident.size > 0 && alignment > MIN_ALIGNMENT) {
+
+            /* Side planes, facing out of the reference face */
+            for (size_t k = 0; k < reference.size; k++) {
+                const vec3 a = reference.points[k];
+                const vec3 b = reference.points[(k + 1) % reference.size];
+                const vec3 side = glm::cross(b - a, reference.normal);
+
+                clip(incident, side, glm::dot(side, a), uint32_t(k));
+            }
+
+            const vec3 origin = reference.points[0];
+
+            for (size_t i = 0; i < incident.size; i++) {
+                const vec3 p = incident.points[i];
+
+                /* Below the reference face, i.e. inside the other body */
+                const float separation = glm::dot(p - origin, reference.normal);
+
+                if (separation >= margin)
+                    continue;
+
+                const float d = -separation / alignment;
+                touching |= d > 0.0f;
+
+                Point& point = points[count++];
+
+                point.p1 = refIsA ? p + n * d : p;
+                point.p2 = refIsA ? p : p - n * d;
+                point.normal = n;
+                point.d = d;
+                point.id = incident.ids[i] | (refIsA ? 0 : ID_REFERENCE_B);
+            }
+        }
+
+        /* Speculative contacts (separated shapes) keep the clipped points within the margin */
+        if (contact.d <= 0.0f && count > 0)
+            touching = true;
+
+        if (!touching) {
+            /* Vertex or crossing edges, EPA already found the closest points */
+            Point& point = manifold.points[0];
+
+            point.p1 = contact.p1;
+            point.p2 = contact.p2;
+            point.normal = contact.normal;
+            point.d = contact.d;
+            point.id = ID_CLOSEST_POINTS;
+
+            manifold.size = 1;
+            return;
+        }
+
+        count = ContactManifold::reduce(points.data(), count, n, MAX_POINTS);
+
+        for (size_t i = 0; i < count; i++)
+            manifold.points[i] = points[i];
+
+        manifold.normal = n;
+        manifold.size = count;
+    }
+
+    size_t reduce(
+        Point* points,
+        size_t count,
+        const vec3& normal,
+        size_t maxPoints
+    ) {
+
+        constexpr size_t MAX_KEPT = 16;
+
+        assert(maxPoints >= 1 && maxPoints <= MAX_KEPT);
+
+        if (count <= maxPoints)
+            return count;
+
+        /* Deepest point */
+        size_t best = 0;
+
+        for (size_t i = 1; i < count; i++) {
+            if (points[i].d > points[best].d)
+                best = i;
+        }
+
+        std::swap(points[0], points[best]);
+
+        if (maxPoints == 1)
+            return 1;
+
+        /* Furthest from the deepest */
+        float maxDist = -1.0f;
+
+        for (size_t i = 1; i < count; i++) {
+            const float dist = glm::length2(points[i].p1 - points[0].p1);
+
+            if (dist > maxDist) {
+                maxDist = dist;
+                best = i;
+            }
+        }
+
+        std::swap(points[1], points[best]);
+
+        /**
+         * Grow the polygon of the kept points (counter-clockwise around the
+         * normal) by the point that adds the largest triangle on one of its
+         * edges. The segment of the first two points has one edge per side.
+         */
+        std::array<size_t, MAX_KEPT> polygon = { 0, 1 };
+        size_t polygonSize = 2;
+        size_t kept = 2;
+
+        const float minArea = FLT_EPSILON * maxDist;
+
+        while (kept < maxPoints) {
+            float maxArea = minArea;
+            size_t bestPoint = count;
+            size_t bestEdge = 0;
+
+            for (size_t i = kept; i < count; i++) {
+                for (size_t e = 0; e < polygonSize; e++) {
+                    const vec3 a = points[polygon[e]].p1;
+                    const vec3 b = points[polygon[(e + 1) % polygonSize]].p1;
+
+                    /* Outside of the edge if negative */
+                    const float area = -0.5f * glm::dot(glm::cross(b - a, points[i].p1 - a), normal);
+
+                    if (area > maxArea) {
+                        maxArea = area;
+                        bestPoint = i;
+                        bestEdge = e;
+                    }
+                }
+            }
+
+            if (bestPoint == count)
+                break;
+
+            std::swap(points[kept], points[bestPoint]);
+
+            std::copy_backward(
+                polygon.begin() + bestEdge + 1,
+                polygon.begin() + polygonSize,
+                polygon.begin() + polygonSize + 1
+            );
+            polygon[bestEdge + 1] = kept;
+            polygonSize++;
+
+            kept++;
+        }
+
+        return kept;
+    }
+};
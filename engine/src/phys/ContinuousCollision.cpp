@@ -0,0 +1,128 @@
+
+#include "phys/ContinuousCollision.h"
+#include "phys/Narrowphase.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace ContinuousCollision {
+
+    namespace {
+
+        constexpr int MAX_ITERATIONS = 32;
+
+        /* Rotation from one orientation to the other, as an angle (0 to π) around a unit axis */
+        void relativeRotation(const quat& from, const quat& to, vec3& axis, float& angle) {
+            quat dq = to * glm::conjugate(from);
+
+            /* The short way around */
+            if (dq.w < 0.0f)
+                dq = quat(-dq.w, -dq.x, -dq.y, -dq.z);
+
+            const vec3 v = vec3(dq.x, dq.y, dq.z);
+            const float s = glm::length(v);
+
+            angle = 2.0f * std::atan2(s, dq.w);
+            axis = s > 0.0f ? v / s : vec3(1.0f, 0.0f, 0.0f);
+        }
+
+        /* Furthest any point of the collider can be from the center of the body */
+        float boundingRadius(const RigidBody* body) {
+            const AABB& aabb = body->collider->m_aabb;
+
+            if (!aabb.isFinite())
+                return 0.0f;
+
+            const vec3 extent = glm::max(
+                glm::abs(aabb.max - body->prevPose.p),
+                glm::abs(aabb.min - body->prevPose.p)
+            );
+
+            return glm::length(extent);
+        }
+    }
+
+    Pose interpolate(const Pose& from, const Pose& to, float t) {
+        vec3 axis;
+        float angle;
+
+        relativeRotation(from.q, to.q, axis, angle);
+
+        return Pose(
+            from.p + (to.p - from.p) * t,
+            glm::normalize(glm::angleAxis(angle * t, axis) * from.q)
+        );
+    }
+
+    bool timeOfImpact(
+        RigidBody* A,
+        RigidBody* B,
+        float tolerance,
+        float& t
+    ) {
+
+        assert(A != nullptr && B != nullptr);
+
+        Collider* colliderA = A->collider.get();
+        Collider* colliderB = B->collider.get();
+
+        vec3 axis;
+        float angleA, angleB;
+
+        relativeRotation(A->prevPose.q, A->pose.q, axis, angleA);
+        relativeRotation(B->prevPose.q, B->pose.q, axis, angleB);
+
+        const vec3 motion = (A->pose.p - A->prevPose.p) - (B->pose.p - B->prevPose.p);
+
+        /* Fastest any point can move due to the rotations, per unit of t */
+        const float angular = (angleA > 0.0f ? angleA * boundingRadius(A) : 0.0f)
+            + (angleB > 0.0f ? angleB * boundingRadius(B) : 0.0f);
+
+        /* Static and sleeping bodies are shared with other islands, their colliders are left alone */
+        const bool movesA = A->isDynamic && !A->isSleeping;
+        const bool movesB = B->isDynamic && !B->isSleeping;
+
+        bool hit = false;
+        t = 0.0f;
+
+        /* The colliders were last updated at the start of the substep, i.e. at t = 0 */
+        for (int i = 0; i < MAX_ITERATIONS; i++) {
+            if (i > 0) {
+                if (movesA) colliderA->updateGlobalPose(interpolate(A->prevPose, A->pose, t));
+                if (movesB) colliderB->updateGlobalPose(interpolate(B->prevPose, B->pose, t));
+            }
+
+            GjkEpa::ClosestPoints closest;
+
+            if (!Narrowphase::distance(colliderA, colliderB, FLT_MAX, closest))
+                break;
+
+            const float distance = closest.overlapping ? 0.0f : closest.distance;
+
+            /* Touching from the start is left to the contacts */
+            if (distance <= tolerance) {
+                hit = i > 0;
+                break;
+            }
+
+            /* Upper bound of the approach speed of any pair of points */
+            const float speed = glm::dot(motion, closest.normal) + angular;
+
+            if (speed <= 0.0f)
+                break;
+
+            t += distance / speed;
+
+            if (t >= 1.0f)
+                break;
+        }
+
+        if (t > 0.0f) {
+            if (movesA) colliderA->updateGlobalPose(A->prevPose);
+            if (movesB) colliderB->updateGlobalPose(B->prevPose);
+        }
+
+        return hit;
+    }
+};
@@ -0,0 +1,501 @@
+
+#include "phys/ConvexDecomposition.h"
+#include "phys/ConvexHull.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace ConvexDecomposition {
+
+    namespace {
+
+        constexpr uint8_t EMPTY = 0;
+        constexpr uint8_t SURFACE = 1;
+        constexpr uint8_t OUTSIDE = 2;
+
+        /* Hulls are built in voxel units, corners are whole numbers */
+        constexpr float HULL_TOLERANCE = 1e-3f;
+
+        struct Grid {
+            ivec3 size = ivec3(0);
+            vec3 origin = vec3(0.0f);
+            float voxelSize = 0.0f;
+
+            std::vector<uint8_t> cells;
+
+            inline size_t index(int x, int y, int z) const {
+                return size_t(x) + size_t(size.x) * (size_t(y) + size_t(size.y) * size_t(z));
+            }
+        };
+
+        /* A set of voxels, sorted by z, y then x so that rows along X are contiguous */
+        struct Part {
+            std::vector<ivec3> voxels;
+            float hullVolume = 0.0f;
+            ivec3 min = ivec3(0);
+            ivec3 max = ivec3(0);
+        };
+
+        inline bool rowOrder(const ivec3& a, const ivec3& b) {
+            return a.z < b.z || (a.z == b.z && (a.y < b.y || (a.y == b.y && a.x < b.x)));
+        }
+
+        /**
+         * Triangle / box overlap, separating axes: the box faces, the
+         * triangle normal and the cross products of the edges.
+         * Real-Time Collision Detection (Ericson), 5.2.9
+         */
+        bool triangleBoxOverlap(vec3 a, vec3 b, vec3 c, const vec3& center, float halfSize) {
+            a -= center;
+            b -= center;
+            c -= center;
+
+            auto separated = [&](const vec3& axis) {
+                const float pa = glm::dot(a, axis);
+                const float pb = glm::dot(b, axis);
+                const float pc = glm::dot(c, axis);
+                const float r = halfSize * (std::abs(axis.x) + std::abs(axis.y) + std::abs(axis.z));
+
+                return std::max(pa, std::max(pb, pc)) < -r || std::min(pa, std::min(pb, pc)) > r;
+            };
+
+            const std::array<vec3, 3> edges = { b - a, c - b, a - c };
+
+            for (int i = 0; i < 3; i++) {
+                vec3 axis = vec3(0.0f);
+                axis[i] = 1.0f;
+
+                if (separated(axis))
+                    return false;
+
+                for (const auto& edge : edges) {
+                    if (separated(glm::cross(edge, axis)))
+                        return false;
+                }
+            }
+
+            return !separated(glm::cross(edges[0], edges[1]));
+        }
+
+        /* Marks the voxels touching a triangle, then everything reachable from the border as outside */
+        Grid voxelize(const std::vector<vec3>& vertices, const std::vector<unsigned int>& indices, size_t resolution) {
+            Grid grid;
+
+            vec3 min = vec3(FLT_MAX);
+            vec3 max = vec3(-FLT_MAX);
+
+            for (auto index : indices) {
+                min = glm::min(min, vertices[index]);
+                max = glm::max(max, vertices[index]);
+            }
+
+            const vec3 extent = max - min;
+            const float longest = std::max(extent.x, std::max(extent.y, extent.z));
+
+            if (indices.size() < 3 || !(longest > 0.0f))
+                return grid;
+
+            grid.voxelSize = longest / float(std::max<size_t>(resolution, 1));
+
+            /**
+             * Two layers around the mesh: faces on the bounds can mark the
+             * first one, the outer one stays empty so the outside is connected
+             */
+            grid.origin = min - 2.0f * grid.voxelSize;
+            grid.size = ivec3(glm::ceil(extent / grid.voxelSize)) + 4;
+            grid.cells.assign(size_t(grid.size.x) * grid.size.y * grid.size.z, EMPTY);
+
+            const float halfSize = 0.5f * grid.voxelSize;
+
+            auto cell = [&](const vec3& p) {
+                return glm::clamp(ivec3(glm::floor((p - grid.origin) / grid.voxelSize)), ivec3(0), grid.size - 1);
+            };
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                const vec3& a = vertices[indices[i]];
+                const vec3& b = vertices[indices[i + 1]];
+                const vec3& c = vertices[indices[i + 2]];
+
+                /* Faces on a voxel boundary touch the cells on both sides, either may win the rounding */
+                const ivec3 from = glm::max(cell(glm::min(a, glm::min(b, c))) - 1, ivec3(0));
+                const ivec3 to = glm::min(cell(glm::max(a, glm::max(b, c))) + 1, grid.size - 1);
+
+                for (int z = from.z; z <= to.z; z++) {
+                    for (int y = from.y; y <= to.y; y++) {
+                        for (int x = from.x; x <= to.x; x++) {
+                            const vec3 center = grid.origin + (vec3(x, y, z) + 0.5f) * grid.voxelSize;
+
+                            if (triangleBoxOverlap(a, b, c, center, halfSize))
+                                grid.cells[grid.index(x, y, z)] = SURFACE;
+                        }
+                    }
+                }
+            }
+
+            /* Flood fill from a corner, which is in the empty layer */
+            std::vector<ivec3> stack = { ivec3(0) };
+            grid.cells[0] = OUTSIDE;
+
+            const std::array<ivec3, 6> neighbours = {
+                ivec3(1, 0, 0), ivec3(-1, 0, 0),
+                ivec3(0, 1, 0), ivec3(0, -1, 0),
+                ivec3(0, 0, 1), ivec3(0, 0, -1)
+            };
+
+            while (!stack.empty()) {
+                const ivec3 v = stack.back();
+                stack.pop_back();
+
+                for (const auto& offset : neighbours) {
+                    const ivec3 n = v + offset;
+
+                    if (glm::any(glm::lessThan(n, ivec3(0))) || glm::any(glm::greaterThanEqual(n, grid.size)))
+                        continue;
+
+                    uint8_t& value = grid.cells[grid.index(n.x, n.y, n.z)];
+
+                    if (value == EMPTY) {
+                        value = OUTSIDE;
+                        stack.push_back(n);
+                    }
+                }
+            }
+
+            return grid;
+        }
+
+        /**
+         * Hull of a voxel set, in voxel units. Each row along X spans a box,
+         * and the hull of the boxes is the hull of their corners, so only
+         * those of the first and last voxel of each row are needed.
+         */
+        bool buildHull(const std::vector<ivec3>& voxels, ConvexHull& hull, std::vector<vec3>& points, size_t maxVertices = 0) {
+            thread_local std::vector<ivec3> corners;
+            thread_local std::vector<unsigned int> candidates;
+
+            corners.clear();
+
+            for (size_t i = 0; i < voxels.size();) {
+                size_t j = i;
+
+                while (j + 1 < voxels.size() && voxels[j + 1].y == voxels[i].y && voxels[j + 1].z == voxels[i].z)
+                    j++;
+
+                for (int dz = 0; dz < 2; dz++) {
+                    for (int dy = 0; dy < 2; dy++) {
+                        corners.push_back(ivec3(voxels[i].x, voxels[i].y + dy, voxels[i].z + dz));
+                        corners.push_back(ivec3(voxels[j].x + 1, voxels[i].y + dy, voxels[i].z + dz));
+                    }
+                }
+
+                i = j + 1;
+            }
+
+            /* Neighbouring rows share corners, the hull wants unique points */
+            std::sort(corners.begin(), corners.end(), rowOrder);
+            corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+
+            points.resize(corners.size());
+            candidates.resize(corners.size());
+
+            for (size_t i = 0; i < corners.size(); i++) {
+                points[i] = vec3(corners[i]);
+                candidates[i] = i;
+            }
+
+            return hull.build(points, candidates, HULL_TOLERANCE, maxVertices);
+        }
+
+        float hullVolume(const std::vector<ivec3>& voxels) {
+            thread_local ConvexHull hull;
+            thread_local std::vector<vec3> points;
+
+            if (!buildHull(voxels, hull, points))
+                return float(voxels.size());
+
+            /* Sum of the tetrahedra from the origin to each face */
+            float volume = 0.0f;
+
+            for (const auto& tri : hull.m_triangles)
+                volume += glm::dot(points[tri[0]], glm::cross(points[tri[1]], points[tri[2]]));
+
+            return volume / 6.0f;
+        }
+
+        void updateBounds(Part& part) {
+            part.min = ivec3(INT32_MAX);
+            part.max = ivec3(INT32_MIN);
+
+            for (const auto& v : part.voxels) {
+                part.min = glm::min(part.min, v);
+                part.max = glm::max(part.max, v);
+            }
+        }
+
+        void split(Part& part, size_t depth, float totalVolume, const Params& params, std::vector<Part>& parts) {
+
+            const float concavity = (part.hullVolume - float(part.voxels.size())) / totalVolume;
+
+            if (concavity <= params.maxConcavity || depth >= params.maxDepth || part.voxels.size() < 2) {
+                parts.push_back(std::move(part));
+                return;
+            }
+
+            Part left, right, bestLeft, bestRight;
+            float bestCost = FLT_MAX;
+            int bestAxis = -1, bestCut = 0;
+
+            /* Voxels before the cut go left */
+            auto evaluate = [&](int axis, int cut) {
+                left.voxels.clear();
+                right.voxels.clear();
+
+                for (const auto& v : part.voxels)
+                    (v[axis] < cut ? left : right).voxels.push_back(v);
+
+                if (left.voxels.empty() || right.voxels.empty())
+                    return;
+
+                left.hullVolume = hullVolume(left.voxels);
+                right.hullVolume = hullVolume(right.voxels);
+
+                const float cost = (left.hullVolume - float(left.voxels.size()))
+                    + (right.hullVolume - float(right.voxels.size()));
+
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestCut = cut;
+                    std::swap(left, bestLeft);
+                    std::swap(right, bestRight);
+                }
+            };
+
+            /* Cuts spread evenly over the part first, then every cut between the neighbours of the best one */
+            int bestStep = 1;
+
+            for (int axis = 0; axis < 3; axis++) {
+                const int extent = part.max[axis] - part.min[axis] + 1;
+
+                if (extent < 2)
+                    continue;
+
+                const int samples = int(std::min<size_t>(params.planeSamples, size_t(extent - 1)));
+                const int step = std::max(1, extent / (samples + 1));
+
+                for (int s = 1; s <= samples; s++) {
+                    const float costBefore = bestCost;
+
+                    evaluate(axis, part.min[axis] + (s * extent) / (samples + 1));
+
+                    if (bestCost < costBefore)
+                        bestStep = step;
+                }
+            }
+
+            if (bestAxis >= 0) {
+                const int axis = bestAxis;
+                const int center = bestCut;
+
+                for (int cut = center - bestStep + 1; cut < center + bestStep; cut++) {
+                    if (cut != center && cut > part.min[axis] && cut <= part.max[axis])
+                        evaluate(axis, cut);
+                }
+            }
+
+            if (bestCost == FLT_MAX) {
+                parts.push_back(std::move(part));
+                return;
+            }
+
+            part.voxels.clear();
+            part.voxels.shrink_to_fit();
+
+            updateBounds(bestLeft);
+            updateBounds(bestRight);
+
+            split(bestLeft, depth + 1, totalVolume, params, parts);
+            split(bestRight, depth + 1, totalVolume, params, parts);
+        }
+
+        /* Touching or overlapping bounds, only such parts are merged */
+        inline bool adjacent(const Part& a, const Part& b) {
+            return glm::all(glm::lessThanEqual(a.min, b.max + 1)) && glm::all(glm::lessThanEqual(b.min, a.max + 1));
+        }
+
+        /* Added hull volume if a and b were one part */
+        float mergeCost(const Part& a, const Part& b, std::vector<ivec3>& merged) {
+            merged.resize(a.voxels.size() + b.voxels.size());
+            std::merge(a.voxels.begin(), a.voxels.end(), b.voxels.begin(), b.voxels.end(), merged.begin(), rowOrder);
+
+            return hullVolume(merged) - a.hullVolume - b.hullVolume;
+        }
+
+        /**
+         * Joins neighbours while there are too many parts, or while joining
+         * them adds less concavity than the threshold: cuts are greedy, and
+         * often leave slivers of a part that was convex to begin with.
+         */
+        void merge(std::vector<Part>& parts, float totalVolume, const Params& params) {
+
+            const size_t count = parts.size();
+            const size_t maxHulls = std::max<size_t>(params.maxHulls, 1);
+            const float maxCost = params.maxConcavity * totalVolume;
+
+            if (count < 2)
+                return;
+
+            std::vector<ivec3> merged;
+
+            /* Pairwise costs, FLT_MAX for parts that don't touch */
+            std::vector<float> costs(count * count, FLT_MAX);
+            std::vector<bool> alive(count, true);
+
+            auto updateCosts = [&](size_t i) {
+                for (size_t j = 0; j < count; j++) {
+                    if (j == i || !alive[j])
+                        continue;
+
+                    const float cost = adjacent(parts[i], parts[j])
+                        ? mergeCost(parts[i], parts[j], merged)
+                        : FLT_MAX;
+
+                    costs[i * count + j] = costs[j * count + i] = cost;
+                }
+            };
+
+            for (size_t i = 0; i < count; i++)
+                updateCosts(i);
+
+            for (size_t remaining = count; remaining > 1; remaining--) {
+                size_t bestI = count, bestJ = count;
+                float bestCost = FLT_MAX;
+
+                for (size_t i = 0; i < count; i++) {
+                    for (size_t j = i + 1; j < count && alive[i]; j++) {
+                        if (alive[j] && costs[i * count + j] < bestCost) {
+                            bestCost = costs[i * count + j];
+                            bestI = i;
+                            bestJ = j;
+                        }
+                    }
+                }
+
+                if (remaining <= maxHulls && bestCost > maxCost)
+                    break;
+
+                /* Only separate islands left, join the smallest hulls instead */
+                if (bestI == count) {
+                    for (size_t i = 0; i < count; i++) {
+                        for (size_t j = i + 1; j < count && alive[i]; j++) {
+                            const float cost = parts[i].hullVolume + parts[j].hullVolume;
+
+                            if (alive[j] && cost < bestCost) {
+                                bestCost = cost;
+                                bestI = i;
+                                bestJ = j;
+                            }
+                        }
+                    }
+                }
+
+                Part& a = parts[bestI];
+                Part& b = parts[bestJ];
+
+                merged.resize(a.voxels.size() + b.voxels.size());
+                std::merge(a.voxels.begin(), a.voxels.end(), b.voxels.begin(), b.voxels.end(), merged.begin(), rowOrder);
+
+                a.voxels.swap(merged);
+                a.hullVolume = hullVolume(a.voxels);
+                a.min = glm::min(a.min, b.min);
+                a.max = glm::max(a.max, b.max);
+
+                b.voxels.clear();
+                b.voxels.shrink_to_fit();
+                alive[bestJ] = false;
+
+                updateCosts(bestI);
+            }
+
+            parts.erase(
+                std::remove_if(parts.begin(), parts.end(), [](const Part& part) { return part.voxels.empty(); }),
+                parts.end()
+            );
+        }
+    }
+
+    std::vector<std::vector<vec3>> decompose(
+        const std::vector<vec3>& vertices,
+        const std::vector<unsigned int>& indices,
+        const Params& params
+    ) {
+
+        std::vector<std::vector<vec3>> result;
+
+        const Grid grid = voxelize(vertices, indices, params.resolution);
+
+        Part solid;
+
+        for (int z = 0; z < grid.size.z; z++) {
+            for (int y = 0; y < grid.size.y; y++) {
+                for (int x = 0; x < grid.size.x; x++) {
+                    if (grid.cells[grid.index(x, y, z)] != OUTSIDE)
+                        solid.voxels.push_back(ivec3(x, y, z));
+                }
+            }
+        }
+
+        if (solid.voxels.empty())
+            return result;
+
+        const float totalVolume = float(solid.voxels.size());
+
+        solid.hullVolume = hullVolume(solid.voxels);
+        updateBounds(solid);
+
+        std::vector<Part> parts;
+        split(solid, 0, totalVolume, params, parts);
+        merge(parts, totalVolume, params);
+
+        ConvexHull hull;
+        std::vector<vec3> points;
+
+        for (const auto& part : parts) {
+            if (!buildHull(part.voxels, hull, points, params.maxHullVertices))
+                continue;
+
+            auto& out = result.emplace_back();
+
+            for (auto index : hull.m_vertices)
+                out.push_back(grid.origin + points[index] * grid.voxelSize);
+        }
+
+        return result;
+    }
+
+    Ref<CompoundCollider> createCompound(Ref<Geometry> geometry, const Params& params) {
+
+        std::vector<vec3> vertices;
+        std::vector<unsigned int> indices;
+
+        for (const auto& v : geometry->m_vertexBuffer->m_data)
+            vertices.push_back(v.position);
+
+        if (geometry->hasIndices()) {
+            indices = geometry->m_indexBuffer->m_data;
+        } else {
+            for (size_t i = 0; i < vertices.size(); i++)
+                indices.push_back(i);
+        }
+
+        auto compound = ref<CompoundCollider>();
+
+        for (const auto& points : decompose(vertices, indices, params))
+            compound->addChild(ref<MeshCollider>(points, params.maxHullVertices));
+
+        return compound;
+    }
+};
@@ -0,0 +1,324 @@
+
+#include "phys/ConvexHull.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <queue>
+#include <utility>
+
+namespace {
+
+    constexpr unsigned int NONE = ~0u;
+
+    struct Face {
+        std::array<unsigned int, 3> vertices;
+
+        /* Face across the edge vertices[i] -> vertices[i + 1] */
+        std::array<unsigned int, 3> neighbours = { NONE, NONE, NONE };
+
+        vec3 normal = vec3(0.0f);
+        float offset = 0.0f;
+
+        /* Points in front of this face (and no face before it), furthest one first */
+        std::vector<unsigned int> outside;
+        float furthest = 0.0f;
+
+        bool visible = false;
+        bool removed = false;
+
+        inline float distance(const vec3& p) const {
+            return glm::dot(normal, p) - offset;
+        }
+    };
+
+    Face makeFace(const std::vector<vec3>& points, unsigned int a, unsigned int b, unsigned int c) {
+        Face face;
+        face.vertices = { a, b, c };
+
+        const vec3 n = glm::cross(points[b] - points[a], points[c] - points[a]);
+        const float length = glm::length(n);
+
+        /* Slivers next to the horizon can be (nearly) flat, any plane through them will do */
+        face.normal = length > 0.0f ? n / length : vec3(0.0f);
+        face.offset = glm::dot(face.normal, points[a]);
+
+        return face;
+    }
+
+    /* Puts a point in the outside set of the face it is furthest in front of, if any */
+    void assign(
+        std::vector<Face>& faces,
+        const std::vector<unsigned int>& candidates,
+        const std::vector<vec3>& points,
+        unsigned int index,
+        float tolerance
+    ) {
+        unsigned int best = NONE;
+        float bestDistance = tolerance;
+
+        for (auto f : candidates) {
+            const float distance = faces[f].distance(points[index]);
+
+            if (distance > bestDistance) {
+                bestDistance = distance;
+                best = f;
+            }
+        }
+
+        if (best == NONE)
+            return;
+
+        Face& face = faces[best];
+
+        if (bestDistance > face.furthest) {
+            face.furthest = bestDistance;
+            face.outside.insert(face.outside.begin(), index);
+        } else {
+            face.outside.push_back(index);
+        }
+    }
+
+    /* Edge slot of `face` that runs from a to b */
+    inline int findEdge(const Face& face, unsigned int a, unsigned int b) {
+        for (int i = 0; i < 3; i++) {
+            if (face.vertices[i] == a && face.vertices[(i + 1) % 3] == b)
+                return i;
+        }
+
+        return -1;
+    }
+}
+
+bool ConvexHull::build(
+    const std::vector<vec3>& points,
+    const std::vector<unsigned int>& candidates,
+    float tolerance,
+    size_t maxVertices
+) {
+
+    m_vertices.clear();
+    m_triangles.clear();
+
+    if (candidates.size() < 4)
+        return false;
+
+    /**
+     * Initial tetrahedron: the longest segment between the extreme points
+     * along the axes, the point furthest from its line and then the point
+     * furthest from that plane.
+     */
+    std::array<unsigned int, 6> extremes;
+    extremes.fill(candidates[0]);
+
+    for (auto index : candidates) {
+        for (int axis = 0; axis < 3; axis++) {
+            if (points[index][axis] < points[extremes[2 * axis]][axis])
+                extremes[2 * axis] = index;
+
+            if (points[index][axis] > points[extremes[2 * axis + 1]][axis])
+                extremes[2 * axis + 1] = index;
+        }
+    }
+
+    unsigned int a = extremes[0];
+    unsigned int b = extremes[1];
+
+    for (int axis = 1; axis < 3; axis++) {
+        const unsigned int min = extremes[2 * axis];
+        const unsigned int max = extremes[2 * axis + 1];
+
+        if (glm::distance(points[min], points[max]) > glm::distance(points[a], points[b])) {
+            a = min;
+            b = max;
+        }
+    }
+
+    if (glm::distance(points[a], points[b]) <= tolerance)
+        return false;
+
+    const vec3 line = glm::normalize(points[b] - points[a]);
+
+    unsigned int c = NONE;
+    float maxDistance = tolerance;
+
+    for (auto index : candidates) {
+        const float distance = glm::length(glm::cross(line, points[index] - points[a]));
+
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            c = index;
+        }
+    }
+
+    if (c == NONE)
+        return false; /* Collinear */
+
+    const vec3 normal = glm::normalize(glm::cross(points[b] - points[a], points[c] - points[a]));
+
+    unsigned int d = NONE;
+    maxDistance = tolerance;
+
+    for (auto index : candidates) {
+        const float distance = std::abs(glm::dot(normal, points[index] - points[a]));
+
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            d = index;
+        }
+    }
+
+    if (d == NONE)
+        return false; /* Coplanar */
+
+    /* The base abc faces away from d */
+    if (glm::dot(normal, points[d] - points[a]) > 0.0f)
+        std::swap(b, c);
+
+    std::vector<Face> faces = {
+        makeFace(points, a, b, c),
+        makeFace(points, a, d, b),
+        makeFace(points, b, d, c),
+        makeFace(points, c, d, a)
+    };
+
+    for (unsigned int f = 0; f < 4; f++) {
+        for (int i = 0; i < 3; i++) {
+            const unsigned int from = faces[f].vertices[i];
+            const unsigned int to = faces[f].vertices[(i + 1) % 3];
+
+            for (unsigned int g = 0; g < 4; g++) {
+                if (g != f && findEdge(faces[g], to, from) >= 0)
+                    faces[f].neighbours[i] = g;
+            }
+        }
+    }
+
+    const std::vector<unsigned int> initial = { 0, 1, 2, 3 };
+
+    for (auto index : candidates) {
+        if (index != a && index != b && index != c && index != d)
+            assign(faces, initial, points, index, tolerance);
+    }
+
+    /* Faces by their furthest outside point, removed faces are skipped when popped */
+    std::priority_queue<std::pair<float, unsigned int>> queue;
+
+    for (unsigned int f = 0; f < 4; f++) {
+        if (!faces[f].outside.empty())
+            queue.emplace(faces[f].furthest, f);
+    }
+
+    size_t vertexCount = 4;
+
+    std::vector<unsigned int> visible;
+    std::vector<std::array<unsigned int, 3>> horizon;   /* From, to, face behind the edge */
+    std::vector<unsigned int> created;
+    std::vector<unsigned int> orphans;
+    std::vector<unsigned int> startsAt(points.size(), NONE);
+
+    while (!queue.empty() && (maxVertices == 0 || vertexCount < maxVertices)) {
+        const unsigned int top = queue.top().second;
+        queue.pop();
+
+        if (faces[top].removed)
+            continue;
+
+        const unsigned int eye = faces[top].outside.front();
+        const vec3& eyePoint = points[eye];
+
+        /**
+         * Flood fill the faces that see the eye point, keeping the edges to
+         * the others. Any face in front counts, not just those beyond the
+         * tolerance: keeping a face the point is slightly in front of would
+         * leave a concave edge, and the old points near it outside.
+         */
+        visible.clear();
+        horizon.clear();
+
+        visible.push_back(top);
+        faces[top].visible = true;
+
+        for (size_t i = 0; i < visible.size(); i++) {
+            for (auto n : faces[visible[i]].neighbours) {
+                if (!faces[n].visible && faces[n].distance(eyePoint) > 0.0f) {
+                    faces[n].visible = true;
+                    visible.push_back(n);
+                }
+            }
+        }
+
+        for (auto f : visible) {
+            for (int i = 0; i < 3; i++) {
+                const unsigned int n = faces[f].neighbours[i];
+
+                if (!faces[n].visible)
+                    horizon.push_back({ faces[f].vertices[i], faces[f].vertices[(i + 1) % 3], n });
+            }
+        }
+
+        /* Close the hole with a fan from the eye point */
+        created.clear();
+
+        for (const auto& edge : horizon) {
+            const unsigned int f = faces.size();
+
+            faces.push_back(makeFace(points, edge[0], edge[1], eye));
+            faces[f].neighbours[0] = edge[2];
+
+            Face& behind = faces[edge[2]];
+            behind.neighbours[findEdge(behind, edge[1], edge[0])] = f;
+
+            startsAt[edge[0]] = f;
+            created.push_back(f);
+        }
+
+        /* Face (u, v, eye) borders (v, w, eye) along v -> eye */
+        for (auto f : created) {
+            const unsigned int next = startsAt[faces[f].vertices[1]];
+
+            faces[f].neighbours[1] = next;
+            faces[next].neighbours[2] = f;
+        }
+
+        for (const auto& edge : horizon)
+            startsAt[edge[0]] = NONE;
+
+        orphans.clear();
+
+        for (auto f : visible) {
+            Face& face = faces[f];
+
+            for (auto index : face.outside) {
+                if (index != eye)
+                    orphans.push_back(index);
+            }
+
+            face.outside.clear();
+            face.outside.shrink_to_fit();
+            face.removed = true;
+        }
+
+        for (auto index : orphans)
+            assign(faces, created, points, index, tolerance);
+
+        for (auto f : created) {
+            if (!faces[f].outside.empty())
+                queue.emplace(faces[f].furthest, f);
+        }
+
+        vertexCount++;
+    }
+
+    for (const auto& face : faces) {
+        if (face.removed)
+            continue;
+
+        m_triangles.push_back(face.vertices);
+        m_vertices.insert(m_vertices.end(), face.vertices.begin(), face.vertices.end());
+    }
+
+    std::sort(m_vertices.begin(), m_vertices.end());
+    m_vertices.erase(std::unique(m_vertices.begin(), m_vertices.end()), m_vertices.end());
+
+    return true;
+}
@@ -1,33 +1,32 @@
 
 #include "phys/GjkEpa.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
 namespace GjkEpa {
 
     size_t MAX_GJK_ITERS = 32;
     size_t MAX_EPA_ITERS = 16;
+    size_t MAX_MPR_ITERS = 32;
 
-    Simplex GJK(
+    /* Closest points: relative progress below which the search stops, and the distance that counts as touching */
+    constexpr float DISTANCE_TOLERANCE = 1e-4f;
+    constexpr float OVERLAP_DISTANCE = 1e-5f;
+
+    /**
+     * The GJK loop. Continues from a simplex whose first vertex is the
+     * newest one, with a search direction towards the origin.
+     */
+    static Simplex search(
         Collider* colliderA,
-        Collider* colliderB
+        Collider* colliderB,
+        Simplex simplex,
+        vec3 direction
     ) {
 
-        assert(colliderA != nullptr);
-        assert(colliderB != nullptr);
-
-        /**
-         * We need at least one vertex to start, so we’ll manually add it.
-         * The search direction for the first vertex doesn’t matter, but you
-         * may get less iterations with a smarter choice.
-         */
-        Support support = GjkEpa::support(colliderA, colliderB, { 0, 1.0f, 0 });
-
-        /* Simplex is an array of points, max count is 4 */
-        Simplex simplex;
-        simplex.push_front(support);
-
-        /* New direction is towards the origin */
-        vec3 direction = -support.point;
-
         for (size_t i = 0; i < GjkEpa::MAX_GJK_ITERS; i++) {
 
             /**
@@ -38,6 +37,9 @@ namespace GjkEpa {
              * finds a vertex that was already the furthest one along it.
              */
 
+            simplex.direction = direction;
+            simplex.iterations++;
+
             auto support = GjkEpa::support(colliderA, colliderB, direction);
 
             if (glm::dot(support.point, direction) <= 0.0f)
@@ -59,6 +61,403 @@ namespace GjkEpa {
         return simplex;
     }
 
+    /**
+     * Finds a face of a tetrahedron that has the origin in front of it.
+     * Returns -1 if the origin is inside, -2 if the tetrahedron is flat.
+     * `normal` is set to the face normal pointing towards the origin.
+     */
+    static int findOutsideFace(const Simplex& simplex, std::array<int, 3>& face, vec3& normal) {
+
+        const auto& p = simplex.m_points;
+
+        /* Each face with its opposite vertex */
+        constexpr int faces[4][4] = {
+            { 0, 1, 2, 3 },
+            { 0, 3, 1, 2 },
+            { 0, 2, 3, 1 },
+            { 1, 3, 2, 0 },
+        };
+
+        for (int i = 0; i < 4; i++) {
+            const auto& f = faces[i];
+            const vec3& a = p[f[0]].point;
+            const vec3 n = glm::cross(p[f[1]].point - a, p[f[2]].point - a);
+
+            const float opposite = glm::dot(n, p[f[3]].point - a);
+            const float origin = glm::dot(n, -a);
+
+            if (opposite == 0.0f)
+                return -2;
+
+            /* Wound so that the normal is cross(b - a, c - a), like Triangle() leaves it */
+            if (opposite * origin <= 0.0f) {
+                face = opposite > 0.0f
+                    ? std::array<int, 3>{ f[0], f[2], f[1] }
+                    : std::array<int, 3>{ f[0], f[1], f[2] };
+                normal = opposite > 0.0f ? -n : n;
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    Simplex GJK(
+        Collider* colliderA,
+        Collider* colliderB,
+        GjkCache* cache
+    ) {
+
+        assert(colliderA != nullptr);
+        assert(colliderB != nullptr);
+
+        Simplex simplex;
+        vec3 direction;
+        bool warm = false;
+
+        if (cache != nullptr && cache->separatingAxis != vec3(0.0f)) {
+
+            /* Still separated along the axis found last time? */
+            const vec3 axis = cache->separatingAxis;
+            const Support support = GjkEpa::support(colliderA, colliderB, axis);
+
+            simplex.push_front(support);
+            simplex.direction = axis;
+            simplex.iterations = 1;
+
+            if (glm::dot(support.point, axis) <= 0.0f) {
+                cache->queries++;
+                cache->iterations++;
+                cache->warmHits++;
+                return simplex;
+            }
+
+            /* Barely touching, the search continues from this vertex */
+            direction = -support.point;
+            warm = true;
+
+        } else if (cache != nullptr && cache->size == 4) {
+
+            /* Evaluate the last simplex again, it usually still contains the origin */
+            for (int i = 3; i >= 0; i--)
+                simplex.push_front(GjkEpa::support(colliderA, colliderB, cache->directions[i]));
+
+            simplex.iterations = 4;
+
+            std::array<int, 3> face;
+            const int outside = findOutsideFace(simplex, face, direction);
+
+            if (outside == -1) {
+                simplex.containsOrigin = true;
+                simplex.direction = cache->directions[0];
+
+                cache->queries++;
+                cache->iterations += 4;
+                cache->warmHits++;
+                return simplex;
+            }
+
+            /* Continue from the face the origin is in front of */
+            if (outside >= 0) {
+                const auto p = simplex.m_points;
+                simplex.assign({ p[face[0]], p[face[1]], p[face[2]] });
+                warm = true;
+            }
+        }
+
+        if (!warm) {
+            /**
+             * We need at least one vertex to start, so we’ll manually add it.
+             * The search direction for the first vertex doesn’t matter, but you
+             * may get less iterations with a smarter choice.
+             */
+            const unsigned spent = simplex.iterations;
+            Support support = GjkEpa::support(colliderA, colliderB, { 0, 1.0f, 0 });
+
+            /* Simplex is an array of points, max count is 4 */
+            simplex = Simplex();
+            simplex.push_front(support);
+            simplex.direction = vec3(0, 1.0f, 0);
+            simplex.iterations = spent + 1;
+
+            /* New direction is towards the origin */
+            direction = -support.point;
+        }
+
+        simplex = search(colliderA, colliderB, simplex, direction);
+
+        if (cache != nullptr) {
+            cache->queries++;
+            cache->iterations += simplex.iterations;
+            /**
+             * Kept as a unit vector: the search direction can be tiny when
+             * the origin is (nearly) on the simplex, and the dot product
+             * with such an axis underflows to 0, which reads as separated
+             * from then on.
+             */
+            const float length = glm::length(simplex.direction);
+
+            cache->separatingAxis = !simplex.containsOrigin && length > FLT_EPSILON * FLT_EPSILON
+                ? simplex.direction / length
+                : vec3(0.0f);
+            cache->size = 0;
+
+            if (simplex.containsOrigin && simplex.size() == 4) {
+                for (unsigned i = 0; i < 4; i++)
+                    cache->directions[i] = simplex.m_points[i].direction;
+
+                cache->size = 4;
+            }
+        }
+
+        return simplex;
+    }
+
+    /**
+     * Closest point of the simplex to the origin, the simplex is reduced to
+     * the vertices it is a combination of (with weights `lambda`).
+     * Real-Time Collision Detection (Ericson), 5.1.2, 5.1.5 and 5.1.6
+     */
+    static vec3 closestOnSegment(Simplex& simplex, std::array<float, 4>& lambda) {
+        const Support a = simplex[0];
+        const Support b = simplex[1];
+
+        const vec3 ab = b.point - a.point;
+        const float t = glm::dot(-a.point, ab);
+        const float length2 = glm::dot(ab, ab);
+
+        if (t <= 0.0f || length2 <= 0.0f) {
+            simplex.assign({ a });
+            lambda[0] = 1.0f;
+            return a.point;
+        }
+
+        if (t >= length2) {
+            simplex.assign({ b });
+            lambda[0] = 1.0f;
+            return b.point;
+        }
+
+        lambda[1] = t / length2;
+        lambda[0] = 1.0f - lambda[1];
+
+        return a.point + ab * lambda[1];
+    }
+
+    static vec3 closestOnTriangle(Simplex& simplex, std::array<float, 4>& lambda) {
+        const Support a = simplex[0];
+        const Support b = simplex[1];
+        const Support c = simplex[2];
+
+        const vec3 ab = b.point - a.point;
+        const vec3 ac = c.point - a.point;
+
+        const float d1 = glm::dot(ab, -a.point);
+        const float d2 = glm::dot(ac, -a.point);
+
+        if (d1 <= 0.0f && d2 <= 0.0f) {
+            simplex.assign({ a });
+            lambda[0] = 1.0f;
+            return a.point;
+        }
+
+        const float d3 = glm::dot(ab, -b.point);
+        const float d4 = glm::dot(ac, -b.point);
+
+        if (d3 >= 0.0f && d4 <= d3) {
+            simplex.assign({ b });
+            lambda[0] = 1.0f;
+            return b.point;
+        }
+
+        const float vc = d1 * d4 - d3 * d2;
+
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            simplex.assign({ a, b });
+            return closestOnSegment(simplex, lambda);
+        }
+
+        const float d5 = glm::dot(ab, -c.point);
+        const float d6 = glm::dot(ac, -c.point);
+
+        if (d6 >= 0.0f && d5 <= d6) {
+            simplex.assign({ c });
+            lambda[0] = 1.0f;
+            return c.point;
+        }
+
+        const float vb = d5 * d2 - d1 * d6;
+
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            simplex.assign({ a, c });
+            return closestOnSegment(simplex, lambda);
+        }
+
+        const float va = d3 * d6 - d5 * d4;
+
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            simplex.assign({ b, c });
+            return closestOnSegment(simplex, lambda);
+        }
+
+        const float sum = va + vb + vc;
+
+        /* Collinear vertices, the edges above cover it */
+        if (!(sum > 0.0f)) {
+            simplex.assign({ a, b });
+            return closestOnSegment(simplex, lambda);
+        }
+
+        lambda[0] = va / sum;
+        lambda[1] = vb / sum;
+        lambda[2] = vc / sum;
+
+        return a.point * lambda[0] + b.point * lambda[1] + c.point * lambda[2];
+    }
+
+    /* Returns false if the origin is inside of the tetrahedron */
+    static bool closestOnTetrahedron(Simplex& simplex, std::array<float, 4>& lambda, vec3& closest) {
+        const Simplex tetrahedron = simplex;
+        const auto& p = tetrahedron.m_points;
+
+        /* Each face with its opposite vertex */
+        constexpr int faces[4][4] = {
+            { 0, 1, 2, 3 },
+            { 0, 3, 1, 2 },
+            { 0, 2, 3, 1 },
+            { 1, 3, 2, 0 },
+        };
+
+        float best = FLT_MAX;
+        bool outside = false;
+
+        for (const auto& f : faces) {
+            const vec3& a = p[f[0]].point;
+            const vec3 n = glm::cross(p[f[1]].point - a, p[f[2]].point - a);
+
+            /* Skips the faces that have the origin on the inner side, all of them count if the tetrahedron is flat */
+            if (glm::dot(n, p[f[3]].point - a) * glm::dot(n, -a) > 0.0f)
+                continue;
+
+            Simplex face;
+            face.assign({ p[f[0]], p[f[1]], p[f[2]] });
+
+            std::array<float, 4> weights;
+            const vec3 point = closestOnTriangle(face, weights);
+            const float distance = glm::dot(point, point);
+
+            outside = true;
+
+            if (distance < best) {
+                best = distance;
+                closest = point;
+                simplex = face;
+                lambda = weights;
+            }
+        }
+
+        return outside;
+    }
+
+    ClosestPoints closestPoints(
+        Collider* colliderA,
+        Collider* colliderB,
+        float maxDistance
+    ) {
+
+        assert(colliderA != nullptr);
+        assert(colliderB != nullptr);
+
+        ClosestPoints result;
+
+        /* Start between the centers, which is close to the answer for most pairs */
+        vec3 direction = vec3(0.0f, 1.0f, 0.0f);
+
+        if (colliderA->m_aabb.isFinite() && colliderB->m_aabb.isFinite()) {
+            const vec3 between = colliderA->m_aabb.getCenter() - colliderB->m_aabb.getCenter();
+
+            if (glm::dot(between, between) > 0.0f)
+                direction = between;
+        }
+
+        Simplex simplex;
+        simplex.push_front(GjkEpa::support(colliderA, colliderB, direction));
+
+        std::array<float, 4> lambda = { 1.0f, 0.0f, 0.0f, 0.0f };
+        vec3 v = simplex[0].point;
+
+        result.iterations = 1;
+
+        /* Lower bound, if it stopped at maxDistance */
+        float bound = 0.0f;
+
+        for (size_t i = 0; i < GjkEpa::MAX_GJK_ITERS; i++) {
+            const float vv = glm::dot(v, v);
+
+            if (vv <= OVERLAP_DISTANCE * OVERLAP_DISTANCE) {
+                result.overlapping = true;
+                return result;
+            }
+
+            const Support w = GjkEpa::support(colliderA, colliderB, -v);
+            const float vw = glm::dot(v, w.point);
+
+            result.iterations++;
+
+            /* vw / |v| is a lower bound of the distance */
+            if (vw > 0.0f && vw * vw > maxDistance * maxDistance * vv) {
+                bound = vw / std::sqrt(vv);
+                break;
+            }
+
+            /* No vertex closer than the current point, up to the tolerance */
+            if (vv - vw <= DISTANCE_TOLERANCE * vv)
+                break;
+
+            bool known = false;
+
+            for (const auto& vertex : simplex)
+                known |= vertex.point == w.point;
+
+            if (known)
+                break;
+
+            Simplex next = simplex;
+            next.push_front(w);
+
+            std::array<float, 4> weights;
+            vec3 closest;
+
+            switch (next.size()) {
+                case 2: closest = closestOnSegment(next, weights); break;
+                case 3: closest = closestOnTriangle(next, weights); break;
+                default:
+                    if (!closestOnTetrahedron(next, weights, closest)) {
+                        result.overlapping = true;
+                        return result;
+                    }
+            }
+
+            /* Rounding, the current point is as good as it gets */
+            if (glm::dot(closest, closest) >= vv)
+                break;
+
+            simplex = next;
+            lambda = weights;
+            v = closest;
+        }
+
+        for (unsigned i = 0; i < simplex.size(); i++) {
+            result.p1 += simplex[i].witnessA * lambda[i];
+            result.p2 += simplex[i].witnessB * lambda[i];
+        }
+
+        result.distance = std::max(glm::length(v), bound);
+        result.normal = -glm::normalize(v);
+
+        return result;
+    }
+
     /**
      * Returns the vertex on the Minkowski difference
      */
@@ -70,7 +469,10 @@ namespace GjkEpa {
         vec3 witnessA = colliderA->findFurthestPoint(direction);
         vec3 witnessB = colliderB->findFurthestPoint(-direction);
 
-        return { witnessA, witnessB };
+        Support support = { witnessA, witnessB };
+        support.direction = direction;
+
+        return support;
     }
 
     bool nextSimplex(
@@ -184,6 +586,125 @@ namespace GjkEpa {
     }
 
 
+    /**
+     * EPA polytope in fixed size buffers, so a query never allocates.
+     *
+     * Faces are wound counter clockwise seen from outside and know their
+     * neighbour across each edge, which lets the expansion walk the horizon
+     * instead of collecting and deduplicating edges. Replaced faces are only
+     * flagged, the heap skips them when they come up.
+     */
+    namespace {
+
+        constexpr size_t EPA_MAX_VERTICES = 64;
+        constexpr size_t EPA_MAX_FACES = 256;
+        constexpr size_t EPA_MAX_HORIZON = 64;
+
+        struct EpaFace {
+            unsigned v[3];          /* Vertex indices */
+            unsigned adj[3];        /* Face across edge v[i] -> v[i + 1] */
+            unsigned adjEdge[3];    /* Index of that edge in the neighbour */
+            vec3 normal;
+            float distance;
+            bool removed;
+        };
+
+        struct EpaEdge {
+            unsigned face;
+            unsigned edge;
+        };
+
+        struct EpaHeapEntry {
+            float distance;
+            unsigned face;
+
+            /* std::push_heap builds a max heap, so invert for the closest face */
+            bool operator<(const EpaHeapEntry& other) const {
+                return distance > other.distance;
+            }
+        };
+
+        struct EpaPolytope {
+            std::array<Support, EPA_MAX_VERTICES> vertices;
+            std::array<EpaFace, EPA_MAX_FACES> faces;
+            std::array<EpaHeapEntry, EPA_MAX_FACES> heap;
+            std::array<EpaEdge, EPA_MAX_HORIZON> horizon;
+
+            size_t vertexCount = 0;
+            size_t faceCount = 0;
+            size_t heapSize = 0;
+            size_t horizonSize = 0;
+            bool overflow = false;
+
+            unsigned addFace(unsigned a, unsigned b, unsigned c) {
+                assert(faceCount < EPA_MAX_FACES);
+
+                const unsigned index = faceCount++;
+                EpaFace& face = faces[index];
+
+                face.v[0] = a;
+                face.v[1] = b;
+                face.v[2] = c;
+                face.removed = false;
+
+                const vec3& pa = vertices[a].point;
+                const vec3 n = glm::cross(vertices[b].point - pa, vertices[c].point - pa);
+                const float length = glm::length(n);
+
+                /* Slivers can't be the closest face, but stay in the mesh */
+                if (length > 0.0f) {
+                    face.normal = n / length;
+                    face.distance = glm::dot(face.normal, pa);
+                } else {
+                    face.normal = vec3(0.0f);
+                    face.distance = FLT_MAX;
+                }
+
+                heap[heapSize++] = { face.distance, index };
+                std::push_heap(heap.begin(), heap.begin() + heapSize);
+
+                return index;
+            }
+
+            void link(unsigned f0, unsigned e0, unsigned f1, unsigned e1) {
+                faces[f0].adj[e0] = f1;
+                faces[f0].adjEdge[e0] = e1;
+                faces[f1].adj[e1] = f0;
+                faces[f1].adjEdge[e1] = e0;
+            }
+
+            /**
+             * Depth first walk over the faces that can see `w`, entered from
+             * `edge` of `faceIndex`. Faces that can't see it contribute that
+             * edge to the horizon, which comes out as one closed loop.
+             */
+            void silhouette(unsigned faceIndex, unsigned edge, const vec3& w) {
+                EpaFace& face = faces[faceIndex];
+
+                if (face.removed)
+                    return;
+
+                if (glm::dot(face.normal, w - vertices[face.v[0]].point) <= 0.0f) {
+                    if (horizonSize == EPA_MAX_HORIZON) {
+                        overflow = true;
+                        return;
+                    }
+
+                    horizon[horizonSize++] = { faceIndex, edge };
+                    return;
+                }
+
+                face.removed = true;
+
+                const unsigned next = (edge + 1) % 3;
+                const unsigned prev = (edge + 2) % 3;
+
+                this->silhouette(face.adj[next], face.adjEdge[next], w);
+                this->silhouette(face.adj[prev], face.adjEdge[prev], w);
+            }
+        };
+    }
+
     /**
      * EPA algorithm
      * 
@@ -192,117 +713,114 @@ namespace GjkEpa {
     Contact EPA(
         const Simplex& simplex,
         Collider* colliderA,
-        Collider* colliderB
+        Collider* colliderB,
+        unsigned* iterationCount
     ) {
 
         assert(colliderA != nullptr);
         assert(colliderB != nullptr);
+        assert(simplex.size() == 4);
+
+        EpaPolytope polytope;
 
-        // std::vector<Support> polytope(simplex.begin(), simplex.end());
-        std::vector<Support> polytope;
+        for (size_t i = 0; i < 4; i++)
+            polytope.vertices[i] = simplex.m_points[i];
 
-        for (size_t i = 0; i < simplex.size(); i++)
-            polytope.push_back(simplex.m_points[i]);
+        polytope.vertexCount = 4;
 
-        std::vector<size_t> faces = {
-            0, 1, 2,
-            0, 3, 1,
-            0, 2, 3,
-            1, 3, 2};
+        /* Wind the tetrahedron so that every face points away from the opposite vertex */
+        const auto& p = polytope.vertices;
 
-        auto [
-            normals,
-            minFace,
-            minPolygon
-        ] = GjkEpa::getFaceNormals(polytope, faces);
+        if (glm::dot(glm::cross(p[1].point - p[0].point, p[2].point - p[0].point), p[3].point - p[0].point) > 0.0f)
+            std::swap(polytope.vertices[1], polytope.vertices[2]);
 
-        vec3 minNormal;
-        float minDistance = FLT_MAX;
+        const unsigned f0 = polytope.addFace(0, 1, 2);
+        const unsigned f1 = polytope.addFace(0, 3, 1);
+        const unsigned f2 = polytope.addFace(0, 2, 3);
+        const unsigned f3 = polytope.addFace(1, 3, 2);
+
+        polytope.link(f0, 0, f1, 2); /* 0-1 */
+        polytope.link(f0, 1, f3, 2); /* 1-2 */
+        polytope.link(f0, 2, f2, 0); /* 2-0 */
+        polytope.link(f1, 0, f2, 2); /* 0-3 */
+        polytope.link(f1, 1, f3, 0); /* 3-1 */
+        polytope.link(f2, 1, f3, 1); /* 2-3 */
+
+        unsigned closest = 0;
+        bool found = false;
 
         size_t iterations = 0;
-        while (minDistance == FLT_MAX) {
-            minNormal.x = normals[minFace].x;
-            minNormal.y = normals[minFace].y; 
-            minNormal.z = normals[minFace].z;
-            minDistance = normals[minFace].w;
-            
-            if (iterations++ > GjkEpa::MAX_EPA_ITERS) {
-                // Log("Too many EPA iterations");
+        while (polytope.heapSize > 0) {
+
+            std::pop_heap(polytope.heap.begin(), polytope.heap.begin() + polytope.heapSize);
+            const unsigned index = polytope.heap[--polytope.heapSize].face;
+
+            EpaFace& face = polytope.faces[index];
+
+            if (face.removed)
+                continue;
+
+            /* Only slivers left, the polytope is degenerate */
+            if (face.distance == FLT_MAX) {
+                found = false;
                 break;
             }
 
-            vec3 witnessA = colliderA->findFurthestPoint(minNormal);
-            vec3 witnessB = colliderB->findFurthestPoint(-minNormal);
+            closest = index;
+            found = true;
 
-            Support support = { witnessA, witnessB };
-
-            float sDistance = glm::dot(minNormal, support.point);
+            if (iterations++ > GjkEpa::MAX_EPA_ITERS) {
+                // Log("Too many EPA iterations");
+                break;
+            }
 
-            if (std::abs(sDistance - minDistance) > 0.001f) {
+            const Support support = GjkEpa::support(colliderA, colliderB, face.normal);
 
-                minDistance = FLT_MAX;
+            if (std::abs(glm::dot(face.normal, support.point) - face.distance) <= 0.001f)
+                break;
 
-				std::vector<std::pair<size_t, size_t>> uniqueEdges;
+            /* Out of room, settle for the current face */
+            if (polytope.vertexCount == EPA_MAX_VERTICES)
+                break;
 
-				for (size_t i = 0; i < normals.size(); i++) {
-                    vec3 n = { normals[i].x, normals[i].y, normals[i].z };
+            const unsigned w = polytope.vertexCount++;
+            polytope.vertices[w] = support;
 
-                    if (GjkEpa::sameDirection(n, support.point)) {
-                        size_t f = i * 3;
+            polytope.horizonSize = 0;
+            face.removed = true;
 
-                        GjkEpa::addIfUniqueEdge(uniqueEdges, faces, f + 0, f + 1);
-                        GjkEpa::addIfUniqueEdge(uniqueEdges, faces, f + 1, f + 2);
-                        GjkEpa::addIfUniqueEdge(uniqueEdges, faces, f + 2, f + 0);
+            for (unsigned e = 0; e < 3; e++)
+                polytope.silhouette(face.adj[e], face.adjEdge[e], support.point);
 
-						faces[f + 2] = faces.back(); faces.pop_back();
-						faces[f + 1] = faces.back(); faces.pop_back();
-						faces[f    ] = faces.back(); faces.pop_back();
+            if (polytope.overflow || polytope.faceCount + polytope.horizonSize > EPA_MAX_FACES) {
+                face.removed = false;
+                break;
+            }
 
-						normals[i] = normals.back(); normals.pop_back();
+            /* Fan of new faces from the horizon to the new vertex */
+            const size_t firstFace = polytope.faceCount;
 
-                        i--;
-                    }
-                }
+            for (size_t i = 0; i < polytope.horizonSize; i++) {
+                const EpaEdge& edge = polytope.horizon[i];
+                const EpaFace& outside = polytope.faces[edge.face];
 
-				if (uniqueEdges.size() == 0) {
-					break;
-				}
-
-				std::vector<size_t> newFaces;
-				for (auto [edge1, edge2] : uniqueEdges) {
-					newFaces.push_back(edge1);
-					newFaces.push_back(edge2);
-					newFaces.push_back(polytope.size());
-				}
-
-				polytope.push_back(support);
-
-                auto [
-                    newNormals,
-                    newMinFace,
-                    newPolygon
-                ] = GjkEpa::getFaceNormals(polytope, newFaces);
-
-				float newMinDistance = FLT_MAX;
-				for (size_t i = 0; i < normals.size(); i++) {
-					if (normals[i].w < newMinDistance) {
-						newMinDistance = normals[i].w;
-						minFace = i;
-					}
-				}
-
-                if (newNormals[newMinFace].w < newMinDistance) {
-                    minFace = newMinFace + normals.size();
-                    minPolygon = newPolygon;
-                }
+                const unsigned a = outside.v[(edge.edge + 1) % 3];
+                const unsigned b = outside.v[edge.edge];
 
-				faces  .insert(faces  .end(), newFaces  .begin(), newFaces  .end());
-				normals.insert(normals.end(), newNormals.begin(), newNormals.end());
+                const unsigned added = polytope.addFace(a, b, w);
+                polytope.link(added, 0, edge.face, edge.edge);
             }
 
+            for (size_t i = 0; i < polytope.horizonSize; i++) {
+                const size_t next = (i + 1) % polytope.horizonSize;
+                polytope.link(firstFace + i, 1, firstFace + next, 2);
+            }
         }
 
-        if (minDistance == FLT_MAX) {
+        if (iterationCount != nullptr)
+            *iterationCount = unsigned(iterations);
+
+        if (!found) {
             // @TODO make a neater 'empty' return statement
 			return {
                 vec3(0),
@@ -313,10 +831,21 @@ namespace GjkEpa {
             };
 		}
 
+        const EpaFace& face = polytope.faces[closest];
+
+        const vec3 minNormal = face.normal;
+        const float minDistance = face.distance;
+
+        /* Triangle on the Minkowski boundary that contains v */
+        const std::array<Support, 3> minPolygon = {
+            polytope.vertices[face.v[0]],
+            polytope.vertices[face.v[1]],
+            polytope.vertices[face.v[2]]
+        };
+
         /* Contact point (v) */
         vec3 contactPoint = minNormal * minDistance;
 
-        /* Triangle on the Minkowski boundary that contains v */
         vec3 barycentric = GjkEpa::computeBarycentricCoordinates(contactPoint, minPolygon);
 
         /* Find contact point on the original shapes */
@@ -340,9 +869,165 @@ namespace GjkEpa {
 
     }
 
+    /**
+     * MPR / XenoCollide, portal discovery and refinement as in libccd
+     * (Daniel Fiser)
+     */
+    Contact MPR(
+        Collider* colliderA,
+        Collider* colliderB,
+        unsigned* iterationCount
+    ) {
+
+        assert(colliderA != nullptr);
+        assert(colliderB != nullptr);
+
+        unsigned supports = 0;
+
+        auto next = [&](const vec3& direction) {
+            supports++;
+            return GjkEpa::support(colliderA, colliderB, direction);
+        };
+
+        auto done = [&](Contact contact) {
+            if (iterationCount != nullptr)
+                *iterationCount = supports;
+
+            return contact;
+        };
+
+        /* Inside of the Minkowski difference, the ray from here through the origin leaves it through the portal */
+        vec3 v0 = colliderA->findInteriorPoint() - colliderB->findInteriorPoint();
+
+        if (glm::dot(v0, v0) < 1e-12f)
+            v0 = vec3(1e-5f, 0.0f, 0.0f);
+
+        /* Portal discovery: a triangle of support points that the ray passes through */
+        vec3 direction = glm::normalize(-v0);
+
+        Support v1 = next(direction);
+
+        if (glm::dot(v1.point, direction) <= 0.0f)
+            return done({});
+
+        direction = glm::cross(v0, v1.point);
+
+        /* The ray hits the boundary at v1 */
+        if (glm::dot(direction, direction) < 1e-12f) {
+            const float depth = glm::length(v1.point);
+            const vec3 normal = depth > 0.0f ? v1.point / depth : glm::normalize(-v0);
+
+            return done({ normal, v1.witnessA, v1.witnessB, depth, true });
+        }
+
+        direction = glm::normalize(direction);
+
+        Support v2 = next(direction);
+
+        if (glm::dot(v2.point, direction) <= 0.0f)
+            return done({});
+
+        auto portalSide = [&]() {
+            const vec3 n = glm::cross(v1.point - v0, v2.point - v0);
+            const float length = glm::length(n);
+
+            return length > 0.0f ? n / length : vec3(0.0f);
+        };
+
+        direction = portalSide();
+
+        /* Wind the portal to face away from v0 */
+        if (glm::dot(direction, v0) > 0.0f) {
+            std::swap(v1, v2);
+            direction = -direction;
+        }
+
+        Support v3;
+
+        while (true) {
+            if (supports > GjkEpa::MAX_MPR_ITERS)
+                return done({});
+
+            v3 = next(direction);
+
+            if (glm::dot(v3.point, direction) <= 0.0f)
+                return done({});
+
+            /* The origin is outside of (v1, v0, v3) or (v3, v0, v2), swap out the vertex on the wrong side */
+            if (glm::dot(glm::cross(v1.point, v3.point), v0) < 0.0f) {
+                v2 = v3;
+                direction = portalSide();
+                continue;
+            }
+
+            if (glm::dot(glm::cross(v3.point, v2.point), v0) < 0.0f) {
+                v1 = v3;
+                direction = portalSide();
+                continue;
+            }
+
+            break;
+        }
+
+        /* Portal refinement: push the portal out until it is on the boundary */
+        for (size_t i = 0; i < GjkEpa::MAX_MPR_ITERS; i++) {
+            const vec3 n = glm::cross(v2.point - v1.point, v3.point - v1.point);
+            const float length = glm::length(n);
+
+            if (!(length > 0.0f))
+                break;
+
+            direction = n / length;
+
+            const Support v4 = next(direction);
+            const float reach = glm::dot(v4.point, direction);
+
+            const float progress = std::min(
+                reach - glm::dot(v1.point, direction),
+                std::min(reach - glm::dot(v2.point, direction), reach - glm::dot(v3.point, direction))
+            );
+
+            if (progress <= 0.001f)
+                break;
+
+            /* Replace the vertex that keeps the ray inside of the portal */
+            const vec3 v4v0 = glm::cross(v4.point, v0);
+
+            if (glm::dot(v1.point, v4v0) > 0.0f) {
+                if (glm::dot(v2.point, v4v0) > 0.0f)
+                    v1 = v4;
+                else
+                    v3 = v4;
+            } else {
+                if (glm::dot(v3.point, v4v0) > 0.0f)
+                    v2 = v4;
+                else
+                    v1 = v4;
+            }
+        }
+
+        /* The portal plane gives the normal and depth, as in XenoCollide */
+        const vec3 n = glm::cross(v2.point - v1.point, v3.point - v1.point);
+        const float length = glm::length(n);
+
+        if (!(length > 0.0f))
+            return done({});
+
+        const vec3 normal = n / length;
+        const float depth = glm::dot(normal, v1.point);
+
+        const std::array<Support, 3> portal = { v1, v2, v3 };
+        const vec3 barycentric = GjkEpa::computeBarycentricCoordinates(normal * depth, portal);
+
+        const vec3 p1 = v1.witnessA * barycentric.x + v2.witnessA * barycentric.y + v3.witnessA * barycentric.z;
+        const vec3 p2 = v1.witnessB * barycentric.x + v2.witnessB * barycentric.y + v3.witnessB * barycentric.z;
+
+        return done({ normal, p1, p2, depth, true });
+    }
+
     vec3 computeBarycentricCoordinates(
         const vec3& P, 
-        const std::vector<Support>& polygon
+        const std::array<Support, 3>& polygon
     ) {
 
         const auto A = polygon[0].point;
@@ -360,69 +1045,44 @@ namespace GjkEpa {
         float dot12 = glm::dot(v1, v2);
         
         float denom = dot00 * dot11 - dot01 * dot01;
-        float v = (dot11 * dot02 - dot01 * dot12) / denom;
-        float w = (dot00 * dot12 - dot01 * dot02) / denom;
-        float u = 1.0f - v - w;
-        
-        return { u, v, w };
-    }
-
-    std::tuple<std::vector<vec4>, size_t, std::vector<Support>> getFaceNormals(
-		const std::vector<Support>& polytope,
-		const std::vector<size_t>& faces
-    ) {
-		std::vector<vec4> normals;
-		size_t minTriangle = 0;
-		float minDistance = FLT_MAX;
-
-        std::vector<Support> polygon = { polytope[0], polytope[1], polytope[3] };
-        
-		for (size_t i = 0; i < faces.size(); i += 3) {
-			Support a = polytope[faces[i    ]];
-			Support b = polytope[faces[i + 1]];
-			Support c = polytope[faces[i + 2]];
 
-			vec3 normal = glm::normalize(glm::cross(b.point - a.point, c.point - a.point));
-			float distance = glm::dot(normal, a.point);
-
-			if (distance < 0) {
-				normal   *= -1.0f;
-				distance *= -1.0f;
-			}
-
-			normals.emplace_back(normal, distance);
+        /*
+         * Sliver: the three points are (nearly) on a line, and denom is
+         * rounding noise that can be 0. Use the closest point on the
+         * longest edge instead.
+         */
+        if (denom <= FLT_EPSILON * dot00 * dot11) {
+            const std::array<vec3, 3> points = { A, B, C };
 
-			if (distance < minDistance) {
-				minTriangle = i / 3;
-				minDistance = distance;
+            unsigned from = 0, to = 1;
+            float longest = dot00;
 
-                polygon[0] = a;
-                polygon[1] = b;
-                polygon[2] = c;
-			}
-		}
+            if (dot11 > longest) {
+                to = 2;
+                longest = dot11;
+            }
 
-		return std::make_tuple(normals, minTriangle, polygon);
-	}
+            if (glm::dot(C - B, C - B) > longest) {
+                from = 1;
+                to = 2;
+                longest = glm::dot(C - B, C - B);
+            }
 
-    void addIfUniqueEdge(
-        std::vector<std::pair<size_t, size_t>>& edges,
-        const std::vector<size_t>& faces,
-        size_t a,
-        size_t b
-    ) {
+            const float t = longest > 0.0f
+                ? std::clamp(glm::dot(P - points[from], points[to] - points[from]) / longest, 0.0f, 1.0f)
+                : 0.0f;
 
-        auto reverse = std::find(              //      0--<--3
-            edges.begin(),                     //     / \ B /   A: 2-0
-            edges.end(),                       //    / A \ /    B: 0-2
-            std::make_pair(faces[b], faces[a]) //   1-->--2
-        );
+            vec3 coordinates = vec3(0.0f);
+            coordinates[from] = 1.0f - t;
+            coordinates[to] = t;
 
-        if (reverse != edges.end()) {
-            edges.erase(reverse);
-        } else {
-            edges.emplace_back(faces[a], faces[b]);
+            return coordinates;
         }
+
+        float v = (dot11 * dot02 - dot01 * dot12) / denom;
+        float w = (dot00 * dot12 - dot01 * dot02) / denom;
+        float u = 1.0f - v - w;
+        
+        return { u, v, w };
     }
 }
-
@@ -0,0 +1,283 @@
+
+#include "phys/HeightfieldCollider.h"
+
+#include "common/glm.h"
+#include <glm/gtx/intersect.hpp>
+
+#include <cassert>
+#include <cfloat>
+#include <limits>
+
+HeightfieldCollider::HeightfieldCollider(
+    size_t columns,
+    size_t rows,
+    const std::vector<float>& heights,
+    const vec2& cellSize
+) {
+
+    assert(heights.size() == columns * rows);
+
+    m_type = ColliderType::HEIGHTFIELD;
+    m_columns = columns;
+    m_rows = rows;
+    m_cellSize = cellSize;
+
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+
+    for (float h : heights) {
+        min = std::min(min, h);
+        max = std::max(max, h);
+    }
+
+    if (heights.empty())
+        min = max = 0.0f;
+
+    /* The full 16 bit range spans the heights, a flat field gets any scale */
+    constexpr float MAX_SAMPLE = float(std::numeric_limits<uint16_t>::max());
+
+    m_heightOffset = min;
+    m_heightScale = max > min ? (max - min) / MAX_SAMPLE : 1.0f;
+
+    m_samples.resize(heights.size());
+
+    for (size_t i = 0; i < heights.size(); i++)
+        m_samples[i] = uint16_t(std::round((heights[i] - min) / m_heightScale));
+
+    this->setRelativePos(vec3(0.0f));
+}
+
+HeightfieldCollider::HeightfieldCollider(
+    size_t columns,
+    size_t rows,
+    std::vector<uint16_t> samples,
+    float heightScale,
+    float heightOffset,
+    const vec2& cellSize
+) {
+
+    assert(samples.size() == columns * rows);
+
+    m_type = ColliderType::HEIGHTFIELD;
+    m_columns = columns;
+    m_rows = rows;
+    m_cellSize = cellSize;
+    m_samples = std::move(samples);
+    m_heightScale = heightScale;
+    m_heightOffset = heightOffset;
+
+    this->setRelativePos(vec3(0.0f));
+}
+
+void HeightfieldCollider::setRelativePos(const vec3& pos) {
+    m_relativePos = pos;
+    m_relativePosW = pos;
+
+    /* Centered on the body */
+    m_origin = pos - 0.5f * vec3(
+        float(m_columns > 0 ? m_columns - 1 : 0) * m_cellSize.x,
+        0.0f,
+        float(m_rows > 0 ? m_rows - 1 : 0) * m_cellSize.y
+    );
+
+    this->updateLocalBounds();
+}
+
+void HeightfieldCollider::updateLocalBounds() {
+
+    uint16_t min = std::numeric_limits<uint16_t>::max();
+    uint16_t max = 0;
+
+    for (uint16_t sample : m_samples) {
+        min = std::min(min, sample);
+        max = std::max(max, sample);
+    }
+
+    if (m_samples.empty())
+        min = max = 0;
+
+    const vec3 size = vec3(
+        float(m_columns > 0 ? m_columns - 1 : 0) * m_cellSize.x,
+        0.0f,
+        float(m_rows > 0 ? m_rows - 1 : 0) * m_cellSize.y
+    );
+
+    m_localAabb.set(
+        m_origin + vec3(0.0f, m_heightOffset + m_heightScale * float(min), 0.0f),
+        m_origin + size + vec3(0.0f, m_heightOffset + m_heightScale * float(max), 0.0f)
+    );
+}
+
+void HeightfieldCollider::expandAABB(float scalar) {
+    m_expanded_aabb = AABB(m_aabb);
+    m_expanded_aabb.expandByScalar(scalar);
+}
+
+void HeightfieldCollider::updateGlobalPose(const Pose& pose) {
+
+    m_relativePosW = (pose.q * m_relativePos) + pose.p;
+
+    m_pose = pose;
+
+    /* Rotated extents, see MeshCollider::updateGlobalPose() */
+    const vec3 center = localToWorld(m_localAabb.getCenter());
+    const vec3 halfSize = 0.5f * m_localAabb.getSize();
+
+    const vec3 extents = glm::abs(pose.q * vec3(1.0f, 0, 0)) * halfSize.x
+        + glm::abs(pose.q * vec3(0, 1.0f, 0)) * halfSize.y
+        + glm::abs(pose.q * vec3(0, 0, 1.0f)) * halfSize.z;
+
+    m_aabb.set(center - extents, center + extents);
+}
+
+bool HeightfieldCollider::findCell(float x, float z, size_t& column, size_t& row) const {
+
+    if (m_columns < 2 || m_rows < 2)
+        return false;
+
+    const float u = (x - m_origin.x) / m_cellSize.x;
+    const float v = (z - m_origin.z) / m_cellSize.y;
+
+    if (u < 0.0f || v < 0.0f || u > float(m_columns - 1) || v > float(m_rows - 1))
+        return false;
+
+    /* The far edge belongs to the last cell */
+    column = std::min(size_t(u), m_columns - 2);
+    row = std::min(size_t(v), m_rows - 2);
+
+    return true;
+}
+
+void HeightfieldCollider::getTriangle(size_t column, size_t row, int half, Triangle& triangle) const {
+
+    const vec3 p00 = getPoint(column, row);
+    const vec3 p11 = getPoint(column + 1, row + 1);
+
+    /* Split along the diagonal from (0, 0) to (1, 1) */
+    if (half == 0)
+        triangle.points = { p00, getPoint(column, row + 1), p11 };
+    else
+        triangle.points = { p00, p11, getPoint(column + 1, row) };
+
+    const auto& p = triangle.points;
+
+    triangle.normal = glm::normalize(glm::cross(p[1] - p[0], p[2] - p[0]));
+    triangle.id = uint32_t(2 * (row * (m_columns - 1) + column) + half);
+}
+
+bool HeightfieldCollider::findTriangle(const vec3& point, Triangle& triangle) const {
+
+    size_t column, row;
+
+    if (!this->findCell(point.x, point.z, column, row))
+        return false;
+
+    /* Position within the cell, the diagonal is fx = fz */
+    const float fx = (point.x - m_origin.x) / m_cellSize.x - float(column);
+    const float fz = (point.z - m_origin.z) / m_cellSize.y - float(row);
+
+    this->getTriangle(column, row, fz >= fx ? 0 : 1, triangle);
+
+    return true;
+}
+
+bool HeightfieldCollider::raycast(const vec3& origin, const vec3& dir, float& distance, vec3& normal) const {
+
+    if (m_columns < 2 || m_rows < 2)
+        return false;
+
+    /* Body space, rigid transforms keep the distance along the ray the same */
+    const vec3 o = worldToLocal(origin);
+    const vec3 d = glm::conjugate(m_pose.q) * dir;
+
+    /* Clip the ray to the bounds (slab test) */
+    float tMin = 0.0f;
+    float tMax = FLT_MAX;
+
+    for (int i = 0; i < 3; i++) {
+        if (std::abs(d[i]) < FLT_EPSILON) {
+            if (o[i] < m_localAabb.min[i] || o[i] > m_localAabb.max[i])
+                return false;
+
+            continue;
+        }
+
+        float t0 = (m_localAabb.min[i] - o[i]) / d[i];
+        float t1 = (m_localAabb.max[i] - o[i]) / d[i];
+
+        if (t0 > t1)
+            std::swap(t0, t1);
+
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+
+        if (tMin > tMax)
+            return false;
+    }
+
+    /**
+     * Amanatides & Woo: step to whichever cell border (X or Z) the ray
+     * crosses first. Cells are visited in order along the ray, so the
+     * first cell with a hit has the closest one.
+     */
+    const vec3 start = o + d * tMin;
+
+    long column = long(std::clamp(std::floor((start.x - m_origin.x) / m_cellSize.x), 0.0f, float(m_columns - 2)));
+    long row = long(std::clamp(std::floor((start.z - m_origin.z) / m_cellSize.y), 0.0f, float(m_rows - 2)));
+
+    const long stepX = d.x > 0.0f ? 1 : -1;
+    const long stepZ = d.z > 0.0f ? 1 : -1;
+
+    const float deltaX = std::abs(d.x) > FLT_EPSILON ? m_cellSize.x / std::abs(d.x) : FLT_MAX;
+    const float deltaZ = std::abs(d.z) > FLT_EPSILON ? m_cellSize.y / std::abs(d.z) : FLT_MAX;
+
+    float nextX = std::abs(d.x) > FLT_EPSILON
+        ? (m_origin.x + float(column + (stepX > 0 ? 1 : 0)) * m_cellSize.x - o.x) / d.x
+        : FLT_MAX;
+    float nextZ = std::abs(d.z) > FLT_EPSILON
+        ? (m_origin.z + float(row + (stepZ > 0 ? 1 : 0)) * m_cellSize.y - o.z) / d.z
+        : FLT_MAX;
+
+    Triangle triangle;
+
+    for (;;) {
+        bool hit = false;
+
+        for (int half = 0; half < 2; half++) {
+            this->getTriangle(size_t(column), size_t(row), half, triangle);
+
+            vec2 bary;
+            float t;
+
+            const auto& p = triangle.points;
+
+            if (glm::intersectRayTriangle(o, d, p[0], p[1], p[2], bary, t) && t > 0.0f && (!hit || t < distance)) {
+                hit = true;
+                distance = t;
+                normal = m_pose.q * triangle.normal;
+            }
+        }
+
+        if (hit)
+            return true;
+
+        if (nextX < nextZ) {
+            if (nextX > tMax)
+                break;
+
+            column += stepX;
+            nextX += deltaX;
+        } else {
+            if (nextZ > tMax)
+                break;
+
+            row += stepZ;
+            nextZ += deltaZ;
+        }
+
+        if (column < 0 || row < 0 || column > long(m_columns - 2) || row > long(m_rows - 2))
+            break;
+    }
+
+    return false;
+}
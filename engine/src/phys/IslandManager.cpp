@@ -0,0 +1,278 @@
+
+#include "phys/IslandManager.h"
+#include "phys/PairCache.h"
+
+#include <cassert>
+
+/* Dynamic and not asleep, i.e. a node of the island graph */
+static inline bool isAwake(const RigidBody* body) {
+    return body->isDynamic && !body->isSleeping;
+}
+
+uint32_t IslandManager::find(uint32_t body) {
+
+    /* Path halving */
+    while (m_parent[body] != body) {
+        m_parent[body] = m_parent[m_parent[body]];
+        body = m_parent[body];
+    }
+
+    return body;
+}
+
+void IslandManager::unite(uint32_t a, uint32_t b) {
+    a = this->find(a);
+    b = this->find(b);
+
+    /* The lower id stays the root, so the result doesn't depend on the order of the edges */
+    if (a < b)
+        m_parent[b] = a;
+    else if (b < a)
+        m_parent[a] = b;
+}
+
+uint32_t IslandManager::islandOf(const RigidBody* A, const RigidBody* B) const {
+
+    if (A != nullptr && isAwake(A))
+        return m_bodyIsland[A->id];
+
+    if (B != nullptr && isAwake(B))
+        return m_bodyIsland[B->id];
+
+    return NONE;
+}
+
+bool IslandManager::wakeIslands(const std::vector<Ref<Constraint>>& constraints) {
+
+    /* A joint to an awake body keeps the other one awake too */
+    for (const auto& constraint : constraints) {
+        RigidBody* A = constraint->m_body0.get();
+        RigidBody* B = constraint->m_body1.get();
+
+        if (A == nullptr || B == nullptr)
+            continue;
+
+        if (isAwake(A) && B->isDynamic)
+            B->wake();
+
+        if (isAwake(B) && A->isDynamic)
+            A->wake();
+    }
+
+    bool woke = false;
+
+    for (size_t i = 0; i < m_sleeping.size();) {
+        auto& members = m_sleeping[i];
+
+        bool awake = false;
+
+        for (RigidBody* body : members) {
+
+            /* Wakes bodies that were given a velocity */
+            body->checkSleepState(0.0f);
+
+            awake |= !body->isSleeping;
+        }
+
+        if (!awake) {
+            i++;
+            continue;
+        }
+
+        for (RigidBody* body : members)
+            body->wake();
+
+        m_sleeping[i] = std::move(m_sleeping.back());
+        m_sleeping.pop_back();
+
+        woke = true;
+    }
+
+    return woke;
+}
+
+void IslandManager::build(
+    const std::vector<Ref<RigidBody>>& bodies,
+    const std::vector<CollisionPair>& collisions,
+    const std::vector<Ref<Constraint>>& constraints
+) {
+
+    const uint32_t count = static_cast<uint32_t>(bodies.size());
+
+    m_parent.resize(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        assert(bodies[i]->id == i);
+        m_parent[i] = i;
+    }
+
+    for (const auto& collision : collisions) {
+        if (isAwake(collision.A) && isAwake(collision.B))
+            this->unite(collision.A->id, collision.B->id);
+    }
+
+    for (const auto& constraint : constraints) {
+        const RigidBody* A = constraint->m_body0.get();
+        const RigidBody* B = constraint->m_body1.get();
+
+        if (A != nullptr && B != nullptr && isAwake(A) && isAwake(B))
+            this->unite(A->id, B->id);
+    }
+
+    /* Islands are numbered in the order of their lowest body */
+    m_bodyIsland.assign(count, NONE);
+    m_islands.clear();
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!isAwake(bodies[i].get()))
+            continue;
+
+        const uint32_t root = this->find(i);
+
+        if (m_bodyIsland[root] == NONE) {
+            m_bodyIsland[root] = static_cast<uint32_t>(m_islands.size());
+            m_islands.emplace_back();
+        }
+
+        m_bodyIsland[i] = m_bodyIsland[root];
+        m_islands[m_bodyIsland[i]].bodyCount++;
+    }
+
+    /**
+     * Counting sort into the flat lists: count per island, turn the
+     * counts into offsets, then place every item in its range. Items stay
+     * in ascending order within an island. The order is sorted first,
+     * pairs can't be default constructed.
+     */
+    auto group = [&](
+        size_t itemCount,
+        auto&& islandOfItem,
+        uint32_t Island::* first,
+        uint32_t Island::* size,
+        auto& items,
+        auto&& item
+    ) {
+        for (auto& island : m_islands)
+            island.*size = 0;
+
+        for (size_t k = 0; k < itemCount; k++) {
+            const uint32_t island = islandOfItem(k);
+
+            if (island != NONE)
+                m_islands[island].*size += 1;
+        }
+
+        uint32_t offset = 0;
+
+        for (auto& island : m_islands) {
+            island.*first = offset;
+            offset += island.*size;
+            island.*size = 0;
+        }
+
+        m_order.resize(offset);
+
+        for (size_t k = 0; k < itemCount; k++) {
+            const uint32_t index = islandOfItem(k);
+
+            if (index == NONE)
+                continue;
+
+            Island& island = m_islands[index];
+            m_order[island.*first + island.*size] = static_cast<uint32_t>(k);
+            island.*size += 1;
+        }
+
+        items.clear();
+        items.reserve(offset);
+
+        for (uint32_t k : m_order)
+            items.push_back(item(k));
+    };
+
+    group(
+        count,
+        [&](size_t k) { return m_bodyIsland[k]; },
+        &Island::firstBody,
+        &Island::bodyCount,
+        m_bodies,
+        [&](size_t k) { return bodies[k].get(); }
+    );
+
+    group(
+        collisions.size(),
+        [&](size_t k) { return this->islandOf(collisions[k].A, collisions[k].B); },
+        &Island::firstPair,
+        &Island::pairCount,
+        m_pairs,
+        [&](size_t k) { return collisions[k]; }
+    );
+
+    group(
+        constraints.size(),
+        [&](size_t k) { return this->islandOf(constraints[k]->m_body0.get(), constraints[k]->m_body1.get()); },
+        &Island::firstConstraint,
+        &Island::constraintCount,
+        m_constraints,
+        [&](size_t k) { return constraints[k].get(); }
+    );
+}
+
+void IslandManager::updateSleep(const std::vector<CollisionPair>& collisions) {
+
+    std::vector<bool> keepAwake(m_islands.size(), false);
+
+    /* Sleeping bodies acted as static during this step, the ones that were touched join in from the next one */
+    for (const auto& collision : collisions) {
+
+        if (collision.state == nullptr || !collision.state->touchedThisStep)
+            continue;
+
+        RigidBody* A = collision.A;
+        RigidBody* B = collision.B;
+
+        for (auto [body, other] : { std::make_pair(A, B), std::make_pair(B, A) }) {
+            if (!body->isDynamic || !body->isSleeping || !isAwake(other))
+                continue;
+
+            body->wake();
+
+            if (m_bodyIsland[other->id] != NONE)
+                keepAwake[m_bodyIsland[other->id]] = true;
+        }
+    }
+
+    for (size_t i = 0; i < m_islands.size(); i++) {
+        const Island& island = m_islands[i];
+
+        if (keepAwake[i])
+            continue;
+
+        const auto begin = m_bodies.begin() + island.firstBody;
+        const auto end = begin + island.bodyCount;
+
+        bool resting = true;
+
+        for (auto it = begin; it != end && resting; it++)
+            resting = (*it)->isResting();
+
+        if (!resting)
+            continue;
+
+        for (auto it = begin; it != end; it++)
+            (*it)->sleep();
+
+        m_sleeping.emplace_back(begin, end);
+    }
+}
+
+void IslandManager::clear() {
+    m_parent.clear();
+    m_bodyIsland.clear();
+    m_islands.clear();
+    m_bodies.clear();
+    m_pairs.clear();
+    m_constraints.clear();
+    m_order.clear();
+    m_sleeping.clear();
+}
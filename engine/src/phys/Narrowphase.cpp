@@ -0,0 +1,1317 @@
+
+#include "phys/Narrowphase.h"
+#include "phys/HeightfieldCollider.h"
+#include "phys/CompoundCollider.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+namespace Narrowphase {
+
+    namespace {
+
+        constexpr size_t NUM_TYPES = static_cast<size_t>(ColliderType::COUNT);
+
+        /* Same as the EPA fallback in ContactManifold, one pair of closest points */
+        constexpr uint32_t ID_CLOSEST_POINTS = ~0u;
+
+        /* SAT prefers face axes, an edge axis has to be this much shallower */
+        constexpr float EDGE_RELATIVE_TOLERANCE = 0.95f;
+        constexpr float EDGE_ABSOLUTE_TOLERANCE = 1e-3f;
+
+        /* Capsules closer to parallel than this (sine of the angle) get two points */
+        constexpr float PARALLEL_TOLERANCE = 1e-3f;
+
+        /**
+         * Adds a point from the surface point on B, the one on A is found
+         * along the normal so both agree with the depth.
+         */
+        inline void addPoint(
+            ContactManifold::Manifold& manifold,
+            const vec3& p2,
+            float d,
+            uint32_t id
+        ) {
+            auto& point = manifold.points[manifold.size++];
+
+            point.p1 = p2 + manifold.normal * d;
+            point.p2 = p2;
+            point.normal = manifold.normal;
+            point.d = d;
+            point.id = id;
+        }
+
+        /* Any unit vector perpendicular to v, up if v is zero */
+        inline vec3 perpendicular(const vec3& v) {
+            const vec3 p = std::abs(v.x) < 0.57f
+                ? glm::cross(v, vec3(1.0f, 0.0f, 0.0f))
+                : glm::cross(v, vec3(0.0f, 1.0f, 0.0f));
+
+            const float length = glm::length(p);
+
+            return length > FLT_EPSILON ? p / length : vec3(0.0f, 1.0f, 0.0f);
+        }
+
+        inline vec3 closestPointOnSegment(const vec3& a, const vec3& b, const vec3& p) {
+            const vec3 ab = b - a;
+            const float length2 = glm::dot(ab, ab);
+
+            if (length2 < FLT_EPSILON)
+                return a;
+
+            const float t = glm::clamp(glm::dot(p - a, ab) / length2, 0.0f, 1.0f);
+
+            return a + ab * t;
+        }
+
+        /**
+         * Closest points of the segments p1-q1 and p2-q2.
+         * Real-Time Collision Detection (Ericson), 5.1.9
+         */
+        void closestPointsSegments(
+            const vec3& p1, const vec3& q1,
+            const vec3& p2, const vec3& q2,
+            vec3& c1, vec3& c2
+        ) {
+            const vec3 d1 = q1 - p1;
+            const vec3 d2 = q2 - p2;
+            const vec3 r = p1 - p2;
+
+            const float a = glm::dot(d1, d1);
+            const float e = glm::dot(d2, d2);
+            const float f = glm::dot(d2, r);
+
+            float s = 0.0f;
+            float t = 0.0f;
+
+            if (a <= FLT_EPSILON && e <= FLT_EPSILON) {
+                c1 = p1;
+                c2 = p2;
+                return;
+            }
+
+            if (a <= FLT_EPSILON) {
+                t = glm::clamp(f / e, 0.0f, 1.0f);
+            } else {
+                const float c = glm::dot(d1, r);
+
+                if (e <= FLT_EPSILON) {
+                    s = glm::clamp(-c / a, 0.0f, 1.0f);
+                } else {
+                    const float b = glm::dot(d1, d2);
+                    const float denom = a * e - b * b;
+
+                    /* Parallel segments have no unique solution, any s will do */
+                    if (denom > FLT_EPSILON * a * e)
+                        s = glm::clamp((b * f - c * e) / denom, 0.0f, 1.0f);
+
+                    t = (b * s + f) / e;
+
+                    if (t < 0.0f) {
+                        t = 0.0f;
+                        s = glm::clamp(-c / a, 0.0f, 1.0f);
+                    } else if (t > 1.0f) {
+                        t = 1.0f;
+                        s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+                    }
+                }
+            }
+
+            c1 = p1 + d1 * s;
+            c2 = p2 + d2 * t;
+        }
+
+        /**
+         * Closest point of a triangle to p.
+         * Real-Time Collision Detection (Ericson), 5.1.5
+         */
+        vec3 closestPointOnTriangle(const vec3& p, const vec3& a, const vec3& b, const vec3& c) {
+            const vec3 ab = b - a;
+            const vec3 ac = c - a;
+            const vec3 ap = p - a;
+
+            const float d1 = glm::dot(ab, ap);
+            const float d2 = glm::dot(ac, ap);
+
+            if (d1 <= 0.0f && d2 <= 0.0f)
+                return a;
+
+            const vec3 bp = p - b;
+            const float d3 = glm::dot(ab, bp);
+            const float d4 = glm::dot(ac, bp);
+
+            if (d3 >= 0.0f && d4 <= d3)
+                return b;
+
+            const float vc = d1 * d4 - d3 * d2;
+
+            if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+                return a + ab * (d1 / (d1 - d3));
+
+            const vec3 cp = p - c;
+            const float d5 = glm::dot(ab, cp);
+            const float d6 = glm::dot(ac, cp);
+
+            if (d6 >= 0.0f && d5 <= d6)
+                return c;
+
+            const float vb = d5 * d2 - d1 * d6;
+
+            if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+                return a + ac * (d2 / (d2 - d6));
+
+            const float va = d3 * d6 - d5 * d4;
+
+            if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+                return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+            const float denom = 1.0f / (va + vb + vc);
+
+            return a + ab * (vb * denom) + ac * (vc * denom);
+        }
+
+        /* Two spheres (or a sphere and the closest point of a segment) */
+        bool sphereSphereCore(
+            const vec3& centerA, float radiusA,
+            const vec3& centerB, float radiusB,
+            const vec3& fallbackNormal,
+            const Query& query,
+            ContactManifold::Manifold& manifold
+        ) {
+            const vec3 delta = centerB - centerA;
+            const float dist = glm::length(delta);
+            const float separation = dist - radiusA - radiusB;
+
+            if (separation >= query.margin)
+                return false;
+
+            manifold.normal = dist > FLT_EPSILON ? delta / dist : fallbackNormal;
+            manifold.size = 0;
+
+            addPoint(manifold, centerB - manifold.normal * radiusB, -separation, 0);
+
+            return true;
+        }
+
+        bool sphereSphere(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<SphereCollider*>(colliderA);
+            const auto* B = static_cast<SphereCollider*>(colliderB);
+
+            return sphereSphereCore(
+                A->m_relativePosW, A->m_radius,
+                B->m_relativePosW, B->m_radius,
+                vec3(0.0f, 1.0f, 0.0f),
+                query,
+                manifold
+            );
+        }
+
+        bool sphereCapsule(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<SphereCollider*>(colliderA);
+            const auto* B = static_cast<CapsuleCollider*>(colliderB);
+
+            const vec3 center = A->m_relativePosW;
+            const vec3 closest = closestPointOnSegment(B->m_pointA, B->m_pointB, center);
+
+            return sphereSphereCore(
+                center, A->m_radius,
+                closest, B->m_radius,
+                perpendicular(B->m_pointB - B->m_pointA),
+                query,
+                manifold
+            );
+        }
+
+        bool spherePlane(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<SphereCollider*>(colliderA);
+            const auto* B = static_cast<PlaneCollider*>(colliderB);
+
+            const Plane& plane = B->m_plane;
+            const vec3 center = A->m_relativePosW;
+            const float separation = plane.distanceToPoint(center) - A->m_radius;
+
+            if (separation >= query.margin)
+                return false;
+
+            manifold.normal = -plane.normal;
+            manifold.size = 0;
+
+            addPoint(manifold, plane.projectPoint(center), -separation, 0);
+
+            return true;
+        }
+
+        bool sphereBox(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<SphereCollider*>(colliderA);
+            const auto* B = static_cast<BoxCollider*>(colliderB);
+
+            const vec3 center = A->m_relativePosW;
+            const vec3 half = B->m_halfSize;
+            const quat q = B->m_pose.q;
+
+            const vec3 local = glm::conjugate(q) * (center - B->getCenter());
+            const vec3 clamped = glm::clamp(local, -half, half);
+
+            manifold.size = 0;
+
+            if (clamped != local) {
+
+                /* Center outside of the box, the closest point is on its surface */
+                const vec3 closest = B->getCenter() + q * clamped;
+
+                return sphereSphereCore(center, A->m_radius, closest, 0.0f, -B->getAxis(1), query, manifold);
+            }
+
+            /* Center inside, push it out through the nearest face */
+            int axis = 0;
+            float minDist = FLT_MAX;
+
+            for (int i = 0; i < 3; i++) {
+                const float dist = half[i] - std::abs(local[i]);
+
+                if (dist < minDist) {
+                    minDist = dist;
+                    axis = i;
+                }
+            }
+
+            const float sign = local[axis] >= 0.0f ? 1.0f : -1.0f;
+
+            vec3 face = local;
+            face[axis] = sign * half[axis];
+
+            manifold.normal = -sign * B->getAxis(axis);
+
+            addPoint(manifold, B->getCenter() + q * face, A->m_radius + minDist, 0);
+
+            return true;
+        }
+
+        bool capsuleCapsule(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<CapsuleCollider*>(colliderA);
+            const auto* B = static_cast<CapsuleCollider*>(colliderB);
+
+            const vec3 axisA = A->m_pointB - A->m_pointA;
+            const vec3 axisB = B->m_pointB - B->m_pointA;
+
+            vec3 closestA, closestB;
+            closestPointsSegments(A->m_pointA, A->m_pointB, B->m_pointA, B->m_pointB, closestA, closestB);
+
+            /* Crossing cores have no direction between them, use the common perpendicular */
+            vec3 fallback = glm::cross(axisA, axisB);
+
+            fallback = glm::length2(fallback) > FLT_EPSILON
+                ? glm::normalize(fallback)
+                : perpendicular(axisA);
+
+            if (glm::dot(fallback, B->m_relativePosW - A->m_relativePosW) < 0.0f)
+                fallback = -fallback;
+
+            if (!sphereSphereCore(closestA, A->m_radius, closestB, B->m_radius, fallback, query, manifold))
+                return false;
+
+            /**
+             * Side by side, one point would let them spin around it. Clip the
+             * core of B to the extent of A and use both ends instead.
+             */
+            const float lengthA2 = glm::length2(axisA);
+            const float lengthB2 = glm::length2(axisB);
+            const vec3 crossed = glm::cross(axisA, axisB);
+
+            if (lengthA2 < FLT_EPSILON || lengthB2 < FLT_EPSILON)
+                return true;
+
+            if (glm::length2(crossed) > PARALLEL_TOLERANCE * PARALLEL_TOLERANCE * lengthA2 * lengthB2)
+                return true;
+
+            const float t0 = glm::dot(B->m_pointA - A->m_pointA, axisA) / lengthA2;
+            const float t1 = glm::dot(B->m_pointB - A->m_pointA, axisA) / lengthA2;
+
+            const float tMin = std::max(std::min(t0, t1), 0.0f);
+            const float tMax = std::min(std::max(t0, t1), 1.0f);
+
+            if (tMax - tMin < PARALLEL_TOLERANCE)
+                return true;
+
+            const vec3 n = manifold.normal;
+            manifold.size = 0;
+
+            for (const float t : { tMin, tMax }) {
+                const vec3 onA = A->m_pointA + axisA * t;
+                const vec3 onB = closestPointOnSegment(B->m_pointA, B->m_pointB, onA);
+
+                const float d = A->m_radius + B->m_radius - glm::dot(onB - onA, n);
+
+                addPoint(manifold, onB - n * B->m_radius, d, uint32_t(manifold.size));
+            }
+
+            return true;
+        }
+
+        bool capsulePlane(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<CapsuleCollider*>(colliderA);
+            const auto* B = static_cast<PlaneCollider*>(colliderB);
+
+            const Plane& plane = B->m_plane;
+
+            manifold.normal = -plane.normal;
+            manifold.size = 0;
+
+            const std::array<vec3, 2> ends = { A->m_pointA, A->m_pointB };
+
+            for (uint32_t i = 0; i < 2; i++) {
+                const float separation = plane.distanceToPoint(ends[i]) - A->m_radius;
+
+                if (separation < query.margin)
+                    addPoint(manifold, plane.projectPoint(ends[i]), -separation, i);
+            }
+
+            return manifold.size > 0;
+        }
+
+        bool boxPlane(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<BoxCollider*>(colliderA);
+            const auto* B = static_cast<PlaneCollider*>(colliderB);
+
+            const Plane& plane = B->m_plane;
+            const vec3 N = plane.normal;
+
+            const vec3 center = A->getCenter();
+            const std::array<vec3, 3> axes = {
+                A->getAxis(0) * A->m_halfSize.x,
+                A->getAxis(1) * A->m_halfSize.y,
+                A->getAxis(2) * A->m_halfSize.z
+            };
+
+            /* Nothing is below the plane if the deepest corner isn't */
+            const float extent = std::abs(glm::dot(axes[0], N))
+                + std::abs(glm::dot(axes[1], N))
+                + std::abs(glm::dot(axes[2], N));
+
+            if (plane.distanceToPoint(center) - extent >= query.margin)
+                return false;
+
+            std::array<ContactManifold::Point, 8> points;
+            size_t count = 0;
+
+            for (uint32_t i = 0; i < 8; i++) {
+                const vec3 corner = center
+                    + axes[0] * ((i & 1) ? 1.0f : -1.0f)
+                    + axes[1] * ((i & 2) ? 1.0f : -1.0f)
+                    + axes[2] * ((i & 4) ? 1.0f : -1.0f);
+
+                const float separation = plane.distanceToPoint(corner);
+
+                if (separation >= query.margin)
+                    continue;
+
+                points[count++] = { corner, plane.projectPoint(corner), -N, -separation, i };
+            }
+
+            count = ContactManifold::reduce(points.data(), count, N, query.maxPlanePoints);
+
+            manifold.normal = -N;
+            manifold.size = count;
+
+            std::copy(points.begin(), points.begin() + count, manifold.points.begin());
+
+            return count > 0;
+        }
+
+        bool meshPlane(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* MC = static_cast<MeshCollider*>(colliderA);
+            const auto* PC = static_cast<PlaneCollider*>(colliderB);
+
+            const vec3 N = PC->m_plane.normal;
+
+            /* Nothing is below the plane if the deepest vertex isn't */
+            if (PC->m_plane.distanceToPoint(MC->findFurthestPoint(-N)) >= query.margin)
+                return false;
+
+            thread_local std::vector<ContactManifold::Point> points;
+            points.clear();
+
+            for (auto index : MC->m_supportVertices) {
+
+                /* (26) - p1 */
+                const vec3 p1 = MC->localToWorld(MC->m_vertices[index]);
+
+                /**
+                 * (26) - p2
+                 * This is the projection of p1 onto the plane, the contact
+                 * point on the ground.
+                 */
+                const vec3 p2 = PC->m_plane.projectPoint(p1);
+
+                /* (3.5) Penetration depth -- Note: sign was flipped! */
+                const float d = - glm::dot((p1 - p2), N);
+
+                /* (3.5) if d ≤ 0 we skip the contact, unless it's within the margin */
+                if (d <= -query.margin)
+                    continue;
+
+                points.push_back({ p1, p2, -N, d, index });
+            }
+
+            /* Dense hulls rest on many vertices, keep the ones spanning the largest area */
+            const size_t count = ContactManifold::reduce(
+                points.data(),
+                points.size(),
+                N,
+                query.maxPlanePoints
+            );
+
+            manifold.normal = -N;
+            manifold.size = count;
+
+            std::copy(points.begin(), points.begin() + count, manifold.points.begin());
+
+            return count > 0;
+        }
+
+        /* Closest surface point of a heightfield to a sphere, body space of the heightfield */
+        struct SurfacePoint {
+            vec3 point;
+            vec3 normal;            /* Up, out of the surface */
+            float separation;
+            uint32_t id;
+        };
+
+        bool closestSurfacePoint(
+            const HeightfieldCollider* heightfield,
+            const vec3& center,
+            float radius,
+            float margin,
+            SurfacePoint& result
+        ) {
+            const vec3 reach = vec3(radius + std::max(margin, 0.0f));
+
+            result.separation = FLT_MAX;
+
+            /* Only the cells under the bounds of the sphere */
+            heightfield->forEachTriangle(center - reach, center + reach, [&](const HeightfieldCollider::Triangle& triangle) {
+                const auto& p = triangle.points;
+
+                const vec3 closest = closestPointOnTriangle(center, p[0], p[1], p[2]);
+                const float height = glm::dot(center - p[0], triangle.normal);
+
+                vec3 normal = triangle.normal;
+                float separation = height - radius;
+
+                if (height > 0.0f) {
+
+                    /* Above the surface, push away from the closest point (which may be an edge) */
+                    const vec3 delta = center - closest;
+                    const float dist = glm::length(delta);
+
+                    if (dist > FLT_EPSILON)
+                        normal = delta / dist;
+
+                    separation = dist - radius;
+
+                } else if (glm::length2(center - normal * height - closest) > FLT_EPSILON) {
+
+                    /* Below the plane of a neighbour, the triangle under the center decides */
+                    return;
+                }
+
+                if (separation < result.separation) {
+                    result.point = center - normal * (separation + radius);
+                    result.normal = normal;
+                    result.separation = separation;
+                    result.id = triangle.id;
+                }
+            });
+
+            return result.separation < margin;
+        }
+
+        bool sphereHeightfield(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<SphereCollider*>(colliderA);
+            const auto* B = static_cast<HeightfieldCollider*>(colliderB);
+
+            SurfacePoint surface;
+
+            if (!closestSurfacePoint(B, B->worldToLocal(A->m_relativePosW), A->m_radius, query.margin, surface))
+                return false;
+
+            manifold.normal = -(B->m_pose.q * surface.normal);
+            manifold.size = 0;
+
+            addPoint(manifold, B->localToWorld(surface.point), -surface.separation, surface.id);
+
+            return true;
+        }
+
+        bool capsuleHeightfield(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<CapsuleCollider*>(colliderA);
+            const auto* B = static_cast<HeightfieldCollider*>(colliderB);
+
+            /* The caps, the side of the cylinder rests on them as well */
+            std::array<SurfacePoint, 2> ends;
+            std::array<bool, 2> touching;
+
+            touching[0] = closestSurfacePoint(B, B->worldToLocal(A->m_pointA), A->m_radius, query.margin, ends[0]);
+            touching[1] = closestSurfacePoint(B, B->worldToLocal(A->m_pointB), A->m_radius, query.margin, ends[1]);
+
+            if (!touching[0] && !touching[1])
+                return false;
+
+            const size_t deepest = (!touching[1] || (touching[0] && ends[0].separation <= ends[1].separation)) ? 0 : 1;
+
+            manifold.normal = -(B->m_pose.q * ends[deepest].normal);
+            manifold.size = 0;
+
+            /* Each end keeps the normal of its own triangle */
+            for (size_t i = 0; i < 2; i++) {
+                if (!touching[i])
+                    continue;
+
+                addPoint(manifold, B->localToWorld(ends[i].point), -ends[i].separation, uint32_t(i));
+
+                auto& point = manifold.points[manifold.size - 1];
+
+                point.normal = -(B->m_pose.q * ends[i].normal);
+                point.p1 = point.p2 + point.normal * point.d;
+            }
+
+            return true;
+        }
+
+        /**
+         * Vertices against the triangles under them. Like the plane test, a
+         * terrain bump poking into a face between the vertices is missed,
+         * which is fine as long as the cells are small compared to the body.
+         */
+        bool meshHeightfield(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* MC = static_cast<MeshCollider*>(colliderA);
+            const auto* HF = static_cast<HeightfieldCollider*>(colliderB);
+
+            /* Nothing is below the surface if the lowest vertex is above the highest sample */
+            const vec3 up = HF->m_pose.q * vec3(0.0f, 1.0f, 0.0f);
+
+            if (HF->worldToLocal(MC->findFurthestPoint(-up)).y - HF->m_localAabb.max.y >= query.margin)
+                return false;
+
+            thread_local std::vector<ContactManifold::Point> points;
+            points.clear();
+
+            HeightfieldCollider::Triangle triangle;
+            vec3 normal = up;           /* Of the deepest point */
+            float deepest = FLT_MAX;
+
+            for (auto index : MC->m_supportVertices) {
+                const vec3 p1 = MC->localToWorld(MC->m_vertices[index]);
+                const vec3 local = HF->worldToLocal(p1);
+
+                /* O(1) lookup of the triangle under the vertex */
+                if (!HF->findTriangle(local, triangle))
+                    continue;
+
+                const float separation = glm::dot(local - triangle.points[0], triangle.normal);
+
+                if (separation >= query.margin)
+                    continue;
+
+                const vec3 p2 = HF->localToWorld(local - triangle.normal * separation);
+                const vec3 n = HF->m_pose.q * triangle.normal;
+
+                points.push_back({ p1, p2, -n, -separation, index });
+
+                if (separation < deepest) {
+                    deepest = separation;
+                    normal = n;
+                }
+            }
+
+            const size_t count = ContactManifold::reduce(
+                points.data(),
+                points.size(),
+                normal,
+                query.maxPlanePoints
+            );
+
+            manifold.normal = -normal;
+            manifold.size = count;
+
+            std::copy(points.begin(), points.begin() + count, manifold.points.begin());
+
+            return count > 0;
+        }
+
+        /**
+         * Oriented boxes, separating axis test over the 3 + 3 face normals
+         * and the 9 edge cross products. Face contacts are clipped by
+         * ContactManifold, edge contacts are a single pair of closest points.
+         * Real-Time Collision Detection (Ericson), 4.4.1
+         */
+        bool boxBox(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            auto* A = static_cast<BoxCollider*>(colliderA);
+            auto* B = static_cast<BoxCollider*>(colliderB);
+
+            const std::array<vec3, 3> axesA = { A->getAxis(0), A->getAxis(1), A->getAxis(2) };
+            const std::array<vec3, 3> axesB = { B->getAxis(0), B->getAxis(1), B->getAxis(2) };
+            const vec3 halfA = A->m_halfSize;
+            const vec3 halfB = B->m_halfSize;
+
+            const vec3 t = B->getCenter() - A->getCenter();
+
+            /* Rotation of B in the frame of A, the epsilon handles parallel edges */
+            float R[3][3], absR[3][3];
+
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    R[i][j] = glm::dot(axesA[i], axesB[j]);
+                    absR[i][j] = std::abs(R[i][j]) + 1e-6f;
+                }
+            }
+
+            /* Overlap along a unit axis, negative if separated */
+            auto overlap = [&](const vec3& axis) {
+                float ra = 0.0f, rb = 0.0f;
+
+                for (int k = 0; k < 3; k++) {
+                    ra += halfA[k] * std::abs(glm::dot(axesA[k], axis));
+                    rb += halfB[k] * std::abs(glm::dot(axesB[k], axis));
+                }
+
+                return ra + rb - std::abs(glm::dot(t, axis));
+            };
+
+            float bestFace = FLT_MAX;
+            vec3 faceAxis = vec3(0.0f);
+
+            for (int i = 0; i < 3; i++) {
+                const float a = halfA[i] + halfB[0] * absR[i][0] + halfB[1] * absR[i][1] + halfB[2] * absR[i][2]
+                    - std::abs(glm::dot(t, axesA[i]));
+
+                if (a < -query.margin)
+                    return false;
+
+                if (a < bestFace) {
+                    bestFace = a;
+                    faceAxis = axesA[i];
+                }
+            }
+
+            for (int j = 0; j < 3; j++) {
+                const float b = halfB[j] + halfA[0] * absR[0][j] + halfA[1] * absR[1][j] + halfA[2] * absR[2][j]
+                    - std::abs(glm::dot(t, axesB[j]));
+
+                if (b < -query.margin)
+                    return false;
+
+                /* A wins ties, same as the reference face in ContactManifold */
+                if (b < EDGE_RELATIVE_TOLERANCE * bestFace - EDGE_ABSOLUTE_TOLERANCE) {
+                    bestFace = b;
+                    faceAxis = axesB[j];
+                }
+            }
+
+            float bestEdge = FLT_MAX;
+            int edgeA = -1, edgeB = -1;
+            vec3 edgeAxis = vec3(0.0f);
+
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    vec3 axis = glm::cross(axesA[i], axesB[j]);
+                    const float length = glm::length(axis);
+
+                    /* Parallel edges, already covered by the face axes */
+                    if (length < 1e-4f)
+                        continue;
+
+                    axis /= length;
+
+                    const float e = overlap(axis);
+
+                    if (e < -query.margin)
+                        return false;
+
+                    if (e < bestEdge) {
+                        bestEdge = e;
+                        edgeA = i;
+                        edgeB = j;
+                        edgeAxis = axis;
+                    }
+                }
+            }
+
+            const bool edgeContact = edgeA >= 0 &&
+                bestEdge < EDGE_RELATIVE_TOLERANCE * bestFace - EDGE_ABSOLUTE_TOLERANCE;
+
+            const float depth = edgeContact ? bestEdge : bestFace;
+            vec3 n = edgeContact ? edgeAxis : faceAxis;
+
+            if (glm::dot(n, t) < 0.0f)
+                n = -n;
+
+            if (!edgeContact) {
+                const vec3 p1 = A->findFurthestPoint(n);
+                const GjkEpa::Contact contact(n, p1, p1 - n * depth, depth, true);
+
+                ContactManifold::generate(A, B, contact, manifold, query.margin);
+
+                return true;
+            }
+
+            /* The edges of A and B furthest along the normal */
+            vec3 centerA = A->getCenter();
+            vec3 centerB = B->getCenter();
+
+            for (int k = 0; k < 3; k++) {
+                if (k != edgeA)
+                    centerA += axesA[k] * (glm::dot(axesA[k], n) >= 0.0f ? halfA[k] : -halfA[k]);
+
+                if (k != edgeB)
+                    centerB -= axesB[k] * (glm::dot(axesB[k], n) >= 0.0f ? halfB[k] : -halfB[k]);
+            }
+
+            const vec3 extentA = axesA[edgeA] * halfA[edgeA];
+            const vec3 extentB = axesB[edgeB] * halfB[edgeB];
+
+            vec3 onA, onB;
+            closestPointsSegments(centerA - extentA, centerA + extentA, centerB - extentB, centerB + extentB, onA, onB);
+
+            manifold.normal = n;
+            manifold.size = 0;
+
+            addPoint(manifold, onB, depth, ID_CLOSEST_POINTS);
+
+            return true;
+        }
+
+        /* Per pair of types, see setPenetrationSolver() */
+        using SolverTable = std::array<std::array<PenetrationSolver, NUM_TYPES>, NUM_TYPES>;
+
+        SolverTable& solverTable() {
+            static SolverTable table = [] {
+                SolverTable table;
+
+                for (auto& row : table)
+                    row.fill(PenetrationSolver::EPA);
+
+                return table;
+            }();
+
+            return table;
+        }
+
+        /**
+         * GJK / EPA (or MPR) of two convex shapes. If they are separated,
+         * speculative queries look for the closest points within the
+         * margin instead, which gives a contact with d ≤ 0.
+         */
+        bool convexContact(
+            Collider* colliderA,
+            Collider* colliderB,
+            PenetrationSolver solver,
+            const Query& query,
+            GjkEpa::GjkCache* cache,
+            GjkEpa::Contact& contact
+        ) {
+
+            Simplex simplex = GjkEpa::GJK(colliderA, colliderB, cache);
+
+            if (!simplex.containsOrigin) {
+                if (!query.speculative || query.margin <= 0.0f)
+                    return false;
+
+                const auto closest = GjkEpa::closestPoints(colliderA, colliderB, query.margin);
+
+                if (closest.overlapping || closest.distance >= query.margin)
+                    return false;
+
+                contact = GjkEpa::Contact(closest.normal, closest.p1, closest.p2, -closest.distance, true);
+                return true;
+            }
+
+            contact = solver == PenetrationSolver::MPR
+                ? GjkEpa::MPR(colliderA, colliderB)
+                : GjkEpa::EPA(simplex, colliderA, colliderB);
+
+            return contact.exists && contact.d > 0.0f;
+        }
+
+        /* Anything convex: GJK, EPA (or MPR) and the clipped manifold */
+        bool convexConvex(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+
+            GjkEpa::Contact contact;
+
+            const PenetrationSolver solver = getPenetrationSolver(colliderA->m_type, colliderB->m_type);
+
+            if (!convexContact(colliderA, colliderB, solver, query, query.gjk, contact))
+                return false;
+
+            ContactManifold::generate(colliderA, colliderB, contact, manifold, query.margin);
+
+            return true;
+        }
+
+        /* Contacts of separate triangles with normals closer than this are reduced together */
+        constexpr float NORMAL_CLUSTER_TOLERANCE = 0.95f;
+
+        /* Points of neighbouring triangles closer than this [m] are the same contact */
+        constexpr float DUPLICATE_DISTANCE = 1e-3f;
+
+        /* A world space box in the body space of a mesh, grown to stay conservative */
+        AABB toLocalBounds(const AABB& aabb, const MeshCollider* mesh, float margin) {
+            const quat q = glm::conjugate(mesh->m_pose.q);
+
+            const vec3 center = mesh->worldToLocal(aabb.getCenter());
+            const vec3 halfSize = 0.5f * aabb.getSize() + std::max(margin, 0.0f);
+
+            const vec3 extents = glm::abs(q * vec3(1.0f, 0, 0)) * halfSize.x
+                + glm::abs(q * vec3(0, 1.0f, 0)) * halfSize.y
+                + glm::abs(q * vec3(0, 0, 1.0f)) * halfSize.z;
+
+            AABB local;
+            local.set(center - extents, center + extents);
+
+            return local;
+        }
+
+        /* Stable across steps as long as the part (triangle or child) and the feature pair are */
+        inline uint32_t partId(uint32_t part, uint32_t id) {
+            return id ^ (part * 2654435761u);
+        }
+
+        /* One triangle of a concave mesh as a convex shape, world space */
+        struct TriangleShape : public Collider {
+            std::array<vec3, 3> points;
+            vec3 normal = vec3(0.0f);
+
+            vec3 findFurthestPoint(const vec3& dir) const override {
+                size_t best = 0;
+
+                for (size_t i = 1; i < 3; i++) {
+                    if (glm::dot(points[i], dir) > glm::dot(points[best], dir))
+                        best = i;
+                }
+
+                return points[best];
+            }
+
+            void findSupportFeature(const vec3& dir, SupportFeature& feature) const override {
+                const float size = std::max(
+                    glm::distance(points[0], points[1]),
+                    std::max(glm::distance(points[1], points[2]), glm::distance(points[2], points[0]))
+                );
+                const float tolerance = MeshCollider::FEATURE_TOLERANCE * size * glm::length(dir);
+                const float maxDist = glm::dot(this->findFurthestPoint(dir), dir);
+
+                feature.size = 0;
+
+                for (uint32_t i = 0; i < 3; i++) {
+                    if (glm::dot(points[i], dir) < maxDist - tolerance)
+                        continue;
+
+                    feature.points[feature.size] = points[i];
+                    feature.ids[feature.size++] = i;
+                }
+            }
+
+            /* Either side, with the winding flipped for the back */
+            bool findSupportFace(const vec3& dir, SupportFeature& face) const override {
+                const bool front = glm::dot(normal, dir) >= 0.0f;
+                const std::array<uint32_t, 3> order = front
+                    ? std::array<uint32_t, 3>{ 0, 1, 2 }
+                    : std::array<uint32_t, 3>{ 0, 2, 1 };
+
+                for (size_t i = 0; i < 3; i++) {
+                    face.points[i] = points[order[i]];
+                    face.ids[i] = order[i];
+                }
+
+                face.size = 3;
+                face.normal = front ? normal : -normal;
+
+                return true;
+            }
+
+            vec3 findInteriorPoint() const override {
+                return (points[0] + points[1] + points[2]) / 3.0f;
+            }
+        };
+
+        /**
+         * Merges the contacts found on separate triangles or children of a
+         * compound. Points whose normals (nearly) agree are reduced together
+         * like a single face, so a floor made of many triangles still ends
+         * up with MAX_POINTS contacts, while a floor and a wall keep theirs
+         * apart. The deepest group goes first and sets the manifold normal.
+         */
+        bool mergeContacts(std::vector<ContactManifold::Point>& points, ContactManifold::Manifold& manifold) {
+
+            manifold.size = 0;
+
+            if (points.empty())
+                return false;
+
+            /* Ids break ties, so the result doesn't depend on the order of the parts */
+            std::sort(points.begin(), points.end(), [](const ContactManifold::Point& a, const ContactManifold::Point& b) {
+                return a.d > b.d || (a.d == b.d && a.id < b.id);
+            });
+
+            manifold.normal = points[0].normal;
+
+            thread_local std::vector<ContactManifold::Point> group;
+            thread_local std::vector<bool> used;
+            used.assign(points.size(), false);
+
+            for (size_t i = 0; i < points.size() && manifold.size < manifold.points.size(); i++) {
+                if (used[i])
+                    continue;
+
+                const vec3 normal = points[i].normal;
+                group.clear();
+
+                for (size_t j = i; j < points.size(); j++) {
+                    if (used[j] || glm::dot(points[j].normal, normal) < NORMAL_CLUSTER_TOLERANCE)
+                        continue;
+
+                    used[j] = true;
+
+                    /* Shared edges and vertices show up once per triangle, keep the deepest */
+                    const bool duplicate = std::any_of(group.begin(), group.end(), [&](const ContactManifold::Point& other) {
+                        return glm::distance2(other.p2, points[j].p2) < DUPLICATE_DISTANCE * DUPLICATE_DISTANCE;
+                    });
+
+                    if (!duplicate)
+                        group.push_back(points[j]);
+                }
+
+                const size_t count = ContactManifold::reduce(
+                    group.data(),
+                    group.size(),
+                    normal,
+                    std::min(ContactManifold::MAX_POINTS, manifold.points.size() - manifold.size)
+                );
+
+                std::copy(group.begin(), group.begin() + count, manifold.points.begin() + manifold.size);
+                manifold.size += count;
+            }
+
+            return manifold.size > 0;
+        }
+
+        /**
+         * Sphere against the triangles of a concave mesh it overlaps. The
+         * mesh is one sided, triangles facing away from the center are
+         * skipped.
+         */
+        bool sphereTriangles(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<SphereCollider*>(colliderA);
+            const auto* B = static_cast<MeshCollider*>(colliderB);
+
+            const vec3 center = B->worldToLocal(A->m_relativePosW);
+            const vec3 reach = vec3(A->m_radius + std::max(query.margin, 0.0f));
+
+            AABB bounds;
+            bounds.set(center - reach, center + reach);
+
+            thread_local std::vector<ContactManifold::Point> points;
+            points.clear();
+
+            B->forEachTriangle(bounds, [&](uint32_t index) {
+                const auto& tri = B->m_triangles[index];
+
+                if (glm::dot(center - tri[0], tri[3]) <= 0.0f)
+                    return;
+
+                const vec3 closest = closestPointOnTriangle(center, tri[0], tri[1], tri[2]);
+                const vec3 delta = center - closest;
+                const float dist = glm::length(delta);
+                const float separation = dist - A->m_radius;
+
+                if (separation >= query.margin)
+                    return;
+
+                /* Out of the surface, which may be an edge or a vertex */
+                const vec3 outward = dist > FLT_EPSILON ? delta / dist : tri[3];
+
+                const vec3 n = -(B->m_pose.q * outward);
+                const vec3 p2 = B->localToWorld(closest);
+
+                points.push_back({ p2 + n * -separation, p2, n, -separation, index });
+            });
+
+            return mergeContacts(points, manifold);
+        }
+
+        /**
+         * Any convex shape against the triangles of a concave mesh that
+         * overlap its bounds. Each triangle is a tiny convex hull for GJK,
+         * EPA and clipping, contacts that would push A through the back
+         * of a triangle are dropped.
+         */
+        bool convexTriangles(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* B = static_cast<MeshCollider*>(colliderB);
+
+            const AABB bounds = toLocalBounds(colliderA->m_aabb, B, query.margin);
+            const vec3 center = B->worldToLocal(colliderA->m_aabb.getCenter());
+
+            thread_local std::vector<ContactManifold::Point> points;
+            points.clear();
+
+            const PenetrationSolver solver = getPenetrationSolver(colliderA->m_type, colliderB->m_type);
+
+            TriangleShape triangle;
+            ContactManifold::Manifold part;
+
+            B->forEachTriangle(bounds, [&](uint32_t index) {
+                const auto& tri = B->m_triangles[index];
+
+                /* Degenerate triangles have no normal */
+                if (!(glm::length2(tri[3]) > 0.5f))
+                    return;
+
+                if (glm::dot(center - tri[0], tri[3]) <= 0.0f)
+                    return;
+
+                for (size_t j = 0; j < 3; j++)
+                    triangle.points[j] = B->localToWorld(tri[j]);
+
+                triangle.normal = B->m_pose.q * tri[3];
+
+                GjkEpa::Contact contact;
+
+                if (!convexContact(colliderA, &triangle, solver, query, nullptr, contact))
+                    return;
+
+                ContactManifold::generate(colliderA, &triangle, contact, part, query.margin);
+
+                for (size_t k = 0; k < part.size; k++) {
+                    auto point = part.points[k];
+
+                    if (glm::dot(point.normal, triangle.normal) >= 0.0f)
+                        continue;
+
+                    point.id = partId(index, point.id);
+                    points.push_back(point);
+                }
+            });
+
+            return mergeContacts(points, manifold);
+        }
+
+        /**
+         * A compound against anything: only the children whose bounds overlap
+         * B are tested (which runs the mid-phase of B as well, if it is a
+         * compound too), their contacts are merged like those of triangles.
+         */
+        bool compoundAny(Collider* colliderA, Collider* colliderB, const Query& query, ContactManifold::Manifold& manifold) {
+            const auto* A = static_cast<CompoundCollider*>(colliderA);
+
+            /* Planes have no bounds */
+            const PlaneCollider* plane = colliderB->m_type == ColliderType::PLANE
+                ? static_cast<PlaneCollider*>(colliderB)
+                : nullptr;
+
+            /* The cache belongs to the pair, not to a child */
+            Query childQuery = query;
+            childQuery.gjk = nullptr;
+
+            /* Not thread_local, compound pairs recurse */
+            std::vector<ContactManifold::Point> points;
+            ContactManifold::Manifold part;
+
+            for (size_t i = 0; i < A->m_children.size(); i++) {
+                Collider* child = A->m_children[i].collider.get();
+
+                AABB bounds = child->m_aabb;
+                bounds.expandByScalar(std::max(query.margin, 0.0f));
+
+                if (plane ? !bounds.intersectsPlane(plane->m_plane) : !bounds.intersects(colliderB->m_aabb))
+                    continue;
+
+                if (!collide(child, colliderB, childQuery, part))
+                    continue;
+
+                for (size_t k = 0; k < part.size; k++) {
+                    auto point = part.points[k];
+
+                    point.id = partId(uint32_t(i), point.id);
+                    points.push_back(point);
+                }
+            }
+
+            return mergeContacts(points, manifold);
+        }
+
+        struct Entry {
+            PairTest test = nullptr;
+            bool swap = false;      /* Registered as (b, a) */
+        };
+
+        using Table = std::array<std::array<Entry, NUM_TYPES>, NUM_TYPES>;
+
+        const Table& dispatchTable() {
+
+            static const Table table = [] {
+                Table table = {};
+
+                auto add = [&](ColliderType a, ColliderType b, PairTest test) {
+                    table[size_t(a)][size_t(b)] = { test, false };
+
+                    if (a != b)
+                        table[size_t(b)][size_t(a)] = { test, true };
+                };
+
+                add(ColliderType::SPHERE, ColliderType::SPHERE, sphereSphere);
+                add(ColliderType::SPHERE, ColliderType::CAPSULE, sphereCapsule);
+                add(ColliderType::SPHERE, ColliderType::BOX, sphereBox);
+                add(ColliderType::SPHERE, ColliderType::PLANE, spherePlane);
+                add(ColliderType::SPHERE, ColliderType::HEIGHTFIELD, sphereHeightfield);
+                add(ColliderType::SPHERE, ColliderType::CONVEX_MESH, convexConvex);
+
+                add(ColliderType::CAPSULE, ColliderType::CAPSULE, capsuleCapsule);
+                add(ColliderType::CAPSULE, ColliderType::PLANE, capsulePlane);
+                add(ColliderType::CAPSULE, ColliderType::HEIGHTFIELD, capsuleHeightfield);
+                add(ColliderType::CAPSULE, ColliderType::BOX, convexConvex);
+                add(ColliderType::CAPSULE, ColliderType::CONVEX_MESH, convexConvex);
+
+                add(ColliderType::BOX, ColliderType::BOX, boxBox);
+                add(ColliderType::BOX, ColliderType::PLANE, boxPlane);
+                add(ColliderType::BOX, ColliderType::HEIGHTFIELD, meshHeightfield);
+                add(ColliderType::BOX, ColliderType::CONVEX_MESH, convexConvex);
+
+                add(ColliderType::CONVEX_MESH, ColliderType::CONVEX_MESH, convexConvex);
+                add(ColliderType::CONVEX_MESH, ColliderType::PLANE, meshPlane);
+                add(ColliderType::CONVEX_MESH, ColliderType::HEIGHTFIELD, meshHeightfield);
+
+                add(ColliderType::SPHERE, ColliderType::INEFFICIENT_MESH, sphereTriangles);
+                add(ColliderType::CAPSULE, ColliderType::INEFFICIENT_MESH, convexTriangles);
+                add(ColliderType::BOX, ColliderType::INEFFICIENT_MESH, convexTriangles);
+                add(ColliderType::CONVEX_MESH, ColliderType::INEFFICIENT_MESH, convexTriangles);
+
+                for (size_t type = 0; type < NUM_TYPES; type++)
+                    add(ColliderType::COMPOUND, ColliderType(type), compoundAny);
+
+                return table;
+            }();
+
+            return table;
+        }
+    }
+
+    bool collide(
+        Collider* colliderA,
+        Collider* colliderB,
+        const Query& query,
+        ContactManifold::Manifold& manifold
+    ) {
+
+        const Entry& entry = dispatchTable()[size_t(colliderA->m_type)][size_t(colliderB->m_type)];
+
+        manifold.size = 0;
+
+        if (entry.test == nullptr)
+            return false;
+
+        if (!entry.swap)
+            return entry.test(colliderA, colliderB, query, manifold);
+
+        if (!entry.test(colliderB, colliderA, query, manifold))
+            return false;
+
+        /* Found as (B, A), flip it back */
+        manifold.normal = -manifold.normal;
+
+        for (size_t i = 0; i < manifold.size; i++) {
+            std::swap(manifold.points[i].p1, manifold.points[i].p2);
+            manifold.points[i].normal = -manifold.points[i].normal;
+        }
+
+        return true;
+    }
+
+    bool hasPairTest(ColliderType a, ColliderType b) {
+        return dispatchTable()[size_t(a)][size_t(b)].test != nullptr;
+    }
+
+    void setPenetrationSolver(ColliderType a, ColliderType b, PenetrationSolver solver) {
+        solverTable()[size_t(a)][size_t(b)] = solver;
+        solverTable()[size_t(b)][size_t(a)] = solver;
+    }
+
+    PenetrationSolver getPenetrationSolver(ColliderType a, ColliderType b) {
+        return solverTable()[size_t(a)][size_t(b)];
+    }
+
+    bool distance(
+        Collider* colliderA,
+        Collider* colliderB,
+        float maxDistance,
+        GjkEpa::ClosestPoints& result
+    ) {
+
+        const ColliderType a = colliderA->m_type;
+        const ColliderType b = colliderB->m_type;
+
+        auto isConcave = [](ColliderType type) {
+            return type == ColliderType::HEIGHTFIELD || type == ColliderType::INEFFICIENT_MESH;
+        };
+
+        if (isConcave(a) || isConcave(b))
+            return false;
+
+        /* The closest child, later children may stop as soon as they are further away */
+        if (a == ColliderType::COMPOUND || b == ColliderType::COMPOUND) {
+            const bool compoundIsA = a == ColliderType::COMPOUND;
+            const auto* compound = static_cast<CompoundCollider*>(compoundIsA ? colliderA : colliderB);
+            Collider* other = compoundIsA ? colliderB : colliderA;
+
+            bool found = false;
+
+            for (const auto& child : compound->m_children) {
+                GjkEpa::ClosestPoints part;
+
+                const bool supported = compoundIsA
+                    ? distance(child.collider.get(), other, maxDistance, part)
+                    : distance(other, child.collider.get(), maxDistance, part);
+
+                if (!supported || (found && part.distance >= result.distance && !part.overlapping))
+                    continue;
+
+                result = part;
+                found = true;
+                maxDistance = std::min(maxDistance, part.distance);
+
+                if (part.overlapping)
+                    break;
+            }
+
+            return found;
+        }
+
+        if (a == ColliderType::PLANE || b == ColliderType::PLANE) {
+            if (a == b)
+                return false;
+
+            const bool planeIsA = a == ColliderType::PLANE;
+            const Plane& plane = static_cast<PlaneCollider*>(planeIsA ? colliderA : colliderB)->m_plane;
+
+            /* Deepest point of the other shape and its projection onto the plane */
+            const vec3 deepest = (planeIsA ? colliderB : colliderA)->findFurthestPoint(-plane.normal);
+            const float separation = plane.distanceToPoint(deepest);
+            const vec3 projected = deepest - plane.normal * separation;
+
+            result = GjkEpa::ClosestPoints();
+            result.overlapping = separation <= 0.0f;
+            result.distance = std::max(separation, 0.0f);
+            result.p1 = planeIsA ? projected : deepest;
+            result.p2 = planeIsA ? deepest : projected;
+            result.normal = planeIsA ? plane.normal : -plane.normal;
+
+            return true;
+        }
+
+        result = GjkEpa::closestPoints(colliderA, colliderB, maxDistance);
+
+        return true;
+    }
+};
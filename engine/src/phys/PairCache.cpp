@@ -0,0 +1,148 @@
+
+#include "phys/PairCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+/* Both bodies can't move on their own, so the broadphase skips the pair */
+static inline bool isFrozen(const RigidBody* A, const RigidBody* B) {
+    return (A->isSleeping || !A->isDynamic) && (B->isSleeping || !B->isDynamic);
+}
+
+void PairCache::addEvent(ContactEventType type, const PairState& state) {
+
+    ContactEvent event = { type, state.A, state.B };
+
+    if (type != ContactEventType::END) {
+        for (const auto& contact : state.manifold) {
+            if (event.normal == vec3(0.0f) || std::abs(contact->vn) > event.speed) {
+                event.point = contact->p1;
+                event.normal = contact->n;
+                event.speed = std::abs(contact->vn);
+            }
+        }
+    }
+
+    m_events.push_back(event);
+}
+
+void PairCache::beginStep(std::vector<CollisionPair>& collisions) {
+
+    m_events.clear();
+
+    /* Mark the pairs that are still reported */
+    thread_local std::vector<uint64_t> seen;
+    seen.clear();
+
+    for (auto& collision : collisions) {
+        const uint64_t key = pairKey(collision.A, collision.B);
+
+        PairState& state = m_pairs[key];
+
+        if (state.A == nullptr) {
+            state.A = collision.A;
+            state.B = collision.B;
+        }
+
+        state.touchedThisStep = false;
+        state.hasManifold = false;
+        collision.state = &state;
+
+        seen.push_back(key);
+    }
+
+    std::sort(seen.begin(), seen.end());
+
+    /* Drop the rest, unless they are just asleep */
+    for (auto it = m_pairs.begin(); it != m_pairs.end();) {
+        PairState& state = it->second;
+
+        const bool isSeen = std::binary_search(seen.begin(), seen.end(), it->first);
+
+        if (isSeen || (state.isTouching && isFrozen(state.A, state.B))) {
+            state.gjk.queries = 0;
+            state.gjk.iterations = 0;
+            state.gjk.warmHits = 0;
+
+            it++;
+            continue;
+        }
+
+        if (state.isTouching)
+            this->addEvent(ContactEventType::END, state);
+
+        it = m_pairs.erase(it);
+    }
+}
+
+void PairCache::endStep(const std::vector<CollisionPair>& collisions) {
+
+    for (const auto& collision : collisions) {
+        PairState& state = *collision.state;
+
+        if (state.touchedThisStep) {
+            this->addEvent(
+                state.isTouching ? ContactEventType::PERSIST : ContactEventType::BEGIN,
+                state
+            );
+            state.isTouching = true;
+
+        } else if (state.isTouching) {
+            this->addEvent(ContactEventType::END, state);
+            state.isTouching = false;
+            state.manifold.clear();
+        }
+    }
+
+    /* Keep the dispatch order independent of the hash table */
+    std::stable_sort(m_events.begin(), m_events.end(), [](const ContactEvent& a, const ContactEvent& b) {
+        return pairKey(a.A, a.B) < pairKey(b.A, b.B);
+    });
+
+    for (const auto& event : m_events) {
+        for (const auto& [handle, listener] : m_listeners)
+            listener(event);
+    }
+}
+
+size_t PairCache::subscribe(Listener listener) {
+    assert(listener != nullptr);
+
+    m_listeners.emplace_back(m_nextHandle, listener);
+
+    return m_nextHandle++;
+}
+
+void PairCache::unsubscribe(size_t handle) {
+    m_listeners.erase(
+        std::remove_if(m_listeners.begin(), m_listeners.end(), [handle](const auto& entry) {
+            return entry.first == handle;
+        }),
+        m_listeners.end()
+    );
+}
+
+PairState* PairCache::find(const RigidBody* A, const RigidBody* B) {
+    auto it = m_pairs.find(pairKey(A, B));
+
+    return it != m_pairs.end() ? &it->second : nullptr;
+}
+
+GjkStats PairCache::getGjkStats() const {
+
+    GjkStats stats;
+
+    for (const auto& [key, state] : m_pairs) {
+        stats.queries += state.gjk.queries;
+        stats.iterations += state.gjk.iterations;
+        stats.warmHits += state.gjk.warmHits;
+    }
+
+    return stats;
+}
+
+void PairCache::clear() {
+    m_pairs.clear();
+    m_events.clear();
+}
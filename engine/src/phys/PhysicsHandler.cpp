@@ -1,9 +1,11 @@
 
 #include "common/glm.h"
-#include <glm/gtx/intersect.hpp>
 
 #include "phys/PhysicsHandler.h"
 #include "phys/XPBDSolver.h"
+#include "phys/HeightfieldCollider.h"
+#include "phys/CompoundCollider.h"
+#include "phys/Narrowphase.h"
 
 #include <array>
 
@@ -25,6 +27,28 @@ void PhysicsHandler::add(Ref<RigidBody> body) {
     m_bodies.push_back(body);
 }
 
+void PhysicsHandler::setBroadphase(Ref<Broadphase> broadphase) {
+    assert(broadphase != nullptr);
+
+    m_broadphase = broadphase;
+    m_broadphase->setWorkerPool(m_workerPool);
+}
+
+void PhysicsHandler::setThreadCount(size_t threadCount) {
+    assert(threadCount > 0);
+
+    m_workerPool = threadCount > 1 ? ref<WorkerPool>(threadCount) : nullptr;
+    m_broadphase->setWorkerPool(m_workerPool);
+}
+
+size_t PhysicsHandler::subscribe(PairCache::Listener listener) {
+    return m_pairCache.subscribe(listener);
+}
+
+void PhysicsHandler::unsubscribe(size_t handle) {
+    m_pairCache.unsubscribe(handle);
+}
+
 // This entire loop should probably be running on a separate thread.
 // https://medium.com/@cancerian0684/singleton-design-pattern-and-how-to-make-it-thread-safe-b207c0e7e368
 void PhysicsHandler::update(
@@ -32,7 +56,7 @@ void PhysicsHandler::update(
     std::function<void(float)> onSubstep
 ) {
 
-    XPBDSolver::update(m_bodies, m_constraints, dt, onSubstep);
+    XPBDSolver::update(m_bodies, m_constraints, *m_broadphase, m_pairCache, m_islands, m_workerPool.get(), dt, onSubstep);
 
 }
 
@@ -61,58 +85,126 @@ void PhysicsHandler::update(
 //     );
 // }
 
-static bool rayTriangleIntersect(
-    const vec3 &ro,
-    const vec3 &rd,
-    const std::array<vec3, 4> &triangle,
-    float &d
-) { 
-    vec2 bary;
-
-    return glm::intersectRayTriangle(ro, rd, triangle[0], triangle[1], triangle[2], bary, d);
-}
-
-RaycastInfo PhysicsHandler::raycast(const vec3& ray_origin, const vec3& ray_dir) const {
+RaycastInfo PhysicsHandler::raycast(const vec3& ray_origin, const vec3& ray_dir, const QueryFilter& filter) const {
 
     RaycastInfo result;
     float d;
     float minDistance = FLT_MAX;
-    std::array<vec3, 4> tempTriangle;
+
+    auto setHit = [&](float distance, const vec3& normal) {
+        minDistance = distance;
+        result.exists = true;
+        result.dist = distance;
+        result.point = ray_origin + distance * ray_dir;
+        result.normal = normal;
+    };
+
+    auto test = [&](const Ref<Collider>& collider) {
+
+        const ColliderType type = collider->m_type;
+
+        if (type == ColliderType::HEIGHTFIELD) {
+            const auto& HC = std::static_pointer_cast<HeightfieldCollider>(collider);
+
+            vec3 normal;
+
+            if (HC->raycast(ray_origin, ray_dir, d, normal) && d < minDistance)
+                setHit(d, normal);
+        }
+
+        /* Boxes keep their mesh for this */
+        if (type == ColliderType::CONVEX_MESH || type == ColliderType::INEFFICIENT_MESH || type == ColliderType::BOX) {
+            const auto& MC = std::static_pointer_cast<MeshCollider>(collider);
+
+            vec3 normal;
+
+            if (MC->raycast(ray_origin, ray_dir, d, normal) && d < minDistance)
+                setHit(d, normal);
+        }
+    };
 
     for (const auto& body: m_bodies) {
 
-        /* Quick hack, need some kind of masking / filtering system */ 
-        if (body->name == "CarBody")
+        if (!filter.accepts(body->collisionLayer, body.get()))
             continue;
 
-        if (body->collider->m_type == ColliderType::CONVEX_MESH || body->collider->m_type == ColliderType::INEFFICIENT_MESH) {
-            const auto& MC = std::static_pointer_cast<MeshCollider>(body->collider);
-            
-            for (const auto& triangle : MC->m_triangles) {
-
-                if (rayTriangleIntersect(ray_origin, ray_dir, triangle, d)) {
-                    if (d > 0.0f && d < minDistance) {
-                        minDistance = d;
-                        result.exists = true;
-                        result.dist = d;
-                        result.point = ray_origin + d * ray_dir;
-
-                        // result.normal = triangle[3];
-                        tempTriangle = triangle;
-                    }
-                };
-            }
-        }
+        if (body->collider->m_type == ColliderType::COMPOUND) {
+            const auto& CC = std::static_pointer_cast<CompoundCollider>(body->collider);
+
+            for (const auto& child : CC->m_children)
+                test(child.collider);
 
-        if (result.exists) {
-            /* Calculate normal */
-            vec3 edge1 = tempTriangle[1] - tempTriangle[0];
-            vec3 edge2 = tempTriangle[2] - tempTriangle[0];
-            result.normal = glm::normalize(glm::cross(edge1, edge2));
-            // result.normal = tempTriangle[3];
+            continue;
         }
+
+        test(body->collider);
     }
 
     return result;
 
 }
+
+DistanceInfo PhysicsHandler::distance(const RigidBody& A, const RigidBody& B) const {
+
+    DistanceInfo result;
+    GjkEpa::ClosestPoints closest;
+
+    if (!Narrowphase::distance(A.collider.get(), B.collider.get(), FLT_MAX, closest))
+        return result;
+
+    result.exists = true;
+    result.overlapping = closest.overlapping;
+    result.pointA = closest.p1;
+    result.pointB = closest.p2;
+    result.normal = closest.normal;
+    result.dist = closest.distance;
+
+    return result;
+}
+
+DistanceInfo PhysicsHandler::closestBody(Collider& shape, float maxDistance, const QueryFilter& filter) const {
+
+    DistanceInfo result;
+    GjkEpa::ClosestPoints closest;
+
+    /* Only bodies whose bounds are in range */
+    AABB range = shape.m_aabb;
+    range.expandByScalar(maxDistance);
+
+    for (const auto& body: m_bodies) {
+
+        if (!filter.accepts(body->collisionLayer, body.get()))
+            continue;
+
+        Collider* collider = body->collider.get();
+
+        const bool inRange = collider->m_type == ColliderType::PLANE
+            ? range.intersectsPlane(static_cast<PlaneCollider*>(collider)->m_plane)
+            : range.intersects(collider->m_aabb);
+
+        if (!inRange)
+            continue;
+
+        /* Stops early once it is known to be further than the best so far */
+        if (!Narrowphase::distance(&shape, collider, maxDistance, closest))
+            continue;
+
+        if (!closest.overlapping && closest.distance >= maxDistance)
+            continue;
+
+        result.exists = true;
+        result.overlapping = closest.overlapping;
+        result.body = body.get();
+        result.pointA = closest.p1;
+        result.pointB = closest.p2;
+        result.normal = closest.normal;
+        result.dist = closest.overlapping ? 0.0f : closest.distance;
+
+        if (closest.overlapping)
+            break;
+
+        maxDistance = result.dist;
+    }
+
+    return result;
+}
@@ -7,6 +7,11 @@
 #include <cstdio>
 #include <stdexcept>
 
+/* Squared velocities below which a body rests (or is damped), and for how long it has to rest before it may sleep */
+static constexpr float SLEEP_THRESHOLD = 0.01f;
+static constexpr float DAMPING_THRESHOLD = 0.2f;
+static constexpr float SLEEP_DELAY = 0.6666f;
+
 RigidBody::RigidBody(Ref<Collider> collider)
     : collider(collider) 
 {
@@ -67,6 +72,25 @@ RigidBody RigidBody::disableCollision() {
     return *this;
 }
 
+RigidBody RigidBody::disablePersistentContacts() {
+    this->persistentContacts = false;
+
+    return *this;
+}
+
+RigidBody RigidBody::enableContinuousCollision() {
+    this->continuousCollision = true;
+
+    return *this;
+}
+
+RigidBody RigidBody::setCollisionFilter(uint32_t layer, uint32_t mask) {
+    this->collisionLayer = layer;
+    this->collisionMask = mask;
+
+    return *this;
+}
+
 RigidBody RigidBody::applyForce(const vec3& force, const vec3& position) {
 
     this->wake();
@@ -195,7 +219,7 @@ void RigidBody::applyCorrection(
     bool velocityLevel
 ) {
 
-    if (!this->isDynamic) 
+    if (!this->isDynamic || this->isSleeping) 
         return;
 
     vec3 dq = vec3(0.0f);
@@ -272,7 +296,8 @@ float RigidBody::getInverseMass(
     const vec3& pos
 ) const {
 
-    if (!this->isDynamic)
+    /* Sleeping bodies act as static until their island wakes up */
+    if (!this->isDynamic || this->isSleeping)
         return 0.0f;
 
     vec3 n = vec3(0.0f);
@@ -379,33 +404,53 @@ void RigidBody::checkSleepState(float dt) {
 
     const float velLen = glm::length2(this->vel);
     const float omegaLen = glm::length2(this->omega);
-    const float sleepThresh = 0.01f; 
-    const float dampThresh = 0.2f; 
     
     if (this->isSleeping) {
-        if (velLen > sleepThresh || omegaLen > sleepThresh)
+        if (velLen > SLEEP_THRESHOLD || omegaLen > SLEEP_THRESHOLD)
             this->wake();
-    } else {
 
-        /* Damping */
-        // pow(dt) is for exponential decay, which is the proper model for 
-        // velocity damping in most physics systems (e.g. air / viscous drag).
-        float damping = pow(0.95f, dt);
-
-        if (velLen < dampThresh) {
-            this->vel *= damping;
-        }
-
-        if (omegaLen < dampThresh) {
-            this->omega *= damping;
-        }
-
-        if (velLen < sleepThresh && omegaLen < sleepThresh) {
-            if (this->sleepTimer > 0.6666f) {
-                this->sleep();
-            } else {
-                this->sleepTimer += dt;
-            }
-        }
+        return;
+    }
+
+    /* Damping */
+    // pow(dt) is for exponential decay, which is the proper model for 
+    // velocity damping in most physics systems (e.g. air / viscous drag).
+    float damping = pow(0.95f, dt);
+
+    if (velLen < DAMPING_THRESHOLD) {
+        this->vel *= damping;
     }
+
+    if (omegaLen < DAMPING_THRESHOLD) {
+        this->omega *= damping;
+    }
+
+}
+
+void RigidBody::updateSleepTimer(float dt) {
+
+    if (!this->isDynamic || !this->canSleep || this->isSleeping || dt <= 0.0f)
+        return;
+
+    /* 
+     * Velocities over the whole step, the substep ones jitter around the
+     * threshold on resting stacks while the bodies don't actually move.
+     */
+    const vec3 vel = (this->pose.p - this->stepPose.p) / dt;
+
+    const quat dq = this->pose.q * glm::conjugate(this->stepPose.q);
+    const vec3 omega = vec3(dq.x, dq.y, dq.z) * 2.0f / dt;
+
+    /* Islands decide when to sleep, see IslandManager */
+    if (glm::length2(vel) < SLEEP_THRESHOLD && glm::length2(omega) < SLEEP_THRESHOLD)
+        this->sleepTimer += dt;
+    else
+        this->sleepTimer = 0.0f;
+}
+
+bool RigidBody::isResting() const {
+    return this->canSleep
+        && this->sleepTimer > SLEEP_DELAY
+        && glm::length2(this->vel) < SLEEP_THRESHOLD
+        && glm::length2(this->omega) < SLEEP_THRESHOLD;
 }
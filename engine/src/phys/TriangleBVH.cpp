@@ -0,0 +1,188 @@
+
+#include "phys/TriangleBVH.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+    /* Bounds that any merge replaces, AABB defaults to infinite */
+    inline AABB emptyAABB() {
+        AABB aabb;
+        aabb.set(vec3(FLT_MAX), vec3(-FLT_MAX));
+
+        return aabb;
+    }
+
+    inline void grow(AABB& aabb, const AABB& other) {
+        aabb.min = glm::min(aabb.min, other.min);
+        aabb.max = glm::max(aabb.max, other.max);
+    }
+}
+
+void TriangleBVH::build(const std::vector<std::array<vec3, 4>>& triangles) {
+
+    m_nodes.clear();
+    m_indices.clear();
+
+    if (triangles.empty())
+        return;
+
+    std::vector<AABB> bounds(triangles.size());
+    std::vector<vec3> centroids(triangles.size());
+
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const auto& tri = triangles[i];
+
+        bounds[i].set(
+            glm::min(tri[0], glm::min(tri[1], tri[2])),
+            glm::max(tri[0], glm::max(tri[1], tri[2]))
+        );
+
+        centroids[i] = (tri[0] + tri[1] + tri[2]) / 3.0f;
+        m_indices.push_back(uint32_t(i));
+    }
+
+    /* A binary tree with small leaves has fewer than 2n / MAX_LEAF_SIZE nodes, usually */
+    m_nodes.reserve(2 * triangles.size() / MAX_LEAF_SIZE + 1);
+
+    this->buildNode(0, uint32_t(triangles.size()), 0, bounds, centroids);
+}
+
+uint32_t TriangleBVH::buildNode(
+    uint32_t first,
+    uint32_t count,
+    size_t depth,
+    const std::vector<AABB>& bounds,
+    const std::vector<vec3>& centroids
+) {
+
+    assert(count > 0);
+
+    const uint32_t index = uint32_t(m_nodes.size());
+    m_nodes.emplace_back();
+
+    AABB aabb = emptyAABB();
+    vec3 centroidMin = vec3(FLT_MAX);
+    vec3 centroidMax = vec3(-FLT_MAX);
+
+    for (uint32_t i = first; i < first + count; i++) {
+        grow(aabb, bounds[m_indices[i]]);
+
+        centroidMin = glm::min(centroidMin, centroids[m_indices[i]]);
+        centroidMax = glm::max(centroidMax, centroids[m_indices[i]]);
+    }
+
+    m_nodes[index].aabb = aabb;
+
+    auto makeLeaf = [&]() {
+        m_nodes[index].first = first;
+        m_nodes[index].count = count;
+
+        return index;
+    };
+
+    if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+        return makeLeaf();
+
+    /**
+     * Binned SAH: the centroids are sorted into bins along each axis, the
+     * cost of splitting between bins i and i + 1 is the area times the
+     * triangle count of both sides, from a sweep in each direction.
+     */
+    struct Bin {
+        AABB aabb = emptyAABB();
+        uint32_t count = 0;
+    };
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    size_t bestSplit = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        const float extent = centroidMax[axis] - centroidMin[axis];
+
+        if (extent <= 0.0f)
+            continue;
+
+        const float scale = float(NUM_BINS) / extent;
+
+        std::array<Bin, NUM_BINS> bins;
+
+        for (uint32_t i = first; i < first + count; i++) {
+            const uint32_t triangle = m_indices[i];
+            const size_t b = std::min(NUM_BINS - 1, size_t((centroids[triangle][axis] - centroidMin[axis]) * scale));
+
+            bins[b].count++;
+            grow(bins[b].aabb, bounds[triangle]);
+        }
+
+        std::array<float, NUM_BINS - 1> leftArea, rightArea;
+        std::array<uint32_t, NUM_BINS - 1> leftCount, rightCount;
+
+        AABB left = emptyAABB(), right = emptyAABB();
+        uint32_t leftSum = 0, rightSum = 0;
+
+        for (size_t i = 0; i < NUM_BINS - 1; i++) {
+            leftSum += bins[i].count;
+            leftCount[i] = leftSum;
+
+            if (bins[i].count > 0)
+                grow(left, bins[i].aabb);
+
+            leftArea[i] = leftSum > 0 ? left.surfaceArea() : 0.0f;
+
+            const size_t j = NUM_BINS - 1 - i;
+
+            rightSum += bins[j].count;
+            rightCount[j - 1] = rightSum;
+
+            if (bins[j].count > 0)
+                grow(right, bins[j].aabb);
+
+            rightArea[j - 1] = rightSum > 0 ? right.surfaceArea() : 0.0f;
+        }
+
+        for (size_t i = 0; i < NUM_BINS - 1; i++) {
+            if (leftCount[i] == 0 || rightCount[i] == 0)
+                continue;
+
+            const float cost = float(leftCount[i]) * leftArea[i] + float(rightCount[i]) * rightArea[i];
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    /* All centroids in one spot, nothing to split */
+    if (bestAxis < 0)
+        return makeLeaf();
+
+    const float scale = float(NUM_BINS) / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+
+    const auto middle = std::partition(
+        m_indices.begin() + first,
+        m_indices.begin() + first + count,
+        [&](uint32_t triangle) {
+            const size_t b = std::min(NUM_BINS - 1, size_t((centroids[triangle][bestAxis] - centroidMin[bestAxis]) * scale));
+            return b <= bestSplit;
+        }
+    );
+
+    const uint32_t leftCount = uint32_t(middle - (m_indices.begin() + first));
+
+    if (leftCount == 0 || leftCount == count)
+        return makeLeaf();
+
+    /* The first child directly follows its parent */
+    this->buildNode(first, leftCount, depth + 1, bounds, centroids);
+
+    const uint32_t second = this->buildNode(first + leftCount, count - leftCount, depth + 1, bounds, centroids);
+
+    m_nodes[index].second = second;
+
+    return index;
+}
@@ -1,10 +1,12 @@
 
+#include <algorithm>
 #include <tuple>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/intersect.hpp>
 
 #include "phys/XPBDSolver.h"
-#include "phys/GjkEpa.h"
+#include "phys/Narrowphase.h"
+#include "phys/ContinuousCollision.h"
 
 #include "geom/BoxGeometry.h"
 #include "geom/ArrowGeometry.h"
@@ -28,68 +30,212 @@ void XPBDSolver::init() {
     XPBDSolver::debugArrow = ref<Mesh>(ArrowGeometry(1.0f), colorMaterial);
 }
 
+/**
+ * Runs substeps of one island. With a pool, its narrow phase and body
+ * updates are split over the threads, in fixed chunks whose contacts are
+ * joined in pair order, and so is every colour of the solve. The result
+ * is the same either way.
+ */
+static void solveIsland(
+    const IslandManager& islands,
+    const Island& island,
+    const float h,
+    const int substeps,
+    WorkerPool* pool
+) {
+
+    const auto bodies = islands.getBodies(island);
+    const auto pairs = islands.getPairs(island);
+    const auto constraints = islands.getConstraints(island);
+
+    const size_t chunkSize = std::max<size_t>(XPBDSolver::islandChunkSize, 1);
+
+    auto forEachBody = [&](auto&& func) {
+        auto range = [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; i++)
+                func(bodies[i]);
+        };
+
+        if (pool != nullptr)
+            pool->parallelFor(bodies.size(), chunkSize, range);
+        else
+            range(0, bodies.size(), 0);
+    };
+
+    /* Reused by the islands this thread solves */
+    thread_local std::vector<Ref<ContactSet>> contacts;
+    std::vector<std::vector<Ref<ContactSet>>> chunks;
+
+    /* Colouring only pays off when the colours are split over the threads */
+    const bool colored = pool != nullptr;
+    XPBDSolver::SolverColors colors;
+
+    for (int i = 0; i < substeps; i++) {
+
+        /* (3.5)
+         * At each substep we iterate through the pairs
+         * checking for actual collisions.
+         */
+        if (pool != nullptr) {
+            chunks.resize((pairs.size() + chunkSize - 1) / chunkSize);
+
+            for (auto& chunk : chunks)
+                chunk.clear();
+
+            pool->parallelFor(pairs.size(), chunkSize, [&](size_t begin, size_t end, size_t) {
+                XPBDSolver::getContacts(pairs.subspan(begin, end - begin), h, chunks[begin / chunkSize]);
+            });
+
+            contacts.clear();
+
+            for (const auto& chunk : chunks)
+                contacts.insert(contacts.end(), chunk.begin(), chunk.end());
+        } else {
+            XPBDSolver::getContacts(pairs, h, contacts);
+        }
+
+        forEachBody([&](RigidBody* body) { body->integrate(h); });
+
+        XPBDSolver::clampMotion(pairs);
+
+        if (colored) {
+            XPBDSolver::colorItems(constraints, contacts, colors);
+            XPBDSolver::solvePositions(colors, contacts, h, pool);
+        } else {
+            for (Constraint* constraint: constraints)
+                constraint->solvePos(h);
+
+            XPBDSolver::solvePositions(contacts, h);
+        }
+
+        forEachBody([&](RigidBody* body) { body->update(h); });
+
+        if (colored) {
+            XPBDSolver::solveVelocities(colors, contacts, h, pool);
+        } else {
+            for (Constraint* constraint: constraints)
+                constraint->solveVel(h);
+
+            XPBDSolver::solveVelocities(contacts, h);
+        }
+
+        forEachBody([&](RigidBody* body) { body->checkSleepState(h); });
+    }
+}
+
 void XPBDSolver::update(
     const std::vector<Ref<RigidBody>>& bodies,
     const std::vector<Ref<Constraint>>& constraints,
+    Broadphase& broadphase,
+    PairCache& pairCache,
+    IslandManager& islands,
+    WorkerPool* pool,
     const float dt,
     std::function<void(float)> onSubstep
 ) {
 
     /* XPBD algorithm 2 */
 
+    /* Islands that were woken since the last step, before their pairs are collected */
+    islands.wakeIslands(constraints);
+
     /* (3.5)
      * To save computational cost we collect potential
      * collision pairs once per time step instead of once per
      * sub-step using a tree of axis aligned bounding boxes.
      */
-    auto collisions = XPBDSolver::collectCollisionPairs(bodies, dt);
+    auto collisions = broadphase.collectCollisionPairs(bodies, dt);
+
+    /* Pairs can wake their bodies, the rest of their islands needs pairs too */
+    if (islands.wakeIslands(constraints))
+        collisions = broadphase.collectCollisionPairs(bodies, dt);
 
     if (dt > (2.0f / 60.0f))
     {
         return;
     }
 
+    pairCache.beginStep(collisions);
+
+    /* Sleeping islands are left out of the step entirely */
+    islands.build(bodies, collisions, constraints);
+
+    for (RigidBody* body: islands.getBodies())
+        body->stepPose.copy(body->pose);
+
     const float h = dt / XPBDSolver::NUM_SUB_STEPS;
     // const float h = (1.0f / 60.0f) / XPBDSolver::NUM_SUB_STEPS;
 
-    for (int i = 0; i < XPBDSolver::NUM_SUB_STEPS; i++) {
+    if (pool != nullptr && pool->getThreadCount() == 1)
+        pool = nullptr;
 
-        /* (3.5)
-         * At each substep we iterate through the pairs
-         * checking for actual collisions.
-         */
-        auto contacts = XPBDSolver::getContacts(collisions);
+    /**
+     * Islands don't share any body that moves, so each one is a task of
+     * its own. Small islands are batched, large ones are split over the
+     * threads instead. Every island is solved by one thread in a fixed
+     * order, which thread doesn't matter.
+     */
+    const auto& list = islands.getIslands();
 
-        for (auto const& body: bodies)
-            body->integrate(h);
+    std::vector<uint32_t> small, large;
+    std::vector<size_t> batches = { 0 };
+    size_t batchCost = 0;
 
-        for (auto const& constraint: constraints)
-            constraint->solvePos(h);
+    for (uint32_t i = 0; i < list.size(); i++) {
+        const size_t cost = IslandManager::getCost(list[i]);
 
-        XPBDSolver::solvePositions(contacts, h);
+        if (pool != nullptr && cost >= XPBDSolver::largeIslandSize) {
+            large.push_back(i);
+            continue;
+        }
 
-        for (auto const& body: bodies)
-            body->update(h);
+        small.push_back(i);
+        batchCost += cost;
 
-        for (auto const& constraint: constraints)
-            constraint->solveVel(h);
+        if (batchCost >= XPBDSolver::islandBatchSize) {
+            batches.push_back(small.size());
+            batchCost = 0;
+        }
+    }
+
+    if (batches.back() != small.size())
+        batches.push_back(small.size());
 
-        XPBDSolver::solveVelocities(contacts, h);
+    auto solve = [&](int substeps) {
+        auto run = [&](size_t begin, size_t end, size_t) {
+            for (size_t b = begin; b < end; b++) {
+                for (size_t k = batches[b]; k < batches[b + 1]; k++)
+                    solveIsland(islands, list[small[k]], h, substeps, nullptr);
+            }
+        };
 
-        for (auto const& body: bodies)
-            body->checkSleepState(h);
+        if (pool != nullptr)
+            pool->parallelFor(batches.size() - 1, 1, run);
+        else
+            run(0, batches.size() - 1, 0);
 
-        onSubstep(h);
+        for (uint32_t i : large)
+            solveIsland(islands, list[i], h, substeps, pool);
+    };
 
+    if (onSubstep) {
+        for (int i = 0; i < XPBDSolver::NUM_SUB_STEPS; i++) {
+            solve(1);
+            onSubstep(h);
+        }
+    } else {
+        solve(XPBDSolver::NUM_SUB_STEPS);
     }
 
-    /* Slower update (non-substepped) */
-    for (auto const& body: bodies) {
+    pairCache.endStep(collisions);
 
-        if (!body->isDynamic)
-            continue;
+    for (RigidBody* body: islands.getBodies())
+        body->updateSleepTimer(dt);
+
+    islands.updateSleep(collisions);
 
-        // body->checkSleepState(dt);
+    /* Slower update (non-substepped) */
+    for (RigidBody* body: islands.getBodies()) {
 
         if (body->isSleeping)
             continue;
@@ -111,8 +257,7 @@ std::vector<CollisionPair> XPBDSolver::collectCollisionPairs(
     const float dt
 ) {
 
-    // @TODO Chunking / octree
-    // https://github.com/mwarning/SimpleOctree/tree/master/src
+    /* Reference O(n²) implementation - see Broadphase for the faster ones */
 
     std::vector<CollisionPair> collisions = {};
 
@@ -125,208 +270,246 @@ std::vector<CollisionPair> XPBDSolver::collectCollisionPairs(
         for (int j = i + 1; j < rigidBodies.size(); j++) {
             auto const& B = rigidBodies[j];
 
-            if (!B->canCollide)
-                continue;
+            if (Broadphase::testPair(A.get(), B.get())) {
+                collisions.push_back(CollisionPair(A.get(), B.get()));
+                collisions.back().wakeIfApproaching();
+            }
+        }
+    }
 
-            if (A == B)
-                continue;
+    return collisions;
+}
 
-            if ((!A->isDynamic || A->isSleeping) && (!B->isDynamic || B->isSleeping))
-                continue;
+/* Rotation of B in the frame of A */
+static inline quat relativeRotation(const RigidBody* A, const RigidBody* B) {
+    return glm::conjugate(A->pose.q) * B->pose.q;
+}
 
-            auto const& aabb1 = A->collider->m_expanded_aabb;
-            auto const& aabb2 = B->collider->m_expanded_aabb;
+/* Remembers where the manifold was generated, see canReuseManifold() */
+static void storeManifoldAnchors(PairState* state) {
+    const RigidBody* A = state->A;
+    const RigidBody* B = state->B;
 
-            switch (A->collider->m_type) {
+    vec3 center = vec3(0.0f);
 
-                case ColliderType::PLANE :
-                case ColliderType::SPHERE :
-                case ColliderType::INEFFICIENT_MESH :
-                    break;
+    for (auto const& contact: state->manifold)
+        center += contact->r1;
 
-                case ColliderType::CONVEX_MESH :
+    center /= static_cast<float>(state->manifold.size());
 
-                    switch (B->collider->m_type) {
-                        
-                        case ColliderType::CONVEX_MESH : {
+    /* Same point in both frames, so the drift starts at zero */
+    const vec3 world = A->pose.p + A->pose.q * center;
 
-                            if (aabb1.intersects(aabb2)) {
-                                collisions.push_back(CollisionPair(A.get(), B.get()));
-                            }
+    state->manifoldAnchorA = center;
+    state->manifoldAnchorB = glm::conjugate(B->pose.q) * (world - B->pose.p);
+    state->manifoldRotation = relativeRotation(A, B);
+}
 
-                            break;
-                        }
+/* Whether the manifold of the previous substep may be solved again */
+static bool canReuseManifold(const PairState* state) {
 
-                        // case ColliderType::INEFFICIENT_MESH : {
+    if (!XPBDSolver::persistentContacts || !state || !state->hasManifold)
+        return false;
 
-                        //     // @TODO find a more efficient method, BVH tree etc.
-                        //     collisions.push_back(CollisionPair(A.get(), B.get()));
+    if (!state->A->persistentContacts || !state->B->persistentContacts)
+        return false;
 
-                        //     break;
-                        // }
+    if (state->manifoldAge >= XPBDSolver::persistentContactSubsteps)
+        return false;
 
-                        case ColliderType::PLANE : {
+    const RigidBody* A = state->A;
+    const RigidBody* B = state->B;
 
-                            const auto& PC = std::static_pointer_cast<PlaneCollider>(B->collider);
+    /* Sliding at the manifold itself, measuring it at the origin of B
+     * would scale the rotation of A by the distance to that origin (which
+     * is large for static ground planes and meshes) */
+    const vec3 a = A->pose.p + A->pose.q * state->manifoldAnchorA;
+    const vec3 b = B->pose.p + B->pose.q * state->manifoldAnchorB;
 
-                            if (aabb1.intersectsPlane(PC->m_plane)) {
-                                collisions.push_back(CollisionPair(A.get(), B.get()));
-                            }
+    if (glm::length(a - b) > XPBDSolver::persistentContactDistance)
+        return false;
 
-                            break;
-                        }
-                        
-                        default: break;
-                    }
-                break;
-            }
-        }
-    }
+    /* |q0 · q1| = cos(θ / 2) */
+    const float minCos = std::cos(0.5f * XPBDSolver::persistentContactAngle);
 
-    return collisions;
+    return std::abs(glm::dot(relativeRotation(A, B), state->manifoldRotation)) >= minCos;
 }
 
-std::vector<Ref<ContactSet>> XPBDSolver::getContacts(
-    const std::vector<CollisionPair>& collisions
-) {
+/**
+ * Takes the contact with the same id out of the previous manifold and
+ * overwrites it, so points keep their identity across manifolds.
+ */
+static Ref<ContactSet> makeContact(PairState* state, uint32_t id, const ContactSet& contact) {
 
-    std::vector<Ref<ContactSet>> contacts = {};
+    Ref<ContactSet> result = nullptr;
 
-    for (auto const& collision: collisions) {
+    if (state) {
+        auto& previous = state->manifold;
 
-        RigidBody* A = collision.A;
-        RigidBody* B = collision.B;
+        for (size_t i = 0; i < previous.size(); i++) {
+            if (previous[i]->id != id)
+                continue;
 
-        switch (A->collider->m_type) {
+            result = previous[i];
+            previous[i] = previous.back();
+            previous.pop_back();
 
-            case ColliderType::PLANE :
-            case ColliderType::SPHERE :
-            case ColliderType::INEFFICIENT_MESH :
-                break;
+            *result = contact;
+            break;
+        }
+    }
 
-            case ColliderType::CONVEX_MESH :
+    if (!result)
+        result = ref<ContactSet>(contact);
 
-                switch (B->collider->m_type) {
+    result->id = id;
 
-                    case ColliderType::CONVEX_MESH : {
+    return result;
+}
 
-                        Simplex simplex = GjkEpa::GJK(A->collider.get(), B->collider.get());
+/* Upper bound of how far any point of the body moves in a unit of time */
+static float motionBound(const RigidBody* body) {
 
-                        if (!simplex.containsOrigin)
-                            break;
+    if (!body->isDynamic || body->isSleeping)
+        return 0.0f;
 
-                        /* @todo compute EPA manifold and add RigidBody.hasStableContact */
-                        auto epa = GjkEpa::EPA(simplex, A->collider.get(), B->collider.get());
-                        
-                        if (!epa.exists || epa.d <= 0.0)
-                            break;
+    const AABB& aabb = body->collider->m_aabb;
+    float radius = 0.0f;
 
-                        auto contact = ref<ContactSet>(
-                            A,
-                            B,
-                            -epa.normal,
-                            epa.d,
-                            epa.p1,
-                            epa.p2,
-                            A->worldToLocal(epa.p1),
-                            B->worldToLocal(epa.p2)
-                        );
+    if (aabb.isFinite())
+        radius = glm::length(glm::max(glm::abs(aabb.max - body->pose.p), glm::abs(aabb.min - body->pose.p)));
 
-                        contacts.push_back(contact);
-                        // XPBDSolver::debugContact(contact);
+    return glm::length(body->vel) + glm::length(body->omega) * radius;
+}
 
-                        break;
-                    }
+void XPBDSolver::getContacts(
+    std::span<const CollisionPair> collisions,
+    const float h,
+    std::vector<Ref<ContactSet>>& contacts
+) {
 
-                    // case ColliderType::INEFFICIENT_MESH : {
+    contacts.clear();
 
-                    //     const auto& MC1 = std::static_pointer_cast<MeshCollider>(A->collider); // Convex
-                    //     const auto& MC2 = std::static_pointer_cast<MeshCollider>(B->collider); // Non-convex
+    for (auto const& collision: collisions) {
 
-                    //     for (const auto& triangle : MC2->m_triangles) {
+        RigidBody* A = collision.A;
+        RigidBody* B = collision.B;
+        PairState* state = collision.state;
 
-                    //         for (int i = 0; i < MC1->m_uniqueIndices.size(); i++) {
+        const bool continuous = A->continuousCollision || B->continuousCollision;
 
-                    //             /* (26) - p1 */
-                    //             const vec3 r1 = MC1->m_vertices[MC1->m_uniqueIndices[i]];
-                    //             const vec3 p1 = MC1->m_verticesWorldSpace[MC1->m_uniqueIndices[i]];
+        if (canReuseManifold(state)) {
+            state->manifoldAge++;
 
-                    //             vec3 ro = p1;
-                    //             vec3 N = triangle[3]; // need to compute, disabled in updateGlobalPose() 
-                    //             vec2 bary;
-                    //             float t;
+            for (auto const& contact: state->manifold) {
+                contact->refresh();
 
-                    //             bool intersected = glm::intersectRayTriangle(ro, N, triangle[0], triangle[1], triangle[2], bary, t);
+                /* (3.5) if d ≤ 0 we skip the contact, unless it is speculative */
+                if (contact->d <= 0.0f && !contact->speculative)
+                    continue;
 
-                    //             if (intersected && t > 0.0f) {
+                contacts.push_back(contact);
+                state->touchedThisStep |= contact->d > 0.0f;
+            }
 
-                    //                 /* (26) - p2 */
-                    //                 const vec3 p2 = ro + N * t; // ro + rd × t
-                    //                 const vec3 r2 = B->worldToLocal(p2);
+            continue;
+        }
 
-                    //                 /* (3.5) Penetration depth -- Note: sign was flipped! */
-                    //                 const float d = - glm::dot((p1 - p2), N);
+        /* Points near the surface are kept as well, see persistentContactDistance */
+        float margin = XPBDSolver::persistentContacts
+            ? XPBDSolver::persistentContactDistance
+            : 0.0f;
+
+        /* Fast bodies also look as far ahead as they can move */
+        if (continuous)
+            margin = std::max(margin, XPBDSolver::speculativeSubsteps * h * (motionBound(A) + motionBound(B)));
+
+        thread_local std::vector<Ref<ContactSet>> manifold;
+        manifold.clear();
+
+        Narrowphase::Query query;
+        query.gjk = state ? &state->gjk : nullptr;
+        query.margin = margin;
+        query.maxPlanePoints = std::clamp<size_t>(XPBDSolver::maxPlaneContacts, 1, SupportFeature::MAX_POINTS);
+        query.speculative = continuous;
+
+        ContactManifold::Manifold points;
+
+        if (Narrowphase::collide(A->collider.get(), B->collider.get(), query, points)) {
+
+            for (size_t i = 0; i < points.size; i++) {
+                const auto& point = points.points[i];
+
+                auto contact = makeContact(
+                    state,
+                    point.id,
+                    ContactSet(
+                        A,
+                        B,
+                        -point.normal,
+                        point.d,
+                        point.p1,
+                        point.p2,
+                        A->worldToLocal(point.p1),
+                        B->worldToLocal(point.p2)
+                    )
+                );
+
+                contact->speculative = continuous && contact->d <= 0.0f;
+
+                manifold.push_back(contact);
+                // XPBDSolver::debugContact(contact);
+            }
+        }
 
-                    //                 /* (3.5) if d ≤ 0 we skip the contact */
-                    //                 if (d <= 0.0f)
-                    //                     continue;
+        bool touching = false;
 
-                    //                 auto contact = ref<ContactSet>(A, B, N, d, p1, p2, r1, r2);
-                    //                 contacts.push_back(contact);
-                    //                 XPBDSolver::debugContact(contact);
-                    //             }
-                    //         }
-                    //     }
-                    // }
+        for (auto const& contact: manifold) {
 
-                    case ColliderType::PLANE : {
+            /* (3.5) if d ≤ 0 we skip the contact, unless it is speculative */
+            if (contact->d <= 0.0f && !contact->speculative)
+                continue;
 
-                        const auto& MC = std::static_pointer_cast<MeshCollider>(A->collider);
-                        const auto& PC = std::static_pointer_cast<PlaneCollider>(B->collider);
+            contacts.push_back(contact);
+            touching |= contact->d > 0.0f;
+        }
 
-                        const vec3 N = PC->m_plane.normal;
+        if (!state)
+            continue;
 
-                        for (int i = 0; i < MC->m_uniqueIndices.size(); i++) {
+        state->hasManifold = !manifold.empty();
+        state->touchedThisStep |= touching;
 
-                            /* (26) - p1 */
-                            const vec3 r1 = MC->m_vertices[MC->m_uniqueIndices[i]];
-                            const vec3 p1 = MC->m_verticesWorldSpace[MC->m_uniqueIndices[i]];
+        if (!manifold.empty()) {
+            state->manifold.assign(manifold.begin(), manifold.end());
+            state->manifoldAge = 0;
+            storeManifoldAnchors(state);
+        }
+    }
+}
 
-                            /**
-                             * @TODO return some kind of 'hitinfo' from Plane class, 
-                             * since most of these projection / distance functions
-                             * use the same methods internally.
-                             */
-                            if (!PC->m_plane.containsPoint(p1))
-                                continue;
+void XPBDSolver::clampMotion(
+    std::span<const CollisionPair> collisions
+) {
 
-                            /* (26) - p2 */
-                            const vec3 p2 = PC->m_plane.projectPoint(p1);
-                            const vec3 r2 = B->worldToLocal(p2);
+    for (auto const& collision: collisions) {
 
-                            /* (3.5) Penetration depth -- Note: sign was flipped! */
-                            const float d = - glm::dot((p1 - p2), N);
-                            // const float d = -PC->m_plane.distanceToPoint(p1); // This matches the calculation above!
+        RigidBody* A = collision.A;
+        RigidBody* B = collision.B;
 
-                            /* (3.5) if d ≤ 0 we skip the contact */
-                            if (d <= 0.0f)
-                                continue;
+        if (!A->continuousCollision && !B->continuousCollision)
+            continue;
 
-                            auto contact = ref<ContactSet>(A, B, N, d, p1, p2, r1, r2);
+        float t;
 
-                            contacts.push_back(contact);
-                            // XPBDSolver::debugContact(contact);
-                        }
+        if (!ContinuousCollision::timeOfImpact(A, B, XPBDSolver::timeOfImpactTolerance, t))
+            continue;
 
-                        break;
-                    }
-                    default: break;
-                }
-            break;
+        for (RigidBody* body : { A, B }) {
+            if (body->isDynamic && !body->isSleeping)
+                body->pose = ContinuousCollision::interpolate(body->prevPose, body->pose, t);
         }
     }
-
-    return contacts;
 }
 
 void XPBDSolver::solvePositions(
@@ -442,67 +625,229 @@ void XPBDSolver::solveVelocities(
 
     /* (3.6) Velocity level */
 
-    for (auto const& contact: contacts) {
+    for (auto const& contact: contacts)
+        XPBDSolver::_solveVelocity(contact, h);
+}
 
-        contact->update();
+void XPBDSolver::_solveVelocity(
+    Ref<ContactSet> contact,
+    const float h
+) {
 
-        vec3 dv = vec3(0.0f);
+    /* The gap didn't close in the position solve, nothing to do yet */
+    if (contact->speculative && contact->lambda_n == 0.0f)
+        return;
 
-        /* (29) Relative normal and tangential velocities
-         *
-         * Note: v and vn are recalculated since the velocities were
-         * modified by RigidBody::update() in the meantime.
-         */
-        const vec3 v = (
-            contact->A->getVelocityAt(contact->p1) - 
-            contact->B->getVelocityAt(contact->p2)
-        );
-        const float vn = glm::dot(contact->n, v);
-        const vec3 vt = v - (contact->n * vn);
-        const float vt_len = glm::length(vt);
-
-        /* (30) Friction */
-        if (vt_len > 0.0001f) {
-            const float Fn = -contact->lambda_n / (h * h);
-            const float friction = std::min(h * contact->dynamicFriction * Fn, vt_len);
-            dv -= glm::normalize(vt) * friction;
+    contact->update();
+
+    vec3 dv = vec3(0.0f);
+
+    /* (29) Relative normal and tangential velocities
+     *
+     * Note: v and vn are recalculated since the velocities were
+     * modified by RigidBody::update() in the meantime.
+     */
+    const vec3 v = (
+        contact->A->getVelocityAt(contact->p1) - 
+        contact->B->getVelocityAt(contact->p2)
+    );
+    const float vn = glm::dot(contact->n, v);
+    const vec3 vt = v - (contact->n * vn);
+    const float vt_len = glm::length(vt);
+
+    /* (30) Friction */
+    if (vt_len > 0.0001f) {
+        const float Fn = -contact->lambda_n / (h * h);
+        const float friction = std::min(h * contact->dynamicFriction * Fn, vt_len);
+        dv -= glm::normalize(vt) * friction;
+    }
+
+    /* (34) Restitution
+     *
+     * To avoid jittering we set e = 0 if vn is small (`threshold`).
+     * 
+     * Note: min() was replaced with max() due to the flipped sign convention.
+     *
+     * Note: `vn_tilde` is calculated in ContactSet before the position solve (Eq. 29)
+     */
+    const float threshold = (2.0f * 9.81f * h);
+    const float e = std::abs(vn) <= threshold ? 0.0f : contact->e;
+    const float vn_tilde = contact->vn;
+    dv += contact->n * (-vn + std::max(-e * vn_tilde, 0.0f));
+
+    /* (33) Velocity update */
+    auto [dlambda, corr] = XPBDSolver::findLagrangeMultiplier(
+        contact->A,
+        contact->B,
+        dv,
+        0.0f,
+        h,
+        contact->p1,
+        contact->p2
+    );
+    
+    XPBDSolver::applyBodyPairCorrection(
+        contact->A,
+        contact->B,
+        corr,
+        contact->p1,
+        contact->p2,
+        true
+    );
+}
+
+/* Bodies that the solve moves, the only ones items of a colour can't share */
+static inline bool isSolved(const RigidBody* body) {
+    return body != nullptr && body->isDynamic && !body->isSleeping;
+}
+
+void XPBDSolver::colorItems(
+    std::span<Constraint* const> constraints,
+    const std::vector<Ref<ContactSet>>& contacts,
+    SolverColors& colors
+) {
+
+    using Item = SolverColors::Item;
+
+    const size_t colorCount = std::clamp<size_t>(XPBDSolver::maxSolverColors, 1, 255);
+
+    /* Constraints first, then the contacts of each pair (they are adjacent) */
+    auto forEachItem = [&](auto&& func) {
+        for (Constraint* constraint : constraints)
+            func(Item{ constraint, 0, 0 }, constraint->m_body0.get(), constraint->m_body1.get());
+
+        for (size_t first = 0; first < contacts.size();) {
+            const ContactSet& contact = *contacts[first];
+            size_t last = first + 1;
+
+            while (last < contacts.size() && contacts[last]->A == contact.A && contacts[last]->B == contact.B)
+                last++;
+
+            func(Item{ nullptr, uint32_t(first), uint32_t(last - first) }, contact.A, contact.B);
+            first = last;
         }
+    };
 
-        /* (34) Restitution
-         *
-         * To avoid jittering we set e = 0 if vn is small (`threshold`).
-         * 
-         * Note: min() was replaced with max() due to the flipped sign convention.
-         *
-         * Note: `vn_tilde` is calculated in ContactSet before the position solve (Eq. 29)
-         */
-        const float threshold = (2.0f * 9.81f * h);
-        const float e = std::abs(vn) <= threshold ? 0.0f : contact->e;
-        const float vn_tilde = contact->vn;
-        dv += contact->n * (-vn + std::max(-e * vn_tilde, 0.0f));
+    auto& bodyColors = colors.bodyColors;
+    auto& itemColors = colors.itemColors;
+    auto& offsets = colors.offsets;
 
-        /* (33) Velocity update */
-        auto [dlambda, corr] = XPBDSolver::findLagrangeMultiplier(
-            contact->A,
-            contact->B,
-            dv,
-            0.0f,
-            h,
-            contact->p1,
-            contact->p2
-        );
-        
-        XPBDSolver::applyBodyPairCorrection(
-            contact->A,
-            contact->B,
-            corr,
-            contact->p1,
-            contact->p2,
-            true
-        );
+    forEachItem([&](const Item&, RigidBody* A, RigidBody* B) {
+        for (RigidBody* body : { A, B }) {
+            if (!isSolved(body))
+                continue;
+
+            if (body->id >= bodyColors.size())
+                bodyColors.resize(body->id + 1);
+
+            bodyColors[body->id] = 0;
+        }
+    });
+
+    /**
+     * Each item takes the colour after the last one its bodies are in, so
+     * items that share a body are solved in the same order as without
+     * colours. Once a body runs out of colours, the rest of its items go
+     * to the overflow (colorCount) which is solved last, also in order.
+     */
+    itemColors.clear();
+    offsets.assign(colorCount + 2, 0);
+
+    forEachItem([&](const Item&, RigidBody* A, RigidBody* B) {
+        uint32_t color = 0;
+
+        if (isSolved(A)) color = std::max(color, bodyColors[A->id]);
+        if (isSolved(B)) color = std::max(color, bodyColors[B->id]);
+
+        const uint32_t next = std::min<uint32_t>(color + 1, colorCount);
+
+        if (isSolved(A)) bodyColors[A->id] = next;
+        if (isSolved(B)) bodyColors[B->id] = next;
+
+        itemColors.push_back(static_cast<uint8_t>(color));
+        offsets[color + 1]++;
+    });
+
+    for (size_t c = 1; c < offsets.size(); c++)
+        offsets[c] += offsets[c - 1];
+
+    /* Items keep their order within a colour */
+    std::vector<uint32_t>& cursor = colors.cursor;
+    cursor.assign(offsets.begin(), offsets.end() - 1);
+
+    colors.items.resize(offsets.back());
+
+    size_t k = 0;
+
+    forEachItem([&](const Item& item, RigidBody*, RigidBody*) {
+        colors.items[cursor[itemColors[k++]]++] = item;
+    });
+}
+
+/* Calls func for every item, colour by colour. The items of a colour are split over the pool */
+template <typename Func>
+static void forEachColor(const XPBDSolver::SolverColors& colors, WorkerPool* pool, Func&& func) {
+
+    const auto& offsets = colors.offsets;
+    const size_t chunkSize = std::max<size_t>(XPBDSolver::colorChunkSize, 1);
+
+    for (size_t c = 0; c + 1 < offsets.size(); c++) {
+        const size_t first = offsets[c];
+        const size_t count = offsets[c + 1] - first;
+
+        auto range = [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; i++)
+                func(colors.items[first + i]);
+        };
+
+        /* The items that didn't fit in a colour may share bodies */
+        const bool overflow = c + 2 == offsets.size();
+
+        if (pool != nullptr && !overflow)
+            pool->parallelFor(count, chunkSize, range);
+        else
+            range(0, count, 0);
     }
 }
 
+void XPBDSolver::solvePositions(
+    const SolverColors& colors,
+    const std::vector<Ref<ContactSet>>& contacts,
+    const float h,
+    WorkerPool* pool
+) {
+
+    forEachColor(colors, pool, [&](const SolverColors::Item& item) {
+        if (item.constraint != nullptr) {
+            item.constraint->solvePos(h);
+            return;
+        }
+
+        for (uint32_t k = item.firstContact; k < item.firstContact + item.contactCount; k++) {
+            XPBDSolver::_solvePenetration(contacts[k], h);
+            XPBDSolver::_solveFriction(contacts[k], h);
+        }
+    });
+}
+
+void XPBDSolver::solveVelocities(
+    const SolverColors& colors,
+    const std::vector<Ref<ContactSet>>& contacts,
+    const float h,
+    WorkerPool* pool
+) {
+
+    forEachColor(colors, pool, [&](const SolverColors::Item& item) {
+        if (item.constraint != nullptr) {
+            item.constraint->solveVel(h);
+            return;
+        }
+
+        for (uint32_t k = item.firstContact; k < item.firstContact + item.contactCount; k++)
+            XPBDSolver::_solveVelocity(contacts[k], h);
+    });
+}
+
 /** 
  * @return float Lagrange multiplier (λ)
  */
@@ -0,0 +1,157 @@
+
+#include "phys/broadphase/AABBTreeBroadphase.h"
+
+AABBTreeBroadphase::AABBTreeBroadphase(float margin)
+    : m_dynamicTree(margin), m_staticTree(margin)
+{}
+
+void AABBTreeBroadphase::removeProxy(Proxy& proxy) {
+
+    switch (proxy.type) {
+        case ProxyType::DYNAMIC :
+            m_dynamicTree.remove(proxy.node);
+            break;
+        case ProxyType::STATIC :
+            m_staticTree.remove(proxy.node);
+            break;
+        default: break;
+    }
+
+    proxy.type = ProxyType::NONE;
+    proxy.node = AABBTree::NULL_NODE;
+}
+
+void AABBTreeBroadphase::updateProxies(
+    const std::vector<Ref<RigidBody>>& bodies
+) {
+
+    /* Bodies were removed from the end */
+    while (m_proxies.size() > bodies.size()) {
+        removeProxy(m_proxies.back());
+        m_proxies.pop_back();
+    }
+
+    m_proxies.resize(bodies.size());
+    m_unbounded.clear();
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const int index = static_cast<int>(i);
+        const RigidBody* body = bodies[i].get();
+        Proxy& proxy = m_proxies[i];
+
+        /* A different body took this slot */
+        if (proxy.body != body) {
+            removeProxy(proxy);
+            proxy.body = body;
+        }
+
+        const AABB& aabb = body->collider->m_expanded_aabb;
+
+        ProxyType type = ProxyType::NONE;
+
+        if (body->canCollide) {
+            if (!aabb.isFinite())
+                type = ProxyType::UNBOUNDED;
+            else
+                type = body->isDynamic ? ProxyType::DYNAMIC : ProxyType::STATIC;
+        }
+
+        if (proxy.type != type) {
+            removeProxy(proxy);
+
+            proxy.type = type;
+
+            if (type == ProxyType::DYNAMIC)
+                proxy.node = m_dynamicTree.insert(aabb, index);
+            else if (type == ProxyType::STATIC)
+                proxy.node = m_staticTree.insert(aabb, index);
+
+        } else if (type == ProxyType::DYNAMIC) {
+            m_dynamicTree.move(proxy.node, aabb);
+
+        } else if (type == ProxyType::STATIC) {
+            /* Static bodies are not refit, this only catches teleports */
+            m_staticTree.move(proxy.node, aabb);
+        }
+
+        if (type == ProxyType::UNBOUNDED)
+            m_unbounded.push_back(index);
+
+        proxy.aabb = aabb;
+        proxy.isAwake = body->isDynamic && !body->isSleeping;
+        proxy.layer = body->collisionLayer;
+        proxy.mask = body->collisionMask;
+    }
+}
+
+std::vector<CollisionPair> AABBTreeBroadphase::collectCollisionPairs(
+    const std::vector<Ref<RigidBody>>& bodies,
+    [[maybe_unused]] const float dt
+) {
+
+    this->updateProxies(bodies);
+
+    m_candidates.clear();
+
+    /* Query in tree order, neighbouring bodies touch the same nodes */
+    m_queryOrder.clear();
+
+    m_dynamicTree.forEachLeaf([&](int i) {
+        /* Sleeping bodies are found by the awake bodies around them */
+        if (m_proxies[i].isAwake)
+            m_queryOrder.push_back(i);
+    });
+
+    /* The trees are only read from here on, so the queries can run in parallel */
+    this->parallelCollect(m_queryOrder.size(), 64, bodies.size(), m_candidates, [&](size_t begin, size_t end, CandidateBuffer& buffer) {
+
+        auto addCandidate = [&](int a, int b) {
+            if (this->layersCollide(a, b))
+                buffer.emplace_back(std::min(a, b), std::max(a, b));
+        };
+
+        for (size_t k = begin; k < end; k++) {
+            const int i = m_queryOrder[k];
+            const Proxy& proxy = m_proxies[i];
+
+            m_dynamicTree.query(proxy.aabb, [&](int j) {
+                if (j == i)
+                    return;
+
+                /* Both awake: only report the pair once */
+                if (m_proxies[j].isAwake && j < i)
+                    return;
+
+                addCandidate(i, j);
+            });
+
+            m_staticTree.query(proxy.aabb, [&](int j) {
+                addCandidate(i, j);
+            });
+        }
+    });
+
+    /* Unbounded bodies are tested against everything. If they can't move
+     * themselves, only the awake bodies can pair with them (see testPair) */
+    bool boundsUpdated = false;
+
+    for (int u : m_unbounded) {
+        const RigidBody* body = bodies[u].get();
+
+        if (!body->isDynamic || body->isSleeping) {
+            for (int i : m_queryOrder)
+                m_candidates.emplace_back(std::min(u, i), std::max(u, i));
+
+            continue;
+        }
+
+        if (!boundsUpdated) {
+            this->updateBounds(bodies);
+            boundsUpdated = true;
+        }
+
+        this->collectAgainstAll(bodies, u, m_candidates);
+    }
+
+    return Broadphase::emitPairs(bodies, m_candidates);
+}
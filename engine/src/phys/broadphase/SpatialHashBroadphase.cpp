@@ -0,0 +1,301 @@
+
+#include "phys/broadphase/SpatialHashBroadphase.h"
+
+#include <algorithm>
+#include <cassert>
+
+SpatialHashBroadphase::SpatialHashBroadphase(float cellSize, int maxCellsPerBody)
+    : m_maxCellsPerBody(maxCellsPerBody)
+{
+    assert(maxCellsPerBody > 0);
+
+    this->setCellSize(cellSize);
+}
+
+void SpatialHashBroadphase::setCellSize(float cellSize) {
+    assert(cellSize > 0.0f);
+
+    m_cellSize = cellSize;
+    m_invCellSize = 1.0f / cellSize;
+    m_staticDirty = true;
+}
+
+void SpatialHashBroadphase::updateProxies(
+    const std::vector<Ref<RigidBody>>& bodies
+) {
+
+    /* Bodies were removed from the end */
+    for (size_t i = bodies.size(); i < m_proxies.size(); i++) {
+        if (m_proxies[i].type == ProxyType::STATIC)
+            m_staticDirty = true;
+    }
+
+    m_proxies.resize(bodies.size());
+
+    m_dynamic.clear();
+    m_static.clear();
+    m_large.clear();
+    m_awake.clear();
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const int index = static_cast<int>(i);
+        const RigidBody* body = bodies[i].get();
+        Proxy& proxy = m_proxies[i];
+
+        const AABB& aabb = body->collider->m_expanded_aabb;
+
+        ProxyType type = ProxyType::NONE;
+
+        if (body->canCollide) {
+            float cells = 1.0f;
+
+            for (int axis = 0; axis < 3; axis++) {
+                cells *= std::floor(aabb.max[axis] * m_invCellSize)
+                       - std::floor(aabb.min[axis] * m_invCellSize) + 1.0f;
+            }
+
+            /* Also catches unbounded AABBs (inf, or NaN for inf - inf) */
+            if (!aabb.isFinite() || !(cells <= static_cast<float>(m_maxCellsPerBody)))
+                type = ProxyType::LARGE;
+            else
+                type = body->isDynamic ? ProxyType::DYNAMIC : ProxyType::STATIC;
+        }
+
+        /* Static bodies are not moved, this only catches changes and teleports */
+        const bool wasStatic = proxy.type == ProxyType::STATIC;
+        const bool isStatic = type == ProxyType::STATIC;
+
+        if (wasStatic != isStatic || proxy.body != body
+            || (isStatic && (proxy.aabb.min != aabb.min || proxy.aabb.max != aabb.max)))
+        {
+            if (wasStatic || isStatic)
+                m_staticDirty = true;
+        }
+
+        proxy.body = body;
+        proxy.type = type;
+        proxy.aabb = aabb;
+        proxy.isAwake = body->isDynamic && !body->isSleeping;
+        proxy.layer = body->collisionLayer;
+        proxy.mask = body->collisionMask;
+
+        switch (type) {
+            case ProxyType::DYNAMIC : m_dynamic.push_back(index); break;
+            case ProxyType::STATIC : m_static.push_back(index); break;
+            case ProxyType::LARGE : m_large.push_back(index); break;
+            default: break;
+        }
+
+        if (type != ProxyType::NONE && proxy.isAwake)
+            m_awake.push_back(index);
+    }
+}
+
+void SpatialHashBroadphase::buildGrid(Grid& grid, const std::vector<int>& proxies) {
+
+    /* Count the entries to size the table, ~2 buckets per entry */
+    size_t count = 0;
+
+    for (int p : proxies) {
+        const ivec3 lo = this->cellOf(m_proxies[p].aabb.min);
+        const ivec3 hi = this->cellOf(m_proxies[p].aabb.max);
+
+        count += static_cast<size_t>(hi.x - lo.x + 1) * (hi.y - lo.y + 1) * (hi.z - lo.z + 1);
+    }
+
+    size_t bucketCount = 16;
+    while (bucketCount < 2 * count)
+        bucketCount <<= 1;
+
+    const uint32_t mask = static_cast<uint32_t>(bucketCount - 1);
+
+    auto forEachCell = [&](int p, auto&& callback) {
+        const ivec3 lo = this->cellOf(m_proxies[p].aabb.min);
+        const ivec3 hi = this->cellOf(m_proxies[p].aabb.max);
+
+        for (int x = lo.x; x <= hi.x; x++)
+        for (int y = lo.y; y <= hi.y; y++)
+        for (int z = lo.z; z <= hi.z; z++)
+            callback(ivec3(x, y, z));
+    };
+
+    /* Counting sort: histogram, prefix sum, scatter */
+    grid.buckets.assign(bucketCount + 1, 0);
+    grid.entries.resize(count);
+
+    for (int p : proxies) {
+        forEachCell(p, [&](const ivec3& cell) {
+            grid.buckets[(hashCell(cell) & mask) + 1]++;
+        });
+    }
+
+    for (size_t b = 1; b <= bucketCount; b++)
+        grid.buckets[b] += grid.buckets[b - 1];
+
+    thread_local std::vector<uint32_t> cursor;
+    cursor.assign(grid.buckets.begin(), grid.buckets.end() - 1);
+
+    for (int p : proxies) {
+        forEachCell(p, [&](const ivec3& cell) {
+            grid.entries[cursor[hashCell(cell) & mask]++] = { cell, p };
+        });
+    }
+}
+
+bool SpatialHashBroadphase::isHomeCell(const ivec3& cell, int a, int b) const {
+    const AABB& A = m_proxies[a].aabb;
+    const AABB& B = m_proxies[b].aabb;
+
+    return this->cellOf(glm::max(A.min, B.min)) == cell;
+}
+
+const SpatialHashBroadphase::Stats& SpatialHashBroadphase::getStats() {
+    if (m_statsDirty)
+        this->updateStats();
+
+    return m_stats;
+}
+
+void SpatialHashBroadphase::updateStats() {
+
+    m_statsDirty = false;
+    m_stats = Stats();
+    m_stats.largeBodies = m_large.size();
+
+    auto addCell = [&](size_t occupancy) {
+        m_stats.occupiedCells++;
+        m_stats.entries += occupancy;
+        m_stats.maxOccupancy = std::max(m_stats.maxOccupancy, occupancy);
+
+        size_t bin = 0;
+        while (bin < m_stats.histogram.size() - 1 && occupancy > (size_t(1) << bin))
+            bin++;
+
+        m_stats.histogram[bin]++;
+    };
+
+    /* Buckets may hold several cells when hashes collide */
+    for (const Grid* grid : { &m_dynamicGrid, &m_staticGrid }) {
+        for (size_t b = 0; b + 1 < grid->buckets.size(); b++) {
+            const uint32_t end = grid->buckets[b + 1];
+
+            for (uint32_t i = grid->buckets[b]; i < end; i++) {
+                const ivec3& cell = grid->entries[i].cell;
+
+                /* Only count each cell at its first entry */
+                bool isFirst = true;
+                for (uint32_t j = grid->buckets[b]; j < i && isFirst; j++)
+                    isFirst = grid->entries[j].cell != cell;
+
+                if (!isFirst)
+                    continue;
+
+                size_t occupancy = 1;
+                for (uint32_t j = i + 1; j < end; j++)
+                    occupancy += grid->entries[j].cell == cell;
+
+                addCell(occupancy);
+            }
+        }
+    }
+
+    if (m_stats.occupiedCells > 0)
+        m_stats.meanOccupancy = static_cast<float>(m_stats.entries) / m_stats.occupiedCells;
+}
+
+std::vector<CollisionPair> SpatialHashBroadphase::collectCollisionPairs(
+    const std::vector<Ref<RigidBody>>& bodies,
+    [[maybe_unused]] const float dt
+) {
+
+    this->updateProxies(bodies);
+
+    if (m_staticDirty) {
+        this->buildGrid(m_staticGrid, m_static);
+        m_staticDirty = false;
+    }
+
+    this->buildGrid(m_dynamicGrid, m_dynamic);
+
+    m_candidates.clear();
+
+    const auto& buckets = m_dynamicGrid.buckets;
+    const auto& entries = m_dynamicGrid.entries;
+
+    /* The grids are only read from here on, so the buckets can be scanned in parallel */
+    this->parallelCollect(buckets.size() - 1, 256, bodies.size(), m_candidates, [&](size_t first, size_t last, CandidateBuffer& buffer) {
+
+        auto addCandidate = [&](int a, int b) {
+            if (this->layersCollide(a, b))
+                buffer.emplace_back(std::min(a, b), std::max(a, b));
+        };
+
+        for (size_t b = first; b < last; b++) {
+            const uint32_t end = buckets[b + 1];
+
+            for (uint32_t i = buckets[b]; i < end; i++) {
+                const Entry& e = entries[i];
+                const bool isAwake = m_proxies[e.proxy].isAwake;
+
+                /* Dynamic vs dynamic, skipping other cells that share the bucket */
+                for (uint32_t j = i + 1; j < end; j++) {
+                    const Entry& other = entries[j];
+
+                    if (other.cell != e.cell)
+                        continue;
+
+                    /* Sleeping bodies are found by the awake bodies around them */
+                    if (!isAwake && !m_proxies[other.proxy].isAwake)
+                        continue;
+
+                    if (this->isHomeCell(e.cell, e.proxy, other.proxy))
+                        addCandidate(e.proxy, other.proxy);
+                }
+
+                /* Dynamic vs static, looked up in the same cell of the static grid */
+                if (!isAwake || m_staticGrid.entries.empty())
+                    continue;
+
+                const uint32_t sb = hashCell(e.cell) & m_staticGrid.bucketMask();
+
+                for (uint32_t j = m_staticGrid.buckets[sb]; j < m_staticGrid.buckets[sb + 1]; j++) {
+                    const Entry& other = m_staticGrid.entries[j];
+
+                    if (other.cell == e.cell && this->isHomeCell(e.cell, e.proxy, other.proxy))
+                        addCandidate(e.proxy, other.proxy);
+                }
+            }
+        }
+    });
+
+    auto addCandidate = [&](int a, int b) {
+        if (this->layersCollide(a, b))
+            m_candidates.emplace_back(std::min(a, b), std::max(a, b));
+    };
+
+    /**
+     * Large bodies are only tested against the awake bodies. Pairs without
+     * an awake dynamic body are rejected by Broadphase::testPair anyway.
+     */
+    bool boundsReady = false;
+
+    for (int l : m_large) {
+        if (m_proxies[l].isAwake) {
+            if (!boundsReady) {
+                this->updateBounds(bodies);
+                boundsReady = true;
+            }
+
+            this->collectAgainstAll(bodies, l, m_candidates);
+        } else {
+            for (int j : m_awake) {
+                if (j != l)
+                    addCandidate(l, j);
+            }
+        }
+    }
+
+    m_statsDirty = true;
+
+    return Broadphase::emitPairs(bodies, m_candidates);
+}
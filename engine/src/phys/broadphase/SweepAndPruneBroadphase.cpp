@@ -0,0 +1,264 @@
+
+#include "phys/broadphase/SweepAndPruneBroadphase.h"
+
+#include <algorithm>
+#include <cassert>
+
+/* Ties put min before max, so touching boxes count as overlapping (like AABB::intersects) */
+static inline bool endpointLess(float valueA, bool isMaxA, float valueB, bool isMaxB) {
+    return valueA < valueB || (valueA == valueB && !isMaxA && isMaxB);
+}
+
+SweepAndPruneBroadphase::SweepAndPruneBroadphase(std::initializer_list<int> axes)
+    : m_axes(axes)
+{
+    assert(!m_axes.empty());
+
+    for (int axis : m_axes)
+        assert(axis >= 0 && axis < 3);
+}
+
+void SweepAndPruneBroadphase::addProxy(int index) {
+
+    /**
+     * Endpoints are appended at the end of each axis. The next insertion
+     * sort moves them into place and reports the overlaps on the way.
+     */
+    const AABB& aabb = m_proxies[index].aabb;
+    const uint32_t data = static_cast<uint32_t>(index) << 1;
+
+    for (int axis : m_axes) {
+        m_endpoints[axis].push_back({ aabb.min[axis], data });
+        m_endpoints[axis].push_back({ aabb.max[axis], data | 1u });
+    }
+
+    m_inserted++;
+}
+
+void SweepAndPruneBroadphase::removeProxy(int index) {
+
+    for (int axis : m_axes) {
+        auto& endpoints = m_endpoints[axis];
+
+        endpoints.erase(
+            std::remove_if(endpoints.begin(), endpoints.end(), [index](const Endpoint& e) {
+                return e.proxy() == index;
+            }),
+            endpoints.end()
+        );
+    }
+
+    for (auto it = m_pairs.begin(); it != m_pairs.end();) {
+        const int a = static_cast<int>(*it >> 32);
+        const int b = static_cast<int>(*it & 0xFFFFFFFFu);
+
+        if (a == index || b == index) {
+            m_removed.emplace_back(a, b);
+            it = m_pairs.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    m_proxies[index].type = ProxyType::NONE;
+}
+
+void SweepAndPruneBroadphase::updateProxies(
+    const std::vector<Ref<RigidBody>>& bodies
+) {
+
+    /* Bodies were removed from the end */
+    while (m_proxies.size() > bodies.size()) {
+        if (m_proxies.back().type == ProxyType::SORTED)
+            removeProxy(static_cast<int>(m_proxies.size()) - 1);
+
+        m_proxies.pop_back();
+    }
+
+    m_proxies.resize(bodies.size());
+    m_unbounded.clear();
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const int index = static_cast<int>(i);
+        const RigidBody* body = bodies[i].get();
+        Proxy& proxy = m_proxies[i];
+
+        /* A different body took this slot */
+        if (proxy.body != body) {
+            if (proxy.type == ProxyType::SORTED)
+                removeProxy(index);
+
+            proxy.type = ProxyType::NONE;
+            proxy.body = body;
+        }
+
+        proxy.aabb = body->collider->m_expanded_aabb;
+
+        ProxyType type = ProxyType::NONE;
+
+        if (body->canCollide)
+            type = proxy.aabb.isFinite() ? ProxyType::SORTED : ProxyType::UNBOUNDED;
+
+        if (proxy.type != type) {
+            if (proxy.type == ProxyType::SORTED)
+                removeProxy(index);
+
+            proxy.type = type;
+
+            if (type == ProxyType::SORTED)
+                addProxy(index);
+        }
+
+        if (type == ProxyType::UNBOUNDED)
+            m_unbounded.push_back(index);
+    }
+
+    /* Refresh the endpoint values, the arrays are now 'almost' sorted */
+    for (int axis : m_axes) {
+        for (auto& endpoint : m_endpoints[axis]) {
+            const AABB& aabb = m_proxies[endpoint.proxy()].aabb;
+            endpoint.value = endpoint.isMax() ? aabb.max[axis] : aabb.min[axis];
+        }
+    }
+}
+
+bool SweepAndPruneBroadphase::overlapsOnSortedAxes(int a, int b) const {
+    const AABB& A = m_proxies[a].aabb;
+    const AABB& B = m_proxies[b].aabb;
+
+    for (int axis : m_axes) {
+        if (A.max[axis] < B.min[axis] || A.min[axis] > B.max[axis])
+            return false;
+    }
+
+    return true;
+}
+
+void SweepAndPruneBroadphase::addPair(int a, int b) {
+    if (m_pairs.insert(pairKey(a, b)).second)
+        m_added.emplace_back(std::min(a, b), std::max(a, b));
+}
+
+void SweepAndPruneBroadphase::removePair(int a, int b) {
+    if (m_pairs.erase(pairKey(a, b)) > 0)
+        m_removed.emplace_back(std::min(a, b), std::max(a, b));
+}
+
+void SweepAndPruneBroadphase::sortAxis(int axis) {
+
+    auto& endpoints = m_endpoints[axis];
+
+    for (size_t i = 1; i < endpoints.size(); i++) {
+        const Endpoint key = endpoints[i];
+        size_t j = i;
+
+        while (j > 0 && endpointLess(key.value, key.isMax(), endpoints[j - 1].value, endpoints[j - 1].isMax())) {
+            const Endpoint& other = endpoints[j - 1];
+
+            if (key.proxy() != other.proxy()) {
+
+                /* Min moves past a max: the boxes start overlapping on this axis */
+                if (!key.isMax() && other.isMax()) {
+                    if (this->overlapsOnSortedAxes(key.proxy(), other.proxy()))
+                        this->addPair(key.proxy(), other.proxy());
+                }
+
+                /* Max moves past a min: the boxes stop overlapping */
+                if (key.isMax() && !other.isMax()) {
+                    this->removePair(key.proxy(), other.proxy());
+                }
+            }
+
+            endpoints[j] = other;
+            j--;
+        }
+
+        endpoints[j] = key;
+    }
+}
+
+void SweepAndPruneBroadphase::rebuild() {
+
+    for (int axis : m_axes) {
+        std::sort(m_endpoints[axis].begin(), m_endpoints[axis].end(), [](const Endpoint& a, const Endpoint& b) {
+            return endpointLess(a.value, a.isMax(), b.value, b.isMax());
+        });
+    }
+
+    /* Sweep along the first axis, keeping a list of open intervals */
+    std::unordered_set<uint64_t> pairs;
+    std::vector<int> open;
+
+    for (const auto& endpoint : m_endpoints[m_axes[0]]) {
+        const int p = endpoint.proxy();
+
+        if (endpoint.isMax()) {
+            auto it = std::find(open.begin(), open.end(), p);
+            *it = open.back();
+            open.pop_back();
+            continue;
+        }
+
+        for (int q : open) {
+            if (this->overlapsOnSortedAxes(p, q))
+                pairs.insert(pairKey(p, q));
+        }
+
+        open.push_back(p);
+    }
+
+    /* Report the difference as events */
+    for (uint64_t key : pairs) {
+        if (m_pairs.count(key) == 0)
+            m_added.emplace_back(static_cast<int>(key >> 32), static_cast<int>(key & 0xFFFFFFFFu));
+    }
+
+    for (uint64_t key : m_pairs) {
+        if (pairs.count(key) == 0)
+            m_removed.emplace_back(static_cast<int>(key >> 32), static_cast<int>(key & 0xFFFFFFFFu));
+    }
+
+    m_pairs.swap(pairs);
+}
+
+std::vector<CollisionPair> SweepAndPruneBroadphase::collectCollisionPairs(
+    const std::vector<Ref<RigidBody>>& bodies,
+    [[maybe_unused]] const float dt
+) {
+
+    m_added.clear();
+    m_removed.clear();
+
+    this->updateProxies(bodies);
+
+    if (m_inserted > SweepAndPruneBroadphase::BATCH_INSERT_THRESHOLD) {
+        this->rebuild();
+    } else {
+        for (int axis : m_axes)
+            this->sortAxis(axis);
+    }
+
+    m_inserted = 0;
+
+    m_candidates.clear();
+
+    for (uint64_t key : m_pairs) {
+        m_candidates.emplace_back(
+            static_cast<int>(key >> 32),
+            static_cast<int>(key & 0xFFFFFFFFu)
+        );
+    }
+
+    /* Unbounded bodies are tested against everything */
+    if (!m_unbounded.empty())
+        this->updateBounds(bodies);
+
+    for (int u : m_unbounded)
+        this->collectAgainstAll(bodies, u, m_candidates);
+
+    /* Keep the event order deterministic */
+    std::sort(m_added.begin(), m_added.end());
+    std::sort(m_removed.begin(), m_removed.end());
+
+    return Broadphase::emitPairs(bodies, m_candidates);
+}
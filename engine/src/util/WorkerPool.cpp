@@ -0,0 +1,103 @@
+
+#include "util/WorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+WorkerPool::WorkerPool(size_t threadCount) {
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 1; i < threadCount; i++)
+        m_workers.emplace_back(&WorkerPool::workerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void WorkerPool::runChunks(const RangeFunc& func, size_t count, size_t grain, size_t thread) {
+    for (;;) {
+        const size_t begin = m_next.fetch_add(grain);
+
+        if (begin >= count)
+            break;
+
+        func(begin, std::min(begin + grain, count), thread);
+    }
+}
+
+void WorkerPool::workerLoop(size_t thread) {
+
+    size_t generation = 0;
+
+    for (;;) {
+        const RangeFunc* func;
+        size_t count, grain;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+            if (m_stop)
+                return;
+
+            generation = m_generation;
+            func = m_func;
+            count = m_count;
+            grain = m_grain;
+        }
+
+        this->runChunks(*func, count, grain, thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (--m_busy == 0)
+                m_done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const RangeFunc& func) {
+
+    assert(grain > 0);
+
+    if (count == 0)
+        return;
+
+    /* Not worth waking anyone up */
+    if (m_workers.empty() || count <= grain) {
+        func(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &func;
+        m_count = count;
+        m_grain = grain;
+        m_next = 0;
+        m_busy = m_workers.size();
+        m_generation++;
+    }
+
+    m_wake.notify_all();
+
+    this->runChunks(func, count, grain, 0);
+
+    /* Workers may still be running their last chunk */
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_busy == 0; });
+
+    m_func = nullptr;
+}
@@ -225,6 +225,7 @@ Car::Car(PhysicsHandler& phys): m_phys(phys) {
     auto rb = m_body->getComponent<RigidBody>();
 
     rb->name = "CarBody";
+    rb->collisionLayer = CollisionLayer::VEHICLE;
     rb->canSleep = false;
     rb->staticFriction = 0.1f;
     rb->dynamicFriction = 0.005f;
@@ -318,6 +319,12 @@ void Car::update(
 
     rb->applyForce(m_forward * -Fd, rb->localToWorld(vec3(0)));
 
+    /* Wheel rays should not hit the car itself */
+    const QueryFilter groundFilter = {
+        .mask = CollisionLayer::ALL,
+        .ignore = rb.get()
+    };
+
     /* Update wheels */
     for (size_t i = 0; i < 4; i++) {
 
@@ -325,7 +332,7 @@ void Car::update(
 
         vec3 hardpointW = rb->localToWorld(wheel->m_hardpoint);
 
-        auto [exists, point, normal, dist] = phys.raycast(hardpointW, wheel->m_normal);
+        auto [exists, point, normal, dist] = phys.raycast(hardpointW, wheel->m_normal, groundFilter);
 
         // std::cout << "Wheel " << i << " raycast: " 
         //     << (exists ? "hit" : "miss") 
@@ -366,7 +373,7 @@ void Car::update(
     m_camLookPos = rb->localToWorld({ 0, 1.2f, 0 });
 
     /* Body shadow */
-    auto [exists, point, normal, dist] = phys.raycast(rb->pose.p, m_wheels[0]->m_normal);
+    auto [exists, point, normal, dist] = phys.raycast(rb->pose.p, m_wheels[0]->m_normal, groundFilter);
 
     if (exists) {
         vec3 offsetPoint = rb->pose.p + (m_wheels[0]->m_normal * (dist - 0.02f));
@@ -19,6 +19,7 @@
 
 #include "phys/PhysicsHandler.h"
 #include "phys/RigidBody.h"
+#include "phys/broadphase/SpatialHashBroadphase.h"
 
 #include "gameobject/GameObject.h"
 #include "component/CameraController.h"
@@ -89,6 +90,10 @@ int main() {
         PhysicsHandler phys;
         phys.init();
 
+        /* Open world with mostly car-sized bodies */
+        auto broadphase = ref<SpatialHashBroadphase>(4.0f);
+        phys.setBroadphase(broadphase);
+
         /* Scene / hierarchy */
         std::vector<Ref<GameObject>> gameObjects;
         
@@ -349,6 +354,14 @@ int main() {
             ImGui::BulletText("time: %.2fs", time);
             ImGui::BulletText("fps: %.1f", ImGui::GetIO().Framerate);
             ImGui::BulletText("dt: %.3f", dt);
+
+            const auto& grid = broadphase->getStats();
+            ImGui::BulletText("grid cells: %zu (max %zu, mean %.2f)", grid.occupiedCells, grid.maxOccupancy, grid.meanOccupancy);
+            ImGui::BulletText("grid large bodies: %zu", grid.largeBodies);
+
+            const auto gjk = phys.m_pairCache.getGjkStats();
+            ImGui::BulletText("gjk queries: %zu (%.2f supports avg, %zu warm)", gjk.queries,
+                gjk.queries ? float(gjk.iterations) / gjk.queries : 0.0f, gjk.warmHits);
             
             ImGui::Separator();
 